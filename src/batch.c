@@ -0,0 +1,462 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+
+#include "utils.c"
+#include "solver.c"
+#include "binary_format.c"
+#include "threading.c"
+#include "precheck.c"
+#include "rng.c"
+
+#ifndef BATCH_H
+#define BATCH_H
+
+// `localizer batch <directory | list file>`: solves many instances in one process.
+// A fixed pool of worker threads keeps its arenas across instances, and each instance is solved by
+// one worker within a time budget. Instances are dealt out to per-worker deques, largest files first;
+// a worker takes from the front of its own deque and, once it is empty, steals from the back of the
+// fullest other deque, so long instances don't leave the other workers idle.
+
+// One instance and, once it has run, its outcome.
+typedef struct {
+    char* path;
+    long long file_size;
+    int N;
+    int constraint_count;
+    int worker;             // that ran it, 1-based
+    bool infeasible;        // rejected by the pre-check, without a search
+    const char* error;      // why it could not be loaded, NULL if it was
+    solve_result_t result;
+} batch_instance_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    int* items;     // instance ids, items[head ... tail-1] are left
+    int head, tail;
+} batch_deque_t;
+
+typedef struct {
+    batch_instance_t* instances;
+    int instance_count;
+    batch_deque_t* deques;
+    int num_workers;
+    atomic_llong steals;
+    atomic_int done;
+
+    const solver_config_t* config;  // with the per-instance time limit
+    // the -f and -s files, read once for all the instances over their largest point: an instance
+    // with fewer points fails
+    int max_point;
+    bool* is_point_fixed;           // max_point
+    Point* fixed_points;            // max_point
+    Symmetry symmetry;              // read-only, shared by the workers
+    int seed;
+    int precheck;           // PRECHECK_OFF, _ON or _FULL
+    pthread_mutex_t print_mutex;
+} batch_t;
+
+typedef struct {
+    batch_t* batch;
+    int worker;     // 0-based
+} batch_worker_t;
+
+static int batch_pop_front(batch_deque_t* deque) {
+    pthread_mutex_lock(&deque->lock);
+    int id = deque->head < deque->tail ? deque->items[deque->head++] : -1;
+    pthread_mutex_unlock(&deque->lock);
+    return id;
+}
+
+static int batch_pop_back(batch_deque_t* deque) {
+    pthread_mutex_lock(&deque->lock);
+    int id = deque->head < deque->tail ? deque->items[--deque->tail] : -1;
+    pthread_mutex_unlock(&deque->lock);
+    return id;
+}
+
+// Next instance for `worker`: its own, or one stolen from the fullest other deque. -1 when all are taken.
+static int batch_next_instance(batch_t* batch, int worker) {
+    int id = batch_pop_front(&batch->deques[worker]);
+    while (id == -1) {
+        int victim = -1, most = 0;
+        for (int w = 0; w < batch->num_workers; w++) {
+            batch_deque_t* deque = &batch->deques[w];
+            pthread_mutex_lock(&deque->lock);
+            int left = deque->tail - deque->head;
+            pthread_mutex_unlock(&deque->lock);
+            if (w != worker && left > most) {
+                victim = w;
+                most = left;
+            }
+        }
+        if (victim == -1) {
+            return -1;
+        }
+        id = batch_pop_back(&batch->deques[victim]);
+        if (id != -1) {
+            atomic_fetch_add_explicit(&batch->steals, 1, memory_order_relaxed);
+        }
+    }
+    return id;
+}
+
+// Path of the solution file of an instance: the input path followed by .real.
+static char* batch_output_path(const char* path) {
+    char* output = malloc(strlen(path) + 6);
+    strcpy(output, path);
+    strcat(output, ".real");
+    return output;
+}
+
+// Loads and solves one instance on the calling worker, reusing its arena. An instance that cannot be
+// loaded is reported as failed, and the other instances go on.
+static void batch_run_instance(batch_t* batch, int id, int worker, arena_t* arena) {
+    batch_instance_t* instance = &batch->instances[id];
+    instance->worker = worker + 1;
+    Problem problem;
+    instance->error = read_orientations(instance->path, &problem);
+    if (instance->error == NULL) {
+        instance->N = problem.N;
+        instance->constraint_count = problem.constraint_count;
+        if (problem.N < batch->max_point) {
+            instance->error = "fewer points than the fixed points or symmetry files name";
+            problem_free(&problem);
+        }
+    }
+    if (instance->error != NULL) {
+        int done = atomic_fetch_add(&batch->done, 1) + 1;
+        pthread_mutex_lock(&batch->print_mutex);
+        color_printf(YELLOW, "[%d/%d] ", done, batch->instance_count);
+        printf("%s: ", instance->path);
+        color_printf(RED, "failed");
+        printf(" (%s) (worker %d)\n", instance->error, worker + 1);
+        pthread_mutex_unlock(&batch->print_mutex);
+        char* output = batch_output_path(instance->path);
+        unlink(output);
+        free(output);
+        return;
+    }
+    int N = problem.N;
+
+    // each worker checks its own instances, on its own thread
+    precheck_result_t precheck;
+    if (batch->precheck != PRECHECK_OFF && !precheck_run(&problem, 1, batch->precheck == PRECHECK_FULL, &precheck)) {
+        instance->infeasible = true;
+        instance->result = (solve_result_t){ false, 0, precheck.seconds };
+        int done = atomic_fetch_add(&batch->done, 1) + 1;
+        pthread_mutex_lock(&batch->print_mutex);
+        color_printf(YELLOW, "[%d/%d] ", done, batch->instance_count);
+        printf("%s: ", instance->path);
+        color_printf(RED, "infeasible");
+        printf(" (%s axiom) in %.3f s (worker %d)\n", precheck.axiom, precheck.seconds, worker + 1);
+        pthread_mutex_unlock(&batch->print_mutex);
+        char* output = batch_output_path(instance->path);
+        unlink(output);
+        free(output);
+        problem_free(&problem);
+        return;
+    }
+
+    bool* is_point_fixed = calloc(N, sizeof(bool));
+    Point* fixed_points = calloc(N, sizeof(Point));
+    memcpy(is_point_fixed, batch->is_point_fixed, batch->max_point * sizeof(bool));
+    memcpy(fixed_points, batch->fixed_points, batch->max_point * sizeof(Point));
+    orbit_index_t orbit_index;
+    const orbit_index_t* orbits = NULL;
+    if (batch->symmetry.num_cycles > 0) {
+        orbit_index_build(&orbit_index, &problem, &batch->symmetry);
+        orbits = &orbit_index;
+    }
+
+    size_t bytes = solver_workspace_bytes(&problem, batch->config, orbits);
+    if (arena->size < arena_round(bytes)) {
+        arena_free(arena);
+        arena_init(arena, bytes);
+    }
+
+    // seeded by instance, so that results don't depend on the schedule
+    rng_t rng;
+    rng_init(&rng, batch->seed + id);
+    synchronization_t sync;
+    sync_init(&sync, N);
+    Point* points = calloc(N, sizeof(Point));
+    char* output = batch_output_path(instance->path);
+    unlink(output); // no stale solution for an instance left unsolved
+
+    instance->result = solve(&problem, batch->config, points, output, worker + 1, &sync, &rng, arena,
+        is_point_fixed, fixed_points, &batch->symmetry, orbits, NULL, NULL);
+
+    int done = atomic_fetch_add(&batch->done, 1) + 1;
+    pthread_mutex_lock(&batch->print_mutex);
+    color_printf(YELLOW, "[%d/%d] ", done, batch->instance_count);
+    printf("%s: ", instance->path);
+    if (instance->result.solved) {
+        color_printf(GREEN, "solved");
+    } else {
+        color_printf(RED, "unsolved");
+    }
+    printf(" in %.3f s, %lld iterations (worker %d)\n", instance->result.seconds, instance->result.iterations, worker + 1);
+    pthread_mutex_unlock(&batch->print_mutex);
+
+    free(output);
+    free(points);
+    sync_destroy(&sync);
+    if (orbits != NULL) {
+        orbit_index_free(&orbit_index);
+    }
+    free(is_point_fixed);
+    free(fixed_points);
+    problem_free(&problem);
+}
+
+static void* batch_worker(void* arg) {
+    batch_worker_t* params = arg;
+    arena_t arena = { NULL, 0, 0 };
+    int id;
+    while ((id = batch_next_instance(params->batch, params->worker)) != -1) {
+        batch_run_instance(params->batch, id, params->worker, &arena);
+    }
+    arena_free(&arena);
+    return NULL;
+}
+
+static bool has_suffix(const char* s, const char* suffix) {
+    size_t n = strlen(s), m = strlen(suffix);
+    return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+static int compare_paths(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+// Instances of a directory (its .or and .orb files, in name order) or of a list file (one path per line).
+char** batch_collect_paths(const char* source, int* count) {
+    int capacity = 16;
+    char** paths = malloc(capacity * sizeof(char*));
+    *count = 0;
+
+    struct stat st;
+    if (stat(source, &st) != 0) {
+        printf("Error opening %s\n", source);
+        exit(1);
+    }
+    if (S_ISDIR(st.st_mode)) {
+        DIR* dir = opendir(source);
+        if (dir == NULL) {
+            printf("Error opening directory %s\n", source);
+            exit(1);
+        }
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (!has_suffix(entry->d_name, ".or") && !has_suffix(entry->d_name, ".orb")) {
+                continue;
+            }
+            if (*count == capacity) {
+                capacity *= 2;
+                paths = realloc(paths, capacity * sizeof(char*));
+            }
+            char* path = malloc(strlen(source) + strlen(entry->d_name) + 2);
+            sprintf(path, "%s/%s", source, entry->d_name);
+            paths[(*count)++] = path;
+        }
+        closedir(dir);
+        qsort(paths, *count, sizeof(char*), compare_paths);
+    } else {
+        FILE* file = fopen(source, "r");
+        if (file == NULL) {
+            printf("Error opening %s\n", source);
+            exit(1);
+        }
+        char line[4096];
+        while (fgets(line, sizeof(line), file) != NULL) {
+            line[strcspn(line, "\r\n")] = '\0';
+            if (line[0] == '\0' || line[0] == '#') {
+                continue;
+            }
+            if (*count == capacity) {
+                capacity *= 2;
+                paths = realloc(paths, capacity * sizeof(char*));
+            }
+            paths[(*count)++] = strdup(line);
+        }
+        fclose(file);
+    }
+    return paths;
+}
+
+// Largest point index (1-based) that a fixed points file ("idx:x,y" lines) or, if `symmetry`, a
+// symmetry file (the points of each orbit, on one line) names. 0 for no file.
+static int batch_max_point(const char* path, bool symmetry) {
+    if (path == NULL || strlen(path) == 0) {
+        return 0;
+    }
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        return 0; // reported by the parser
+    }
+    int max_point = 0;
+    char line[MAX_LINE_LENGTH];
+    while (fgets(line, sizeof(line), file)) {
+        char* ptr = line;
+        int num, chr_cnt;
+        double x, y;
+        if (!symmetry) {
+            if (sscanf(line, "%d:%lf,%lf", &num, &x, &y) == 3 && num > max_point) {
+                max_point = num;
+            }
+            continue;
+        }
+        while (*ptr && sscanf(ptr, "%d%n", &num, &chr_cnt) == 1) {
+            max_point = num > max_point ? num : max_point;
+            ptr += chr_cnt;
+        }
+    }
+    fclose(file);
+    return max_point;
+}
+
+static void json_print_string(FILE* file, const char* s) {
+    fputc('"', file);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') {
+            fputc('\\', file);
+        }
+        fputc(*s, file);
+    }
+    fputc('"', file);
+}
+
+// Machine-readable summary of a batch: one entry per instance, in input order.
+static void batch_write_summary(const batch_t* batch, const char* summary_file, double wall_time) {
+    FILE* file = fopen(summary_file, "w");
+    if (file == NULL) {
+        printf("Error opening file %s\n", summary_file);
+        exit(1);
+    }
+    int solved = 0, infeasible = 0, failed = 0;
+    for (int i = 0; i < batch->instance_count; i++) {
+        solved += batch->instances[i].result.solved;
+        infeasible += batch->instances[i].infeasible;
+        failed += batch->instances[i].error != NULL;
+    }
+    fprintf(file, "{\n  \"instances\": %d,\n  \"solved\": %d,\n  \"infeasible\": %d,\n  \"failed\": %d,\n  \"workers\": %d,\n"
+        "  \"time_limit\": %g,\n  \"wall_time\": %.3f,\n  \"steals\": %lld,\n  \"results\": [\n",
+        batch->instance_count, solved, infeasible, failed, batch->num_workers, batch->config->time_limit, wall_time,
+        (long long)atomic_load(&batch->steals));
+    for (int i = 0; i < batch->instance_count; i++) {
+        const batch_instance_t* instance = &batch->instances[i];
+        fprintf(file, "    {\"file\": ");
+        json_print_string(file, instance->path);
+        fprintf(file, ", \"N\": %d, \"constraints\": %d, \"solved\": %s, \"infeasible\": %s, \"time\": %.3f, \"iterations\": %lld, \"worker\": %d",
+            instance->N, instance->constraint_count, instance->result.solved ? "true" : "false", instance->infeasible ? "true" : "false",
+            instance->result.seconds, instance->result.iterations, instance->worker);
+        if (instance->error != NULL) {
+            fprintf(file, ", \"error\": ");
+            json_print_string(file, instance->error);
+        }
+        if (instance->result.solved) {
+            char* output = batch_output_path(instance->path);
+            fprintf(file, ", \"output\": ");
+            json_print_string(file, output);
+            free(output);
+        }
+        fprintf(file, "}%s\n", i + 1 < batch->instance_count ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+}
+
+// Runs every instance on `num_workers` threads and writes the summary. Returns the number solved.
+// The fixed points and symmetry files are parsed here, once, before the workers start.
+int run_batch(char** paths, int count, int num_workers, const solver_config_t* config,
+    const char* fixed_points_file, const char* symmetry_file, int seed, int precheck, const char* summary_file) {
+    batch_t batch;
+    batch.instances = calloc(count > 0 ? count : 1, sizeof(batch_instance_t));
+    batch.instance_count = count;
+    batch.num_workers = num_workers;
+    batch.config = config;
+    int fixed_max = batch_max_point(fixed_points_file, false), symmetry_max = batch_max_point(symmetry_file, true);
+    batch.max_point = fixed_max > symmetry_max ? fixed_max : symmetry_max;
+    batch.is_point_fixed = calloc(batch.max_point > 0 ? batch.max_point : 1, sizeof(bool));
+    batch.fixed_points = calloc(batch.max_point > 0 ? batch.max_point : 1, sizeof(Point));
+    parse_fixed_points(fixed_points_file, batch.max_point, batch.fixed_points, batch.is_point_fixed);
+    parse_symmetry(symmetry_file, batch.max_point, &batch.symmetry);
+    batch.seed = seed;
+    batch.precheck = precheck;
+    atomic_init(&batch.steals, 0);
+    atomic_init(&batch.done, 0);
+    pthread_mutex_init(&batch.print_mutex, NULL);
+
+    // deal the largest instances first, round robin (stable insertion sort by file size)
+    int* order = malloc((count > 0 ? count : 1) * sizeof(int));
+    for (int i = 0; i < count; i++) {
+        struct stat st;
+        batch.instances[i].path = paths[i];
+        batch.instances[i].file_size = stat(paths[i], &st) == 0 ? st.st_size : 0;
+        int pos = i;
+        while (pos > 0 && batch.instances[order[pos-1]].file_size < batch.instances[i].file_size) {
+            order[pos] = order[pos-1];
+            pos--;
+        }
+        order[pos] = i;
+    }
+    batch.deques = calloc(num_workers, sizeof(batch_deque_t));
+    for (int w = 0; w < num_workers; w++) {
+        pthread_mutex_init(&batch.deques[w].lock, NULL);
+        batch.deques[w].items = malloc((count / num_workers + 1) * sizeof(int));
+    }
+    for (int i = 0; i < count; i++) {
+        batch_deque_t* deque = &batch.deques[i % num_workers];
+        deque->items[deque->tail++] = order[i];
+    }
+
+    struct timespec start = get_time();
+    pthread_t* threads = malloc(num_workers * sizeof(pthread_t));
+    batch_worker_t* workers = malloc(num_workers * sizeof(batch_worker_t));
+    for (int w = 0; w < num_workers; w++) {
+        workers[w] = (batch_worker_t){ &batch, w };
+        if (pthread_create(&threads[w], NULL, batch_worker, &workers[w]) != 0) {
+            perror("Failed to create thread");
+            exit(1);
+        }
+    }
+    for (int w = 0; w < num_workers; w++) {
+        pthread_join(threads[w], NULL);
+    }
+    double wall_time = elapsed_time_sec(start, get_time());
+
+    batch_write_summary(&batch, summary_file, wall_time);
+    int solved = 0, infeasible = 0, failed = 0;
+    for (int i = 0; i < count; i++) {
+        solved += batch.instances[i].result.solved;
+        infeasible += batch.instances[i].infeasible;
+        failed += batch.instances[i].error != NULL;
+    }
+    color_printf(YELLOW, "\nBatch");
+    printf(": %d of %d instances solved (%d infeasible, %d failed) in %.3f s on %d workers (%lld steals), summary saved to %s\n",
+        solved, count, infeasible, failed, wall_time, num_workers, (long long)atomic_load(&batch.steals), summary_file);
+
+    for (int w = 0; w < num_workers; w++) {
+        pthread_mutex_destroy(&batch.deques[w].lock);
+        free(batch.deques[w].items);
+    }
+    pthread_mutex_destroy(&batch.print_mutex);
+    symmetry_free(&batch.symmetry);
+    free(batch.is_point_fixed);
+    free(batch.fixed_points);
+    free(batch.deques);
+    free(threads);
+    free(workers);
+    free(order);
+    free(batch.instances);
+    return solved;
+}
+
+#endif // BATCH_H
@@ -0,0 +1,366 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "utils.c"
+#include "solver.c"
+#include "threading.c"
+#include "rng.c"
+
+// Micro-benchmarks of the hot paths, built and run by `make bench`.
+// Every benchmark runs on synthetic complete instances (random point sets, or random signs for the
+// solver so that it never finishes early) for a sweep of N, repeating its operation for a fixed time.
+// A summary is printed and the results are written as JSON: ns/op, plus constraints/s for the
+// evaluations and moves/s for the move paths.
+
+#define BENCH_REPS 256 // operations between two clock reads
+
+static const int bench_sizes[] = { 10, 20, 40, 80, 160 };
+
+// What one benchmark touches. The benchmark functions run `reps` operations and return the number
+// of constraints they evaluated.
+typedef struct {
+    const Problem* problem;
+    Point* points;
+    double* x;
+    double* y;
+    unsigned char* violated;
+    int* violations_per_point;
+    violation_state_t* vs;
+    int* changed;
+    int* weights;
+    Symmetry* symmetry;
+    rng_t* rng;
+    int next_point;
+    volatile double sink;
+} bench_context_t;
+
+typedef long long (*bench_fn_t)(bench_context_t* context, int reps);
+
+typedef struct {
+    const char* name;
+    const char* kernel;    // full evaluation kernel in use
+    int N;
+    int constraint_count;
+    long long ops;
+    long long constraints; // constraints evaluated, 0 if not an evaluation
+    long long moves;       // moves scored, 0 if not a move path
+    double seconds;
+} bench_result_t;
+
+typedef struct {
+    bench_result_t* items;
+    int count;
+    int capacity;
+} bench_results_t;
+
+static void bench_add(bench_results_t* results, bench_result_t result) {
+    if (results->count == results->capacity) {
+        results->capacity = results->capacity ? 2 * results->capacity : 32;
+        results->items = realloc(results->items, results->capacity * sizeof(bench_result_t));
+    }
+    results->items[results->count++] = result;
+
+    color_printf(YELLOW, "%-22s", result.name);
+    printf(" N=%-4d %-7s %12.1f ns/op", result.N, result.kernel, result.seconds * 1e9 / result.ops);
+    if (result.constraints > 0) {
+        printf("  %8.1f Mconstraints/s", result.constraints / result.seconds / 1e6);
+    }
+    if (result.moves > 0) {
+        printf("  %8.3f Mmoves/s", result.moves / result.seconds / 1e6);
+    }
+    printf("\n");
+}
+
+// Runs fn in rounds of `reps` operations for at least `seconds`.
+static bench_result_t bench_run(const char* name, bench_fn_t fn, bench_context_t* context, int reps, double seconds) {
+    bench_result_t result = { name, eval_kernel.name, context->problem->N, context->problem->constraint_count, 0, 0, 0, 0.0 };
+    fn(context, reps); // warm-up
+    struct timespec start = get_time();
+    do {
+        result.constraints += fn(context, reps);
+        result.ops += reps;
+        result.seconds = elapsed_time_sec(start, get_time());
+    } while (result.seconds < seconds);
+    return result;
+}
+
+static long long bench_evaluate_full(bench_context_t* context, int reps) {
+    int total_violations, point_with_max_violations;
+    double min_distance;
+    for (int r = 0; r < reps; r++) {
+        evaluate(context->points, context->problem, 0, &total_violations, context->violations_per_point,
+            &point_with_max_violations, &min_distance, -1);
+        context->sink += total_violations;
+    }
+    return (long long)reps * context->problem->constraint_count;
+}
+
+static long long bench_evaluate_point(bench_context_t* context, int reps) {
+    int total_violations, point_with_max_violations;
+    double min_distance;
+    long long constraints = 0;
+    for (int r = 0; r < reps; r++) {
+        int p = context->next_point;
+        context->next_point = (p + 1) % context->problem->N;
+        evaluate(context->points, context->problem, 0, &total_violations, context->violations_per_point,
+            &point_with_max_violations, &min_distance, p);
+        context->sink += total_violations;
+        constraints += problem_degree(context->problem, p);
+    }
+    return constraints;
+}
+
+static long long bench_eval_kernel(bench_context_t* context, int reps) {
+    const Problem* problem = context->problem;
+    for (int r = 0; r < reps; r++) {
+        context->sink += eval_kernel.fn(&problem->columns, problem->constraint_count, context->x, context->y, context->violated);
+    }
+    return (long long)reps * problem->constraint_count;
+}
+
+// The move path of the solver: a random candidate for a random point, scored incrementally.
+static long long bench_score_move(bench_context_t* context, int reps) {
+    const Problem* problem = context->problem;
+    long long constraints = 0;
+    for (int r = 0; r < reps; r++) {
+        int p = context->next_point;
+        context->next_point = (p + 1) % problem->N;
+        Point candidate = random_point_in_ball(context->points[p], 1.0, context->rng);
+        int changed_count;
+        context->sink += vstate_score_move(context->vs, problem, context->points, p, candidate, context->changed, &changed_count);
+        constraints += problem_degree(problem, p);
+    }
+    return constraints;
+}
+
+static long long bench_det(bench_context_t* context, int reps) {
+    const Point* points = context->points;
+    int N = context->problem->N;
+    double sum = 0.0;
+    for (int r = 0; r < reps; r++) {
+        int i = r % N;
+        sum += det(points[i], points[(i + 1) % N], points[(i + 2) % N]);
+    }
+    context->sink += sum;
+    return 0;
+}
+
+static long long bench_sample_proportional(bench_context_t* context, int reps) {
+    int sum = 0;
+    for (int r = 0; r < reps; r++) {
+        sum += sample_proportional(context->weights, context->problem->N, context->rng);
+    }
+    context->sink += sum;
+    return 0;
+}
+
+static long long bench_random_point_in_ball(bench_context_t* context, int reps) {
+    double sum = 0.0;
+    for (int r = 0; r < reps; r++) {
+        sum += random_point_in_ball(context->points[r % context->problem->N], 1.0, context->rng).x;
+    }
+    context->sink += sum;
+    return 0;
+}
+
+// Batched sampling, as for the candidates of a multi-candidate move: 8 offsets per operation.
+static long long bench_disk_offsets(bench_context_t* context, int reps) {
+    double dx[8], dy[8];
+    double sum = 0.0;
+    for (int r = 0; r < reps; r++) {
+        rng_disk_offsets(context->rng, 1.0, dx, dy, 8);
+        sum += dx[r % 8] + dy[r % 8];
+    }
+    context->sink += sum;
+    return 0;
+}
+
+static long long bench_enforce_symmetry(bench_context_t* context, int reps) {
+    for (int r = 0; r < reps; r++) {
+        enforce_symmetry(context->symmetry, context->points);
+    }
+    context->sink += context->points[0].x;
+    return 0;
+}
+
+// A complete instance over N points: the chirotope of random points or, if !realizable, random signs.
+static void bench_problem(Problem* problem, int N, bool realizable, rng_t* rng) {
+    Point* points = malloc(N * sizeof(Point));
+    generate_random_assignment(N, points, rng);
+    problem->N = N;
+    problem->constraint_count = 0;
+    problem->constraints = malloc(triples_below(N) * sizeof(Constraint));
+    for (int i = 1; i <= N; i++) {
+        for (int j = i + 1; j <= N; j++) {
+            for (int k = j + 1; k <= N; k++) {
+                int sign = realizable ? (det(points[i-1], points[j-1], points[k-1]) > 0 ? 1 : -1)
+                                      : (rng_double(rng) < 0.5 ? 1 : -1);
+                problem->constraints[problem->constraint_count++] = (Constraint){ i, j, k, sign };
+            }
+        }
+    }
+    problem_build_index(problem);
+    free(points);
+}
+
+// A 5-fold rotational symmetry over the first 5 * (N / 5) points.
+static void bench_symmetry(Symmetry* symmetry, int N) {
+    symmetry->num_cycles = N / 5;
+    symmetry->cycles = malloc((symmetry->num_cycles > 0 ? symmetry->num_cycles : 1) * sizeof(int*));
+    symmetry->cycle_lengths = malloc((symmetry->num_cycles > 0 ? symmetry->num_cycles : 1) * sizeof(int));
+    int* buffer = malloc(N * sizeof(int));
+    for (int c = 0; c < symmetry->num_cycles; c++) {
+        symmetry->cycles[c] = buffer + 5 * c;
+        symmetry->cycle_lengths[c] = 5;
+        for (int m = 0; m < 5; m++) {
+            buffer[5 * c + m] = 5 * c + m;
+        }
+    }
+    if (symmetry->num_cycles == 0) {
+        free(buffer);
+    }
+}
+
+// The evaluation, move and utility benchmarks on one realizable instance.
+static void bench_kernels(bench_results_t* results, int N, double seconds, rng_t* rng) {
+    Problem problem;
+    bench_problem(&problem, N, true, rng);
+    eval_kernel_init(&problem, rng);
+
+    Point* points = malloc(N * sizeof(Point));
+    generate_random_assignment(N, points, rng);
+    arena_t arena;
+    arena_init(&arena, vstate_bytes(N, problem.constraint_count));
+    violation_state_t vs;
+    vstate_init(&vs, N, problem.constraint_count, NULL, NULL, &arena);
+    vstate_rebuild(&vs, &problem, points);
+    Symmetry symmetry;
+    bench_symmetry(&symmetry, N);
+
+    bench_context_t context = {
+        .problem = &problem,
+        .points = points,
+        .x = vs.x,
+        .y = vs.y,
+        .violated = malloc(problem.constraint_count),
+        .violations_per_point = malloc(N * sizeof(int)),
+        .vs = &vs,
+        .changed = malloc(problem_max_degree(&problem) * sizeof(int)),
+        .weights = malloc(N * sizeof(int)),
+        .symmetry = &symmetry,
+        .rng = rng,
+        .next_point = 0,
+        .sink = 0.0,
+    };
+    for (int p = 0; p < N; p++) {
+        context.weights[p] = rng_double(rng) * 50;
+    }
+
+    bench_add(results, bench_run("evaluate_full", bench_evaluate_full, &context, 1, seconds));
+    bench_add(results, bench_run("evaluate_point", bench_evaluate_point, &context, BENCH_REPS, seconds));
+    bench_add(results, bench_run("eval_kernel", bench_eval_kernel, &context, 1, seconds));
+    bench_result_t move = bench_run("score_move", bench_score_move, &context, BENCH_REPS, seconds);
+    move.moves = move.ops;
+    bench_add(results, move);
+    bench_add(results, bench_run("det", bench_det, &context, BENCH_REPS, seconds));
+    bench_add(results, bench_run("sample_proportional", bench_sample_proportional, &context, BENCH_REPS, seconds));
+    bench_add(results, bench_run("random_point_in_ball", bench_random_point_in_ball, &context, BENCH_REPS, seconds));
+    bench_add(results, bench_run("disk_offsets_x8", bench_disk_offsets, &context, BENCH_REPS, seconds));
+    bench_add(results, bench_run("enforce_symmetry", bench_enforce_symmetry, &context, BENCH_REPS, seconds));
+
+    free(context.violated);
+    free(context.violations_per_point);
+    free(context.changed);
+    free(context.weights);
+    symmetry_free(&symmetry);
+    arena_free(&arena);
+    free(points);
+    problem_free(&problem);
+}
+
+// The solver's main loop on an instance with random signs, which it never solves, for `seconds`.
+// An operation is one sub-iteration, i.e. one move, with the resets amortized over them.
+static void bench_solve(bench_results_t* results, int N, double seconds, rng_t* rng) {
+    Problem problem;
+    bench_problem(&problem, N, false, rng);
+    eval_kernel_init(&problem, rng);
+
+    solver_config_t config = solver_config_default();
+    config.time_limit = seconds;
+    config.quiet = true;
+    arena_t arena;
+    arena_init(&arena, solver_workspace_bytes(&problem, &config, NULL));
+    synchronization_t sync;
+    sync_init(&sync, N);
+    bool* is_point_fixed = calloc(N, sizeof(bool));
+    Point* fixed_points = calloc(N, sizeof(Point));
+    Point* points = calloc(N, sizeof(Point));
+    Symmetry symmetry = { NULL, NULL, 0 };
+
+    solve_result_t solved = solve(&problem, &config, points, "/dev/null", 0, &sync, rng, &arena,
+        is_point_fixed, fixed_points, &symmetry, NULL, NULL, NULL);
+    long long moves = solved.iterations * config.sub_iterations;
+    bench_add(results, (bench_result_t){ "solve_sub_iteration", eval_kernel.name, N, problem.constraint_count, moves, 0, moves, solved.seconds });
+
+    free(points);
+    free(fixed_points);
+    free(is_point_fixed);
+    sync_destroy(&sync);
+    arena_free(&arena);
+    problem_free(&problem);
+}
+
+static void bench_write_json(const bench_results_t* results, const char* path, double seconds) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        printf("Error opening file %s\n", path);
+        exit(1);
+    }
+    fprintf(file, "{\n  \"seconds_per_benchmark\": %g,\n  \"results\": [\n", seconds);
+    for (int r = 0; r < results->count; r++) {
+        const bench_result_t* result = &results->items[r];
+        fprintf(file, "    {\"name\": \"%s\", \"kernel\": \"%s\", \"N\": %d, \"constraints\": %d, \"ops\": %lld, \"seconds\": %.6f, \"ns_per_op\": %.3f",
+            result->name, result->kernel, result->N, result->constraint_count, result->ops, result->seconds, result->seconds * 1e9 / result->ops);
+        if (result->constraints > 0) {
+            fprintf(file, ", \"constraints_per_s\": %.0f", result->constraints / result->seconds);
+        }
+        if (result->moves > 0) {
+            fprintf(file, ", \"moves_per_s\": %.0f", result->moves / result->seconds);
+        }
+        fprintf(file, "}%s\n", r + 1 < results->count ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+}
+
+int main(int argc, char* argv[]) {
+    double seconds = 0.2;
+    const char* output = "bench_results.json";
+    int seed = 42;
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "-d") == 0 && a + 1 < argc) {
+            seconds = atof(argv[++a]);
+        } else if (strcmp(argv[a], "-o") == 0 && a + 1 < argc) {
+            output = argv[++a];
+        } else if (strcmp(argv[a], "-s") == 0 && a + 1 < argc) {
+            seed = atoi(argv[++a]);
+        } else {
+            printf("Usage: %s [-d <seconds per benchmark>] [-o <output.json>] [-s <seed>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    rng_t rng;
+    rng_init(&rng, seed);
+    bench_results_t results = { NULL, 0, 0 };
+    for (size_t n = 0; n < sizeof(bench_sizes) / sizeof(bench_sizes[0]); n++) {
+        bench_kernels(&results, bench_sizes[n], seconds, &rng);
+        bench_solve(&results, bench_sizes[n], seconds, &rng);
+    }
+    bench_write_json(&results, output, seconds);
+    color_printf(GREEN, "Results written to %s\n", output);
+    free(results.items);
+    return 0;
+}
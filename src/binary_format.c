@@ -0,0 +1,329 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <getopt.h>
+#include "utils.c"
+#include "generator.c"
+
+#ifndef BINARY_FORMAT_H
+#define BINARY_FORMAT_H
+
+// Compiled (binary) orientation files, written by `localizer compile`.
+// A 32-byte header is followed by either
+// - the constraint columns, in file order: count x int32 i, j, k (0-based), then count x int8 signs.
+//   They are memory-mapped as is, so processes loading the same file share its pages;
+// - or, for a complete chirotope (every triple i < j < k exactly once), 2 bits per triple indexed by
+//   the colex rank of the triple, 4 triples per byte: 1 = A, 2 = B, 3 = C.
+// All values are little-endian.
+#define BINARY_MAGIC "LOCB"
+#define BINARY_VERSION 1
+#define BINARY_COMPLETE 0x1 // flag: 2-bit chirotope layout
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t N;
+    uint32_t flags;
+    uint64_t count;     // number of constraints
+    uint64_t reserved;
+} binary_header_t;
+
+// Whether the problem lists every triple i < j < k exactly once.
+bool problem_is_complete(const Problem* problem) {
+    int64_t total = triples_below(problem->N);
+    if (problem->constraint_count != total) {
+        return false;
+    }
+    unsigned char* seen = calloc(total > 0 ? total : 1, 1);
+    bool complete = true;
+    for (int c = 0; c < problem->constraint_count && complete; c++) {
+        const Constraint* constraint = &problem->constraints[c];
+        if (!(constraint->i < constraint->j && constraint->j < constraint->k)) {
+            complete = false;
+            break;
+        }
+        int64_t rank = colex_rank(constraint->i - 1, constraint->j - 1, constraint->k - 1);
+        complete = !seen[rank];
+        seen[rank] = 1;
+    }
+    free(seen);
+    return complete;
+}
+
+static void write_or_die(const void* data, size_t size, FILE* file) {
+    if (size > 0 && fwrite(data, size, 1, file) != 1) {
+        printf("Error writing binary orientation file\n");
+        exit(1);
+    }
+}
+
+// Writes the problem as a binary orientation file. Returns whether the chirotope layout was used.
+bool write_binary_orientations(const Problem* problem, const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) {
+        printf("Error opening file %s\n", path);
+        exit(1);
+    }
+
+    bool complete = problem_is_complete(problem);
+    binary_header_t header = {
+        .magic = BINARY_MAGIC,
+        .version = BINARY_VERSION,
+        .N = problem->N,
+        .flags = complete ? BINARY_COMPLETE : 0,
+        .count = problem->constraint_count,
+        .reserved = 0,
+    };
+    write_or_die(&header, sizeof(header), file);
+
+    size_t count = problem->constraint_count;
+    if (complete) {
+        size_t bytes = (count + 3) / 4;
+        unsigned char* packed = calloc(bytes > 0 ? bytes : 1, 1);
+        for (size_t c = 0; c < count; c++) {
+            const Constraint* constraint = &problem->constraints[c];
+            int64_t rank = colex_rank(constraint->i - 1, constraint->j - 1, constraint->k - 1);
+            unsigned code = constraint->sign == 1 ? 1 : constraint->sign == -1 ? 2 : 3;
+            packed[rank / 4] |= code << (2 * (rank % 4));
+        }
+        write_or_die(packed, bytes, file);
+        free(packed);
+    } else {
+        write_or_die(problem->columns.i, count * sizeof(int32_t), file);
+        write_or_die(problem->columns.j, count * sizeof(int32_t), file);
+        write_or_die(problem->columns.k, count * sizeof(int32_t), file);
+        write_or_die(problem->columns.sign, count * sizeof(int8_t), file);
+    }
+
+    if (fclose(file) != 0) {
+        printf("Error writing binary orientation file\n");
+        exit(1);
+    }
+    return complete;
+}
+
+// Whether the file starts with the binary magic.
+bool is_binary_orientation_file(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    char magic[4];
+    bool binary = fread(magic, sizeof(magic), 1, file) == 1 && memcmp(magic, BINARY_MAGIC, 4) == 0;
+    fclose(file);
+    return binary;
+}
+
+// Loads a binary orientation file without any text parsing: the file is memory-mapped and, in the
+// column layout, the constraint columns point straight into the mapping. Returns NULL, or what is
+// wrong with the file, as read_constraints.
+const char* load_binary_orientations(const char* path, Problem* problem) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return "cannot open the file";
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(binary_header_t)) {
+        close(fd);
+        return "invalid binary orientation file";
+    }
+    size_t size = st.st_size;
+    void* mapping = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return "cannot map the file";
+    }
+
+    binary_header_t header;
+    memcpy(&header, mapping, sizeof(header));
+    bool complete = header.flags & BINARY_COMPLETE;
+    size_t count = header.count;
+    size_t payload = complete ? (count + 3) / 4 : count * (3 * sizeof(int32_t) + sizeof(int8_t));
+    if (memcmp(header.magic, BINARY_MAGIC, 4) != 0 || header.version != BINARY_VERSION ||
+        count > INT32_MAX || size < sizeof(header) + payload ||
+        (complete && (int64_t)count != triples_below(header.N))) {
+        munmap(mapping, size);
+        return "invalid binary orientation file";
+    }
+
+    int N = header.N;
+    const unsigned char* data = (const unsigned char*)mapping + sizeof(header);
+    problem->N = N;
+    problem->constraint_count = count;
+    problem->constraints = malloc((count > 0 ? count : 1) * sizeof(Constraint));
+    // the index is built last: until then, problem_free only releases the constraints and columns
+    problem->point_offsets = NULL;
+    problem->point_constraints = NULL;
+    problem->chirotope = NULL;
+
+    if (complete) {
+        // expand the chirotope, in the lexicographic order of the text files
+        problem->columns.i = malloc((count > 0 ? count : 1) * sizeof(int32_t));
+        problem->columns.j = malloc((count > 0 ? count : 1) * sizeof(int32_t));
+        problem->columns.k = malloc((count > 0 ? count : 1) * sizeof(int32_t));
+        problem->columns.sign = malloc((count > 0 ? count : 1) * sizeof(int8_t));
+        int c = 0;
+        for (int i = 0; i < N; i++) {
+            for (int j = i + 1; j < N; j++) {
+                for (int k = j + 1; k < N; k++) {
+                    int64_t rank = colex_rank(i, j, k);
+                    unsigned code = (data[rank / 4] >> (2 * (rank % 4))) & 3;
+                    if (code == 0) {
+                        problem->mapping = NULL;
+                        problem_free(problem);
+                        munmap(mapping, size);
+                        return "invalid binary orientation file";
+                    }
+                    problem->columns.i[c] = i;
+                    problem->columns.j[c] = j;
+                    problem->columns.k[c] = k;
+                    problem->columns.sign[c] = code == 1 ? 1 : code == 2 ? -1 : 0;
+                    c++;
+                }
+            }
+        }
+        munmap(mapping, size);
+        problem->mapping = NULL;
+        problem->mapping_size = 0;
+    } else {
+        problem->columns.i = (int32_t*)data;
+        problem->columns.j = (int32_t*)(data + count * sizeof(int32_t));
+        problem->columns.k = (int32_t*)(data + 2 * count * sizeof(int32_t));
+        problem->columns.sign = (int8_t*)(data + 3 * count * sizeof(int32_t));
+        problem->mapping = mapping;
+        problem->mapping_size = size;
+    }
+
+    for (size_t c = 0; c < count; c++) {
+        int i = problem->columns.i[c], j = problem->columns.j[c], k = problem->columns.k[c];
+        if (i < 0 || j < 0 || k < 0 || i >= N || j >= N || k >= N) {
+            problem_free(problem);
+            return "invalid point index";
+        }
+        problem->constraints[c] = (Constraint){ i + 1, j + 1, k + 1, problem->columns.sign[c] };
+    }
+    problem_build_point_index(problem);
+    return NULL;
+}
+
+// Loads an orientation file, text or binary, or generates the instance of a "gen:" spec.
+// Returns NULL, or what is wrong with it, without printing.
+const char* read_orientations(const char* path, Problem* problem) {
+    if (is_generator_spec(path)) {
+        return load_generator_spec(path, problem);
+    } else if (is_binary_orientation_file(path)) {
+        return load_binary_orientations(path, problem);
+    } else {
+        return read_constraints(path, problem);
+    }
+}
+
+// As read_orientations, ending the process on an invalid file.
+void load_orientations(const char* path, Problem* problem) {
+    const char* error = read_orientations(path, problem);
+    if (error != NULL) {
+        printf("ERROR: %s: %s\n", path, error);
+        exit(1);
+    }
+}
+
+// `localizer compile <file.or> ...`: writes each file next to it as <file>.orb (or <file>b if it ends in .or).
+int compile_orientation_files(int count, char** paths) {
+    for (int f = 0; f < count; f++) {
+        const char* path = paths[f];
+        size_t length = strlen(path);
+        char* output = malloc(length + 8);
+        strcpy(output, path);
+        if (length >= 3 && strcmp(path + length - 3, ".or") == 0) {
+            strcat(output, "b");
+        } else {
+            strcat(output, ".orb");
+        }
+
+        struct timespec start = get_time();
+        Problem problem;
+        parse_constraints(path, &problem);
+        bool complete = write_binary_orientations(&problem, output);
+        color_printf(GREEN, "%s", output);
+        printf(": %d constraints over %d points, %s layout, %.1f ms\n", problem.constraint_count, problem.N,
+            complete ? "chirotope" : "column", elapsed_time_sec(start, get_time()) * 1000);
+
+        problem_free(&problem);
+        free(output);
+    }
+    return 0;
+}
+
+// `localizer generate <N> [-n count] [-s seed] [-g distribution] [-o directory] [-b]`: writes `count`
+// generated instances as <directory>/<i>.or (or .orb with -b), instance i drawn with seed + i.
+int generate_orientation_files(int argc, char** argv) {
+    int N = atoi(argv[0]);
+    int count = 1;
+    unsigned long long seed = 42;
+    int distribution = POINTS_UNIFORM;
+    bool binary = false;
+    char directory[256];
+    snprintf(directory, sizeof(directory), "benchmarks/%d", N);
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:g:o:b")) != -1) {
+        switch (opt) {
+            case 'n':
+                count = atoi(optarg);
+                break;
+            case 's':
+                seed = strtoull(optarg, NULL, 10);
+                break;
+            case 'g':
+                distribution = parse_distribution(optarg);
+                break;
+            case 'o':
+                snprintf(directory, sizeof(directory), "%s", optarg);
+                break;
+            case 'b':
+                binary = true;
+                break;
+            default:
+                return 1;
+        }
+    }
+    if (N < 3 || count < 1 || distribution < 0) {
+        printf("ERROR: expected generate <N >= 3> [-n count >= 1] [-s seed] [-g uniform|clustered|convex|degenerate] [-o directory] [-b]\n");
+        return 1;
+    }
+
+    // create the directory and its parents
+    char partial[256];
+    for (size_t c = 1; c <= strlen(directory); c++) {
+        if (directory[c] == '/' || directory[c] == '\0') {
+            snprintf(partial, sizeof(partial), "%.*s", (int)c, directory);
+            mkdir(partial, 0755);
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        char path[300];
+        snprintf(path, sizeof(path), "%s/%d.%s", directory, i, binary ? "orb" : "or");
+        struct timespec start = get_time();
+        Problem problem;
+        generate_problem(&problem, N, distribution, seed + i);
+        if (binary) {
+            write_binary_orientations(&problem, path);
+        } else {
+            write_text_orientations(&problem, path);
+        }
+        color_printf(GREEN, "%s", path);
+        printf(": %s, %d points, %d constraints, %.1f ms\n", distribution_names[distribution], N,
+            problem.constraint_count, elapsed_time_sec(start, get_time()) * 1000);
+        problem_free(&problem);
+    }
+    return 0;
+}
+
+#endif // BINARY_FORMAT_H
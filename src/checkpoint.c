@@ -0,0 +1,347 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+#include "utils.c"
+#include "evaluation.c"
+#include "solver.c"
+#include "threading.c"
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+// Checkpoints of the complete search state, for `--checkpoint` and `--resume`.
+// The solver threads publish their state (thread_state_t) every 1000 iterations; a background thread
+// serializes those states and the elite pool every `interval` seconds, to a temporary file renamed
+// over the checkpoint, so that the workers never wait on I/O and a crash never leaves a torn file.
+// Layout: a 64-byte header, K_TOP x (elite record, N points), then per thread (thread record, N points,
+// weight_count search weights).
+// All values are little-endian; the file is meant to be resumed on the machine that wrote it.
+#define CHECKPOINT_MAGIC "LOCK"
+#define CHECKPOINT_VERSION 7
+#define CHECKPOINT_INTERVAL 60.0 // seconds, by default
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t N;
+    uint32_t num_threads;
+    uint32_t k_top;
+    uint32_t predicate_exact;
+    uint64_t problem_hash;      // of the constraints, to refuse resuming on another instance
+    double predicate_absolute;
+    double predicate_relative;
+    int64_t restarts;           // over all the threads, which index the shared restart schedules
+    uint64_t reserved;
+} checkpoint_header_t;
+
+typedef struct {
+    int32_t violations;         // INT32_MAX for an empty slot
+    uint32_t reserved;
+} checkpoint_elite_t;
+
+typedef struct {
+    // the thread's configuration
+    int32_t sub_iterations;
+    int32_t num_candidates;
+    int32_t portfolio_entry;
+    int32_t valid;              // 0 if the thread had not published a state yet
+    int64_t config_reset_its;
+    double min_dist;
+    double reset_multiplier;
+    double final_radius;
+    double min_radius;
+    double relocate;
+    // its search state
+    uint64_t rng_state[4];
+    int64_t iterations;
+    int64_t its_since_checkpoint;
+    int64_t reset_its;
+    int32_t violations;
+    int32_t engine;             // of the configuration
+    int32_t weight_bump_its;
+    int32_t restart;
+    int32_t restart_schedule;
+    int32_t weight_count;       // search weights after the points, 0 without adaptive weighting
+} checkpoint_thread_t;
+
+typedef struct {
+    int N;
+    int num_threads;
+    uint64_t problem_hash;
+    solver_config_t* configs;   // per thread
+    thread_state_t* states;     // per thread
+    synchronization_t* sync;
+    char* path;
+    char* temp_path;
+    double interval;
+    thread_state_t scratch;     // the writer's copy of one thread state
+    Point* elite_points;
+    int written;                // checkpoints saved so far
+    atomic_bool done;
+    pthread_mutex_t write_mutex;
+    pthread_t thread;
+    bool started;
+} checkpoint_t;
+
+// FNV-1a over N and the constraints.
+uint64_t problem_hash(const Problem* problem) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    int32_t values[4] = { problem->N, problem->constraint_count, 0, 0 };
+    for (int c = -1; c < problem->constraint_count; c++) {
+        if (c >= 0) {
+            const Constraint* constraint = &problem->constraints[c];
+            values[0] = constraint->i;
+            values[1] = constraint->j;
+            values[2] = constraint->k;
+            values[3] = constraint->sign;
+        }
+        const unsigned char* bytes = (const unsigned char*)values;
+        for (size_t b = 0; b < sizeof(values); b++) {
+            hash = (hash ^ bytes[b]) * 0x100000001b3ULL;
+        }
+    }
+    return hash;
+}
+
+// Sets up the per-thread states of `num_threads` threads; the configurations are left to the caller.
+void checkpoint_init(checkpoint_t* checkpoint, const Problem* problem, int num_threads, synchronization_t* sync) {
+    checkpoint->N = problem->N;
+    checkpoint->num_threads = num_threads;
+    checkpoint->problem_hash = problem_hash(problem);
+    checkpoint->configs = calloc(num_threads, sizeof(solver_config_t));
+    checkpoint->states = aligned_alloc(_Alignof(thread_state_t), num_threads * sizeof(thread_state_t));
+    for (int t = 0; t < num_threads; t++) {
+        checkpoint->configs[t] = solver_config_default();
+        thread_state_init(&checkpoint->states[t], problem->N, problem->constraint_count);
+    }
+    checkpoint->sync = sync;
+    checkpoint->path = NULL;
+    checkpoint->temp_path = NULL;
+    checkpoint->interval = CHECKPOINT_INTERVAL;
+    thread_state_init(&checkpoint->scratch, problem->N, problem->constraint_count);
+    checkpoint->elite_points = calloc(problem->N, sizeof(Point));
+    checkpoint->written = 0;
+    atomic_init(&checkpoint->done, false);
+    pthread_mutex_init(&checkpoint->write_mutex, NULL);
+    checkpoint->started = false;
+}
+
+void checkpoint_free(checkpoint_t* checkpoint) {
+    for (int t = 0; t < checkpoint->num_threads; t++) {
+        thread_state_destroy(&checkpoint->states[t]);
+    }
+    thread_state_destroy(&checkpoint->scratch);
+    free(checkpoint->states);
+    free(checkpoint->configs);
+    free(checkpoint->elite_points);
+    free(checkpoint->path);
+    free(checkpoint->temp_path);
+    pthread_mutex_destroy(&checkpoint->write_mutex);
+}
+
+static bool checkpoint_write_data(const void* data, size_t size, FILE* file) {
+    return size == 0 || fwrite(data, size, 1, file) == 1;
+}
+
+// Writes the current state to the temporary file, then renames it over the checkpoint.
+// Returns false, leaving the previous checkpoint in place, on any I/O error.
+static bool checkpoint_write(checkpoint_t* checkpoint) {
+    int N = checkpoint->N;
+    FILE* file = fopen(checkpoint->temp_path, "wb");
+    if (file == NULL) {
+        return false;
+    }
+    checkpoint_header_t header = {
+        .magic = CHECKPOINT_MAGIC,
+        .version = CHECKPOINT_VERSION,
+        .N = N,
+        .num_threads = checkpoint->num_threads,
+        .k_top = K_TOP,
+        .predicate_exact = predicate.exact,
+        .problem_hash = checkpoint->problem_hash,
+        .predicate_absolute = predicate.absolute,
+        .predicate_relative = predicate.relative,
+        .restarts = atomic_load_explicit(&checkpoint->sync->restarts, memory_order_relaxed),
+    };
+    bool ok = checkpoint_write_data(&header, sizeof(header), file);
+
+    for (int e = 0; e < K_TOP && ok; e++) {
+        checkpoint_elite_t elite = { sync_read_slot(checkpoint->sync, e, checkpoint->elite_points), 0 };
+        ok = checkpoint_write_data(&elite, sizeof(elite), file)
+            && checkpoint_write_data(checkpoint->elite_points, N * sizeof(Point), file);
+    }
+
+    thread_state_t* scratch = &checkpoint->scratch;
+    for (int t = 0; t < checkpoint->num_threads && ok; t++) {
+        const solver_config_t* config = &checkpoint->configs[t];
+        thread_state_read(&checkpoint->states[t], N, scratch);
+        checkpoint_thread_t record = {
+            .sub_iterations = config->sub_iterations,
+            .num_candidates = config->num_candidates,
+            .portfolio_entry = config->portfolio_entry,
+            .valid = scratch->valid,
+            .config_reset_its = config->reset_its,
+            .min_dist = config->min_dist,
+            .reset_multiplier = config->reset_multiplier,
+            .final_radius = config->final_radius,
+            .min_radius = config->min_radius,
+            .relocate = config->relocate,
+            .iterations = scratch->iterations,
+            .its_since_checkpoint = scratch->its_since_checkpoint,
+            .reset_its = scratch->reset_its,
+            .violations = scratch->violations,
+            .engine = config->engine,
+            .weight_bump_its = config->weight_bump_its,
+            .restart = config->restart,
+            .restart_schedule = config->restart_schedule,
+            .weight_count = scratch->weight_count,
+        };
+        memcpy(record.rng_state, scratch->rng.s, sizeof(record.rng_state));
+        ok = checkpoint_write_data(&record, sizeof(record), file)
+            && checkpoint_write_data(scratch->points, N * sizeof(Point), file)
+            && checkpoint_write_data(scratch->search_weight, scratch->weight_count * sizeof(uint16_t), file);
+    }
+
+    ok = ok && fflush(file) == 0 && fsync(fileno(file)) == 0;
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(checkpoint->temp_path, checkpoint->path) != 0) {
+        unlink(checkpoint->temp_path);
+        return false;
+    }
+    checkpoint->written++;
+    return true;
+}
+
+// Saves a checkpoint now, after the one being written, if any.
+bool checkpoint_save(checkpoint_t* checkpoint) {
+    pthread_mutex_lock(&checkpoint->write_mutex);
+    bool saved = checkpoint_write(checkpoint);
+    pthread_mutex_unlock(&checkpoint->write_mutex);
+    return saved;
+}
+
+static void* checkpoint_worker(void* arg) {
+    checkpoint_t* checkpoint = arg;
+    struct timespec start = get_time();
+    double next = checkpoint->interval;
+    while (!atomic_load(&checkpoint->done)) {
+        struct timespec pause = { 0, 50 * 1000000 };
+        nanosleep(&pause, NULL);
+        if (elapsed_time_sec(start, get_time()) >= next) {
+            if (!checkpoint_save(checkpoint)) {
+                printf("Warning: could not write checkpoint %s\n", checkpoint->path);
+            }
+            next += checkpoint->interval;
+        }
+    }
+    return NULL;
+}
+
+// Starts saving a checkpoint to `path` every `interval` seconds.
+void checkpoint_start(checkpoint_t* checkpoint, const char* path, double interval) {
+    checkpoint->path = strdup(path);
+    checkpoint->temp_path = malloc(strlen(path) + 5);
+    sprintf(checkpoint->temp_path, "%s.tmp", path);
+    checkpoint->interval = interval;
+    if (pthread_create(&checkpoint->thread, NULL, checkpoint_worker, checkpoint) != 0) {
+        perror("Failed to create thread");
+        exit(1);
+    }
+    checkpoint->started = true;
+}
+
+// Stops the background writer, without saving.
+void checkpoint_stop(checkpoint_t* checkpoint) {
+    if (checkpoint->started) {
+        atomic_store(&checkpoint->done, true);
+        pthread_join(checkpoint->thread, NULL);
+        checkpoint->started = false;
+    }
+}
+
+static void checkpoint_read_or_die(void* data, size_t size, FILE* file, const char* path) {
+    if (size > 0 && fread(data, size, 1, file) != 1) {
+        printf("Error: checkpoint %s is truncated\n", path);
+        exit(1);
+    }
+}
+
+// Restores a checkpoint of `problem`: the orientation predicate, the elite pool into `sync` (freshly
+// initialized) and, into `checkpoint`, the thread count, configurations and states to resume.
+void checkpoint_load(checkpoint_t* checkpoint, const char* path, const Problem* problem, synchronization_t* sync) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        printf("Error opening file %s\n", path);
+        exit(1);
+    }
+    checkpoint_header_t header;
+    checkpoint_read_or_die(&header, sizeof(header), file, path);
+    if (memcmp(header.magic, CHECKPOINT_MAGIC, 4) != 0 || header.version != CHECKPOINT_VERSION) {
+        printf("Error: %s is not a checkpoint of this version\n", path);
+        exit(1);
+    }
+    if (header.N != (uint32_t)problem->N || header.problem_hash != problem_hash(problem)) {
+        printf("Error: checkpoint %s was written for another instance\n", path);
+        exit(1);
+    }
+    if (header.k_top != K_TOP || header.num_threads == 0) {
+        printf("Error: checkpoint %s has %u elite solutions and %u threads\n", path, header.k_top, header.num_threads);
+        exit(1);
+    }
+    predicate.exact = header.predicate_exact;
+    predicate.absolute = header.predicate_absolute;
+    predicate.relative = header.predicate_relative;
+    atomic_store(&sync->restarts, header.restarts);
+
+    int N = problem->N;
+    checkpoint_init(checkpoint, problem, header.num_threads, sync);
+    for (int e = 0; e < K_TOP; e++) {
+        checkpoint_elite_t elite;
+        checkpoint_read_or_die(&elite, sizeof(elite), file, path);
+        checkpoint_read_or_die(checkpoint->elite_points, N * sizeof(Point), file, path);
+        sync_set_slot(sync, e, checkpoint->elite_points, elite.violations);
+    }
+    for (int t = 0; t < checkpoint->num_threads; t++) {
+        checkpoint_thread_t record;
+        thread_state_t* state = &checkpoint->states[t];
+        checkpoint_read_or_die(&record, sizeof(record), file, path);
+        checkpoint_read_or_die(state->points, N * sizeof(Point), file, path);
+        if (record.weight_count < 0 || record.weight_count > state->weight_capacity) {
+            printf("Error: checkpoint %s has %d search weights for %d constraints\n", path, record.weight_count, problem->constraint_count);
+            exit(1);
+        }
+        state->weight_count = record.weight_count;
+        checkpoint_read_or_die(state->search_weight, state->weight_count * sizeof(uint16_t), file, path);
+        solver_config_t* config = &checkpoint->configs[t];
+        config->sub_iterations = record.sub_iterations;
+        config->num_candidates = record.num_candidates;
+        config->portfolio_entry = record.portfolio_entry;
+        config->reset_its = record.config_reset_its;
+        config->min_dist = record.min_dist;
+        config->reset_multiplier = record.reset_multiplier;
+        config->final_radius = record.final_radius;
+        config->min_radius = record.min_radius;
+        config->relocate = record.relocate;
+        config->engine = record.engine >= ENGINE_LOCAL && record.engine <= ENGINE_PENALTY ? record.engine : ENGINE_LOCAL;
+        config->weight_bump_its = record.weight_bump_its > 0 ? record.weight_bump_its : 0;
+        config->restart = record.restart >= RESTART_ELITE && record.restart <= RESTART_CROSSOVER ? record.restart : RESTART_ELITE;
+        config->restart_schedule = record.restart_schedule >= SCHEDULE_FIXED && record.restart_schedule <= SCHEDULE_LUBY
+            ? record.restart_schedule : SCHEDULE_FIXED;
+        state->valid = record.valid;
+        state->resume = record.valid;
+        memcpy(state->rng.s, record.rng_state, sizeof(record.rng_state));
+        state->iterations = record.iterations;
+        state->its_since_checkpoint = record.its_since_checkpoint;
+        state->reset_its = record.reset_its;
+        state->violations = record.violations;
+    }
+    fclose(file);
+}
+
+#endif // CHECKPOINT_H
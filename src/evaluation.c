@@ -3,9 +3,72 @@
 #include <math.h>
 #include <float.h>
 #include "utils.c"
+#include "predicates.c"
+
+#ifndef EVALUATION_H
+#define EVALUATION_H
 
 #define EPSILON 1e-6
 
+// Rule deciding whether a constraint of sign s (+1 or -1) is violated, shared by every evaluation path.
+// The constraint is violated when
+//     s * det <= absolute + relative * L^2
+// with L the longest edge of the triangle, so that det / L^2 does not depend on the scale of the points.
+// - by default, absolute = EPSILON: a fixed minimum |det|, which depends on the scale of the points;
+// - with a margin (-m), relative = margin: a scale-relative minimum |det|;
+// - with margin 0 (exact), s * det <= 0 with exact signs: the double determinant det = l - r (see det())
+//   is trusted unless it is within its rounding error bound, and the sign is then recomputed exactly.
+typedef struct {
+    double absolute;
+    double relative;
+    bool exact;
+} predicate_t;
+
+predicate_t predicate = { EPSILON, 0.0, false };
+
+void predicate_set_margin(double margin) {
+    predicate.absolute = 0.0;
+    predicate.relative = margin > 0 ? margin : 0.0;
+    predicate.exact = margin <= 0;
+}
+
+// Squared length of the longest edge of the triangle with edges (dxj, dyj), (dxk, dyk) from its first point.
+static inline double longest_edge_squared(double dxj, double dyj, double dxk, double dyk) {
+    double ej = dxj * dxj + dyj * dyj;
+    double ek = dxk * dxk + dyk * dyk;
+    double ejk = (dxk - dxj) * (dxk - dxj) + (dyk - dyj) * (dyk - dyj);
+    double longest = ej > ek ? ej : ek;
+    return longest > ejk ? longest : ejk;
+}
+
+// Whether a constraint of the given sign is violated by the points (xi, yi), (xj, yj), (xk, yk).
+static inline bool predicate_violated(int sign, double xi, double yi, double xj, double yj, double xk, double yk) {
+    if (sign == 0) {
+        return false;
+    }
+    double dxj = xj - xi, dyj = yj - yi, dxk = xk - xi, dyk = yk - yi;
+    double l = dyk * dxj;
+    double r = dxk * dyj;
+    double determinant = l - r;
+    if (predicate.exact) {
+        if (fabs(determinant) > ORIENT_ERRBOUND * (fabs(l) + fabs(r))) {
+            return sign * determinant <= 0;
+        }
+        // uncertain sign
+        return sign * orient2d_exact_sign((Point){xi, yi}, (Point){xj, yj}, (Point){xk, yk}) <= 0;
+    }
+    double threshold = predicate.absolute;
+    if (predicate.relative > 0) {
+        threshold += predicate.relative * longest_edge_squared(dxj, dyj, dxk, dyk);
+    }
+    return sign * determinant <= threshold;
+}
+
+// Whether a constraint is violated, given the positions of its points i, j and k.
+static inline bool constraint_violated(const Constraint* constraint, Point pi, Point pj, Point pk) {
+    return predicate_violated(constraint->sign, pi.x, pi.y, pj.x, pj.y, pk.x, pk.y);
+}
+
 void min_dist(const Point* points, int n, double* min_distance, int* m1, int* m2) {
       if (!points || !min_distance || !m1 || !m2 || n <= 0) {
         // Handle error - perhaps set error code or return early
@@ -32,8 +95,11 @@ double distance(Point a, Point b) {
     return sqrt(pow(a.x - b.x, 2) + pow(a.y - b.y, 2));
 }
 
-void evaluate(const Point* points, int n, const Constraint* constraints, int constraint_count, const int** constraints_per_point,  double MIN_DIST,
-    int* total_violations, int* violations_per_point, int* point_with_max_violations, double* min_distance, int given_point, int constraint_count_given_point) {
+// Evaluates all constraints (given_point == -1), or only the constraints involving given_point.
+void evaluate(const Point* points, const Problem* problem, double MIN_DIST,
+    int* total_violations, int* violations_per_point, int* point_with_max_violations, double* min_distance, int given_point) {
+    int n = problem->N;
+    const Constraint* constraints = problem->constraints;
     *total_violations = 0;
     int max_violations = 0;
     *point_with_max_violations = -1;
@@ -42,17 +108,19 @@ void evaluate(const Point* points, int n, const Constraint* constraints, int con
         violations_per_point[i] = 0;
     }
 
-    int n_constraints = given_point == -1 ? constraint_count : constraint_count_given_point;
-    for (int i = 0; i < n_constraints; i++) {
-        Constraint constraint =  given_point == -1 ? constraints[i] : constraints[constraints_per_point[given_point][i]];
+    point_cursor_t cursor = point_cursor(problem, given_point == -1 ? 0 : given_point);
+    int next = 0, id;
+    Constraint constraint;
+    while (given_point == -1 ? next < problem->constraint_count : point_cursor_next(&cursor, &id, &constraint)) {
+        if (given_point == -1) {
+            constraint = constraints[next++];
+        }
 
         int pi = constraint.i - 1;
         int pj = constraint.j - 1;
         int pk = constraint.k - 1;
-        double determinant = det(points[pi], points[pj], points[pk]);
 
-        if ((constraint.sign == 1 && determinant <= EPSILON) ||
-            (constraint.sign == -1 && determinant >= -EPSILON)) {
+        if (constraint_violated(&constraint, points[pi], points[pj], points[pk])) {
             (*total_violations)++;
             int points_to_update[] = { pi, pj, pk };
             for (int j = 0; j < 3; j++) {
@@ -95,4 +163,6 @@ void evaluate(const Point* points, int n, const Constraint* constraints, int con
             *point_with_max_violations = m2;
         }
     }
-}
\ No newline at end of file
+}
+
+#endif // EVALUATION_H
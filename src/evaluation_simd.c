@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "utils.c"
+#include "evaluation.c"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define EVAL_SIMD_X86 1
+#endif
+
+#ifndef EVALUATION_SIMD_H
+#define EVALUATION_SIMD_H
+
+// Full evaluation engine over structure-of-arrays points (x[], y[]) and the constraint columns
+// of a Problem. A kernel evaluates all `count` constraints, returns how many are violated and,
+// if `violated` is not NULL, writes a 0/1 flag per constraint.
+// The same violation rule as constraint_violated() is used by every kernel.
+typedef int (*eval_kernel_fn)(const ConstraintColumns* columns, int count, const double* x, const double* y, unsigned char* violated);
+
+typedef struct {
+    const char* name;
+    eval_kernel_fn fn;
+} eval_kernel_t;
+
+static inline bool column_violated(const ConstraintColumns* columns, int c, const double* x, const double* y) {
+    int i = columns->i[c], j = columns->j[c], k = columns->k[c];
+    return predicate_violated(columns->sign[c], x[i], y[i], x[j], y[j], x[k], y[k]);
+}
+
+static int eval_kernel_scalar_range(const ConstraintColumns* columns, int begin, int end, const double* x, const double* y, unsigned char* violated) {
+    int total = 0;
+    for (int c = begin; c < end; c++) {
+        bool v = column_violated(columns, c, x, y);
+        total += v;
+        if (violated) {
+            violated[c] = v;
+        }
+    }
+    return total;
+}
+
+int eval_kernel_scalar(const ConstraintColumns* columns, int count, const double* x, const double* y, unsigned char* violated) {
+    return eval_kernel_scalar_range(columns, 0, count, x, y, violated);
+}
+
+#ifdef EVAL_SIMD_X86
+
+// spreads the 4 bits of a mask into 4 bytes of 0/1 (little endian)
+static const uint32_t MASK4_TO_BYTES[16] = {
+    0x00000000, 0x00000001, 0x00000100, 0x00000101, 0x00010000, 0x00010001, 0x00010100, 0x00010101,
+    0x01000000, 0x01000001, 0x01000100, 0x01000101, 0x01010000, 0x01010001, 0x01010100, 0x01010101,
+};
+
+// Lanes whose sign is uncertain in exact mode are re-decided by the scalar predicate.
+static inline int fix_uncertain_lanes(const ConstraintColumns* columns, int c, int mask, int uncertain, const double* x, const double* y) {
+    while (uncertain) {
+        int lane = __builtin_ctz(uncertain);
+        uncertain &= uncertain - 1;
+        mask = (mask & ~(1 << lane)) | (column_violated(columns, c + lane, x, y) << lane);
+    }
+    return mask;
+}
+
+__attribute__((target("avx2")))
+int eval_kernel_avx2(const ConstraintColumns* columns, int count, const double* x, const double* y, unsigned char* violated) {
+    const __m256d absolute = _mm256_set1_pd(predicate.absolute);
+    const __m256d relative = _mm256_set1_pd(predicate.relative);
+    const __m256d errbound = _mm256_set1_pd(ORIENT_ERRBOUND);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d abs_mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+    const bool relative_mode = predicate.relative > 0;
+    int total = 0;
+    int c = 0;
+    for (; c + 4 <= count; c += 4) {
+        __m128i ii = _mm_loadu_si128((const __m128i*)(columns->i + c));
+        __m128i jj = _mm_loadu_si128((const __m128i*)(columns->j + c));
+        __m128i kk = _mm_loadu_si128((const __m128i*)(columns->k + c));
+        __m256d xi = _mm256_i32gather_pd(x, ii, 8), yi = _mm256_i32gather_pd(y, ii, 8);
+        __m256d xj = _mm256_i32gather_pd(x, jj, 8), yj = _mm256_i32gather_pd(y, jj, 8);
+        __m256d xk = _mm256_i32gather_pd(x, kk, 8), yk = _mm256_i32gather_pd(y, kk, 8);
+        __m256d dxj = _mm256_sub_pd(xj, xi), dyj = _mm256_sub_pd(yj, yi);
+        __m256d dxk = _mm256_sub_pd(xk, xi), dyk = _mm256_sub_pd(yk, yi);
+        __m256d l = _mm256_mul_pd(dyk, dxj);
+        __m256d r = _mm256_mul_pd(dxk, dyj);
+        __m256d determinant = _mm256_sub_pd(l, r);
+
+        int32_t packed_signs;
+        memcpy(&packed_signs, columns->sign + c, sizeof(packed_signs));
+        __m256d sign = _mm256_cvtepi32_pd(_mm_cvtepi8_epi32(_mm_cvtsi32_si128(packed_signs)));
+        __m256d nonzero = _mm256_cmp_pd(sign, zero, _CMP_NEQ_OQ);
+
+        // sign * det <= absolute + relative * L^2, for nonzero signs
+        __m256d threshold = absolute;
+        if (relative_mode) {
+            __m256d dxjk = _mm256_sub_pd(dxk, dxj), dyjk = _mm256_sub_pd(dyk, dyj);
+            __m256d longest = _mm256_max_pd(
+                _mm256_max_pd(_mm256_add_pd(_mm256_mul_pd(dxj, dxj), _mm256_mul_pd(dyj, dyj)),
+                    _mm256_add_pd(_mm256_mul_pd(dxk, dxk), _mm256_mul_pd(dyk, dyk))),
+                _mm256_add_pd(_mm256_mul_pd(dxjk, dxjk), _mm256_mul_pd(dyjk, dyjk)));
+            threshold = _mm256_add_pd(threshold, _mm256_mul_pd(relative, longest));
+        }
+        __m256d bad = _mm256_and_pd(
+            _mm256_cmp_pd(_mm256_mul_pd(sign, determinant), threshold, _CMP_LE_OQ), nonzero);
+        int mask = _mm256_movemask_pd(bad);
+        if (predicate.exact) {
+            __m256d detsum = _mm256_add_pd(_mm256_and_pd(l, abs_mask), _mm256_and_pd(r, abs_mask));
+            __m256d uncertain = _mm256_and_pd(nonzero,
+                _mm256_cmp_pd(_mm256_and_pd(determinant, abs_mask), _mm256_mul_pd(errbound, detsum), _CMP_LE_OQ));
+            mask = fix_uncertain_lanes(columns, c, mask, _mm256_movemask_pd(uncertain), x, y);
+        }
+        total += __builtin_popcount(mask);
+        if (violated) {
+            memcpy(violated + c, &MASK4_TO_BYTES[mask], 4);
+        }
+    }
+    // leave no dirty upper register state behind, or the SSE code that follows gets slower
+    _mm256_zeroupper();
+    return total + eval_kernel_scalar_range(columns, c, count, x, y, violated);
+}
+
+__attribute__((target("avx512f")))
+int eval_kernel_avx512(const ConstraintColumns* columns, int count, const double* x, const double* y, unsigned char* violated) {
+    const __m512d absolute = _mm512_set1_pd(predicate.absolute);
+    const __m512d relative = _mm512_set1_pd(predicate.relative);
+    const __m512d errbound = _mm512_set1_pd(ORIENT_ERRBOUND);
+    const __m512d zero = _mm512_setzero_pd();
+    const bool relative_mode = predicate.relative > 0;
+    int total = 0;
+    int c = 0;
+    for (; c + 8 <= count; c += 8) {
+        __m256i ii = _mm256_loadu_si256((const __m256i*)(columns->i + c));
+        __m256i jj = _mm256_loadu_si256((const __m256i*)(columns->j + c));
+        __m256i kk = _mm256_loadu_si256((const __m256i*)(columns->k + c));
+        __m512d xi = _mm512_i32gather_pd(ii, x, 8), yi = _mm512_i32gather_pd(ii, y, 8);
+        __m512d xj = _mm512_i32gather_pd(jj, x, 8), yj = _mm512_i32gather_pd(jj, y, 8);
+        __m512d xk = _mm512_i32gather_pd(kk, x, 8), yk = _mm512_i32gather_pd(kk, y, 8);
+        __m512d dxj = _mm512_sub_pd(xj, xi), dyj = _mm512_sub_pd(yj, yi);
+        __m512d dxk = _mm512_sub_pd(xk, xi), dyk = _mm512_sub_pd(yk, yi);
+        __m512d l = _mm512_mul_pd(dyk, dxj);
+        __m512d r = _mm512_mul_pd(dxk, dyj);
+        __m512d determinant = _mm512_sub_pd(l, r);
+
+        __m512d sign = _mm512_cvtepi32_pd(_mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)(columns->sign + c))));
+        __mmask8 nonzero = _mm512_cmp_pd_mask(sign, zero, _CMP_NEQ_OQ);
+
+        // sign * det <= absolute + relative * L^2, for nonzero signs
+        __m512d threshold = absolute;
+        if (relative_mode) {
+            __m512d dxjk = _mm512_sub_pd(dxk, dxj), dyjk = _mm512_sub_pd(dyk, dyj);
+            __m512d longest = _mm512_max_pd(
+                _mm512_max_pd(_mm512_add_pd(_mm512_mul_pd(dxj, dxj), _mm512_mul_pd(dyj, dyj)),
+                    _mm512_add_pd(_mm512_mul_pd(dxk, dxk), _mm512_mul_pd(dyk, dyk))),
+                _mm512_add_pd(_mm512_mul_pd(dxjk, dxjk), _mm512_mul_pd(dyjk, dyjk)));
+            threshold = _mm512_add_pd(threshold, _mm512_mul_pd(relative, longest));
+        }
+        int mask = _mm512_cmp_pd_mask(_mm512_mul_pd(sign, determinant), threshold, _CMP_LE_OQ) & nonzero;
+        if (predicate.exact) {
+            __m512d detsum = _mm512_add_pd(_mm512_abs_pd(l), _mm512_abs_pd(r));
+            __mmask8 uncertain = _mm512_cmp_pd_mask(_mm512_abs_pd(determinant), _mm512_mul_pd(errbound, detsum), _CMP_LE_OQ) & nonzero;
+            mask = fix_uncertain_lanes(columns, c, mask, uncertain, x, y);
+        }
+        total += __builtin_popcount(mask);
+        if (violated) {
+            memcpy(violated + c, &MASK4_TO_BYTES[mask & 0xF], 4);
+            memcpy(violated + c + 4, &MASK4_TO_BYTES[mask >> 4], 4);
+        }
+    }
+    // leave no dirty upper register state behind, or the SSE code that follows gets slower
+    _mm256_zeroupper();
+    return total + eval_kernel_scalar_range(columns, c, count, x, y, violated);
+}
+
+#endif // EVAL_SIMD_X86
+
+void points_to_soa(const Point* points, int N, double* x, double* y) {
+    for (int p = 0; p < N; p++) {
+        x[p] = points[p].x;
+        y[p] = points[p].y;
+    }
+}
+
+// Constraints per second of a full evaluation with the given kernel, measured on random points.
+double eval_kernel_throughput(eval_kernel_fn kernel, const Problem* problem, rng_t* rng, double seconds) {
+    int N = problem->N;
+    double* x = malloc(N * sizeof(double));
+    double* y = malloc(N * sizeof(double));
+    unsigned char* violated = malloc(problem->constraint_count > 0 ? problem->constraint_count : 1);
+    for (int p = 0; p < N; p++) {
+        x[p] = rng_double(rng) * 10;
+        y[p] = rng_double(rng) * 10;
+    }
+
+    long long int evaluated = 0;
+    volatile int sink = 0;
+    struct timespec start = get_time();
+    double elapsed = 0.0;
+    do {
+        for (int r = 0; r < 8; r++) {
+            sink += kernel(&problem->columns, problem->constraint_count, x, y, violated);
+            evaluated += problem->constraint_count;
+        }
+        elapsed = elapsed_time_sec(start, get_time());
+    } while (elapsed < seconds);
+    (void)sink;
+
+    free(x);
+    free(y);
+    free(violated);
+    return evaluated / elapsed;
+}
+
+// The kernel used by the solver, chosen by eval_kernel_init().
+eval_kernel_t eval_kernel = { "scalar", eval_kernel_scalar };
+double eval_kernel_rate = 0.0; // measured constraints/s of the chosen kernel
+
+// Chooses the evaluation kernel among those supported by the CPU.
+// Gathers are slow on some CPUs (e.g. with microcode mitigations), so rather than trusting
+// the feature flags alone, each supported kernel is timed briefly on the actual problem
+// and the fastest one wins. Returns the number of candidate kernels.
+int eval_kernel_init(const Problem* problem, rng_t* rng) {
+    eval_kernel_t candidates[3];
+    int count = 0;
+    candidates[count++] = (eval_kernel_t){ "scalar", eval_kernel_scalar };
+#ifdef EVAL_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        candidates[count++] = (eval_kernel_t){ "avx2", eval_kernel_avx2 };
+    }
+    if (__builtin_cpu_supports("avx512f")) {
+        candidates[count++] = (eval_kernel_t){ "avx512", eval_kernel_avx512 };
+    }
+#endif
+    eval_kernel = candidates[0];
+    eval_kernel_rate = 0.0;
+    for (int t = 0; t < count; t++) {
+        double rate = eval_kernel_throughput(candidates[t].fn, problem, rng, 0.005);
+        if (rate > eval_kernel_rate) {
+            eval_kernel_rate = rate;
+            eval_kernel = candidates[t];
+        }
+    }
+    return count;
+}
+
+#endif // EVALUATION_SIMD_H
@@ -0,0 +1,186 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include "utils.c"
+#include "predicates.c"
+#include "rng.c"
+
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+// Native instance generator: samples a point set and builds its chirotope (the orientation of
+// every triple, in lexicographic order) straight into a Problem, with exact signs.
+// An instance can be named by a spec, "gen:<N>[:<distribution>[:<seed>]]", anywhere an orientation
+// file is expected (see load_orientations).
+
+#define GENERATOR_BOX 50.0 // side of the square the points are drawn in, as in build_benchmarks.py
+#define GENERATOR_MAX_ATTEMPTS 100
+#define GENERATOR_SEED_MIX 0x9E3779B97F4A7C15ULL
+
+typedef enum {
+    POINTS_UNIFORM,     // uniform in the box
+    POINTS_CLUSTERED,   // gaussian clusters around about N / 10 centers
+    POINTS_CONVEX,      // on a circle, in convex position
+    POINTS_DEGENERATE,  // close to a few lines, so that many triples are nearly collinear
+    POINTS_DISTRIBUTION_COUNT
+} point_distribution_t;
+
+static const char* const distribution_names[POINTS_DISTRIBUTION_COUNT] = { "uniform", "clustered", "convex", "degenerate" };
+
+// The distribution of the given name, or -1.
+int parse_distribution(const char* name) {
+    for (int d = 0; d < POINTS_DISTRIBUTION_COUNT; d++) {
+        if (strcmp(name, distribution_names[d]) == 0) {
+            return d;
+        }
+    }
+    return -1;
+}
+
+// Standard normal sample (Box-Muller).
+static double gaussian(rng_t* rng) {
+    double u = (rng_double(rng) + 1e-7) / (1 + 1e-7);
+    double v = rng_double(rng);
+    return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+void generate_point_set(Point* points, int N, point_distribution_t distribution, rng_t* rng) {
+    double box = GENERATOR_BOX;
+    if (distribution == POINTS_CLUSTERED) {
+        int clusters = N / 10 > 2 ? N / 10 : 2;
+        Point* centers = malloc(clusters * sizeof(Point));
+        for (int c = 0; c < clusters; c++) {
+            centers[c] = (Point){ rng_double(rng) * box, rng_double(rng) * box };
+        }
+        for (int i = 0; i < N; i++) {
+            Point center = centers[(int)(rng_double(rng) * clusters) % clusters];
+            points[i] = (Point){ center.x + gaussian(rng), center.y + gaussian(rng) };
+        }
+        free(centers);
+    } else if (distribution == POINTS_CONVEX) {
+        for (int i = 0; i < N; i++) {
+            double angle = 2 * M_PI * rng_double(rng);
+            points[i] = (Point){ box / 2 * (1 + cos(angle)), box / 2 * (1 + sin(angle)) };
+        }
+    } else if (distribution == POINTS_DEGENERATE) {
+        // about sqrt(N) random lines, each point on one of them up to a 1e-3 perpendicular offset
+        int lines = (int)sqrt(N) > 2 ? (int)sqrt(N) : 2;
+        Point* anchors = malloc(lines * sizeof(Point));
+        double* angles = malloc(lines * sizeof(double));
+        for (int l = 0; l < lines; l++) {
+            anchors[l] = (Point){ rng_double(rng) * box, rng_double(rng) * box };
+            angles[l] = M_PI * rng_double(rng);
+        }
+        for (int i = 0; i < N; i++) {
+            int l = (int)(rng_double(rng) * lines) % lines;
+            double t = (rng_double(rng) - 0.5) * box;
+            double offset = (rng_double(rng) - 0.5) * 2e-3;
+            points[i] = (Point){
+                anchors[l].x + t * cos(angles[l]) - offset * sin(angles[l]),
+                anchors[l].y + t * sin(angles[l]) + offset * cos(angles[l]),
+            };
+        }
+        free(anchors);
+        free(angles);
+    } else {
+        for (int i = 0; i < N; i++) {
+            points[i] = (Point){ rng_double(rng) * box, rng_double(rng) * box };
+        }
+    }
+}
+
+// Builds the chirotope of `points` into `problem`, in lexicographic order. Returns false, leaving
+// the problem empty, if three points are exactly collinear.
+bool chirotope_of_points(const Point* points, int N, Problem* problem) {
+    int64_t count = triples_below(N);
+    if (count > INT32_MAX) {
+        printf("ERROR: N = %d is too large\n", N);
+        exit(1);
+    }
+    problem->N = N;
+    problem->constraint_count = count;
+    problem->constraints = malloc((count > 0 ? count : 1) * sizeof(Constraint));
+    int c = 0;
+    for (int i = 0; i < N; i++) {
+        for (int j = i + 1; j < N; j++) {
+            for (int k = j + 1; k < N; k++) {
+                int sign = orient2d_sign(points[i], points[j], points[k]);
+                if (sign == 0) {
+                    free(problem->constraints);
+                    problem->constraints = NULL;
+                    return false;
+                }
+                problem->constraints[c++] = (Constraint){ i + 1, j + 1, k + 1, sign };
+            }
+        }
+    }
+    problem_build_index(problem);
+    return true;
+}
+
+// A realizable complete instance over N points drawn from `distribution`. Point sets with an exactly
+// collinear triple are redrawn.
+void generate_problem(Problem* problem, int N, point_distribution_t distribution, unsigned long long seed) {
+    if (N < 3) {
+        printf("ERROR: Generated instances need at least 3 points\n");
+        exit(1);
+    }
+    // the seed is scrambled, so that the solver started with the same seed does not draw the very
+    // same point set (up to scale) as its initial assignment
+    rng_t rng;
+    rng_init(&rng, (seed + 1) * GENERATOR_SEED_MIX);
+    Point* points = malloc(N * sizeof(Point));
+    for (int attempt = 0; ; attempt++) {
+        if (attempt == GENERATOR_MAX_ATTEMPTS) {
+            printf("ERROR: Could not draw %d %s points without collinear triples\n", N, distribution_names[distribution]);
+            exit(1);
+        }
+        generate_point_set(points, N, distribution, &rng);
+        if (chirotope_of_points(points, N, problem)) {
+            break;
+        }
+    }
+    free(points);
+}
+
+// Whether `spec` names a generated instance.
+bool is_generator_spec(const char* spec) {
+    return strncmp(spec, "gen:", 4) == 0;
+}
+
+// Generates the instance named by "gen:<N>[:<distribution>[:<seed>]]" (uniform, seed 1 by default).
+// Returns NULL, or what is wrong with the spec.
+const char* load_generator_spec(const char* spec, Problem* problem) {
+    char distribution[32] = "uniform";
+    int N = 0;
+    unsigned long long seed = 1;
+    int fields = sscanf(spec, "gen:%d:%31[a-z]:%llu", &N, distribution, &seed);
+    int d = parse_distribution(distribution);
+    if (fields < 1 || N < 3 || d < 0) {
+        return "invalid instance spec, expected gen:<N>[:uniform|clustered|convex|degenerate[:<seed>]]";
+    }
+    generate_problem(problem, N, d, seed);
+    return NULL;
+}
+
+// Writes the problem as a text orientation file, in the format of build_benchmarks.py.
+void write_text_orientations(const Problem* problem, const char* path) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        printf("Error opening file %s\n", path);
+        exit(1);
+    }
+    for (int c = 0; c < problem->constraint_count; c++) {
+        const Constraint* constraint = &problem->constraints[c];
+        char orientation = constraint->sign > 0 ? 'A' : constraint->sign < 0 ? 'B' : 'C';
+        fprintf(file, "%c_(%d, %d, %d)\n", orientation, constraint->i, constraint->j, constraint->k);
+    }
+    if (fclose(file) != 0) {
+        printf("Error writing orientation file %s\n", path);
+        exit(1);
+    }
+}
+
+#endif // GENERATOR_H
@@ -6,91 +6,86 @@
 #include <pthread.h>
 #include <unistd.h>
 #include <signal.h>
+#include <getopt.h>
 
 #include "utils.c"
 #include "solver.c"
+#include "binary_format.c"
+#include "batch.c"
+#include "precheck.c"
+#include "portfolio.c"
+#include "generator.c"
+#include "scaling.c"
 #include "threading.c"
+#include "stats.c"
+#include "checkpoint.c"
+#include "monitor.c"
+#include "multilevel.c"
 #include "rng.c"
 
 int GLOBAL_SEED = 42;
 
-synchronization_t _sync; // Global synchronization variable, keeping the best solutions.
-// it's global to allow for signal handling
-int _N = 0; // number of points, global for signal handling
-
 char* output_file = NULL;
 
 // Struct to hold thread parameters
 typedef struct {
     int thread_id;
-    int N; 
-    Constraint *constraints;
-    int constraint_count;
-    int** constraints_per_point;
-    int* constraints_per_point_count;
+    const Problem* problem;
     
     bool* is_point_fixed;
     Point* fixed_points;
     Symmetry* symmetry;
+    const orbit_index_t* orbits; // NULL without a symmetry
     
-    int sub_iterations;
-    double MIN_DIST; 
+    const solver_config_t* config;
     Point *points;
     char *output_file;
-    long long int reset_its;
     rng_t *rng;
+    arena_t arena;
     synchronization_t *sync;
+    search_stats_t* stats;
+    thread_state_t* state;      // NULL without checkpoints
+    solve_result_t result;
 } thread_params_t;
 
 
 void print_usage() {
-    color_printf(RED, "Usage: <orientation_file> [-i sub_iterations] [-d min_dist] [-o output_file] [-s random_seed]\n [-r reset_interval] [-t threads] [-f fixed points file] [-c symmetry file]\n");
+    color_printf(RED, "Usage: compile <orientation_file> ... (writes binary .orb files)\n");
+    color_printf(RED, "Usage: generate <N> [-n count] [-s seed] [-g uniform|clustered|convex|degenerate] [-o directory] [-b]\n");
+    color_printf(RED, "Usage: scale [-N sizes] [-n seeds] [-t thread counts] [-T seconds per run] [-g distribution] [-o summary.json]\n");
+    color_printf(RED, "Usage: batch <directory | list file> [-T seconds per instance] [-t workers] [-o summary.json]\n [other options as below, applied to every instance]\n");
+    color_printf(RED, "Usage: <orientation_file> [-i sub_iterations] [-d min_dist] [-o output_file] [-s random_seed]\n [-r reset_interval] [-t threads] [-f fixed points file] [-c symmetry file] [-k candidates per move]\n [-w iterations before weight bumps] [-m orientation margin] [-p portfolio file | default] [-S stats.json] [-I stats interval]\n [--checkpoint file] [--checkpoint-interval seconds] [--resume checkpoint file]\n [--snapshot file] [--snapshot-interval seconds] [-T | --time-limit seconds] [--max-iterations count]\n [--multilevel base points] [--multilevel-step points per level] [--precheck off | on | full]\n [--engine local | hybrid | penalty] [--relocate fraction of moves]\n [--restart elite | partial | crossover] [--restart-schedule fixed | geometric | luby] [--restart-log file]\n");
 }
 
-void sigint_handler(int sig_num)
-{
-    printf("\nInterrupt signal (%d) received.\n", sig_num);
-    pthread_mutex_lock(&_sync.top_k_mutex);
-    // Print information about the object if it exists
-  
-    color_printf(GREEN, "Best solution is:\n");
-    Point* points = _sync.top_k_solutions[0].points;
-    for (int i = 0; i < _N; i++) {
-        printf("\t\t Point %d: (%.6f, %.6f)\n", i + 1, points[i].x, points[i].y);
-    }
-        
-    printf("Violations: %d\n", _sync.top_k_solutions[0].violations);
-    printf("\n");
-
-    serialize_solution(_N, points, output_file);
-    color_printf(YELLOW, "Solution saved to %s\n", output_file);
- 
-    pthread_mutex_unlock(&_sync.top_k_mutex);
-    sync_destroy(&_sync);
-    exit(0);
-}
+void print_memory_footprint(const Problem* problem, const solver_config_t* config, const orbit_index_t* orbits, int num_threads) {
+    size_t problem_mem = problem_bytes(problem) + (orbits ? orbit_index_bytes(orbits) : 0);
+    size_t thread_mem = solver_workspace_bytes(problem, config, orbits) + problem->N * sizeof(Point) + sizeof(rng_t);
+    size_t sync_mem = sync_bytes(problem->N);
+    size_t total = problem_mem + num_threads * thread_mem + sync_mem;
 
+    color_printf(YELLOW, "Memory footprint");
+    printf(": %.1f KiB total (constraints + index %.1f KiB, %d x %.1f KiB per thread, elite solutions %.1f KiB)\n\n",
+        total / 1024.0, problem_mem / 1024.0, num_threads, thread_mem / 1024.0, sync_mem / 1024.0);
+}
 
 void* thread_solve(void* arg) {
     
     thread_params_t* params = (thread_params_t*)arg;
     
-    solve(params->N, 
-        params->constraints, 
-        params->constraint_count, 
-        (const int**) params->constraints_per_point, 
-        params->constraints_per_point_count, 
-        params->sub_iterations, 
-        params->MIN_DIST, 
+    params->result = solve(params->problem, 
+        params->config, 
         params->points, 
         params->output_file, 
-        params->reset_its,
         params->thread_id,
         params->sync,
         params->rng,
+        &params->arena,
         params->is_point_fixed,
         params->fixed_points,
-        params->symmetry);
+        params->symmetry,
+        params->orbits,
+        params->stats,
+        params->state);
     
     return NULL;
 }
@@ -101,29 +96,98 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-        
-    signal(SIGINT, sigint_handler);
-    
-    char* orientation_file = argv[1];
+
+    if (strcmp(argv[1], "compile") == 0) {
+        if (argc < 3) {
+            print_usage();
+            return 1;
+        }
+        return compile_orientation_files(argc - 2, argv + 2);
+    }
+
+    if (strcmp(argv[1], "generate") == 0) {
+        if (argc < 3) {
+            print_usage();
+            return 1;
+        }
+        return generate_orientation_files(argc - 2, argv + 2);
+    }
+
+    if (strcmp(argv[1], "scale") == 0) {
+        return run_scaling_study(argc - 1, argv + 1);
+    }
+
+    // `batch <source>` takes the place of the orientation file
+    bool batch_mode = strcmp(argv[1], "batch") == 0;
+    int first = batch_mode ? 2 : 1;
+    if (argc <= first) {
+        print_usage();
+        return 1;
+    }
+    char* orientation_file = argv[first];
 
     // default values
     int sub_iterations = 10;
     int NUM_THREADS = 1;
     double min_dist = -1.0; // negative -> turned off
     long long int reset_its = 30000;
+    int num_candidates = 1;
+    int weight_bump_its = WEIGHT_BUMP_ITS; // 0 turns adaptive constraint weighting off
+    double margin = -1.0; // negative -> absolute EPSILON
+    double time_limit = 0; // seconds per run, or per instance in batch mode (5 by default); 0 for none
+    long long max_iterations = 0; // per thread, or per instance in batch mode; 0 for none
+    bool output_given = false;
     
         output_file = malloc(256 * sizeof(char));
     if (output_file != NULL) {
         strcpy(output_file, "output.txt");
     }
     
-    char* fixed_points_file = malloc(256 * sizeof(char));
-    char* symmetry_file = malloc(256 * sizeof(char));
+    char* fixed_points_file = calloc(256, sizeof(char));
+    char* symmetry_file = calloc(256, sizeof(char));
+    char* portfolio_file = NULL; // per-thread configurations
+    char* stats_file = NULL; // search counters, as JSON lines
+    double stats_interval = 0; // seconds between streamed snapshots, 0 for only the final one
+    char* checkpoint_file = NULL; // search state, saved periodically
+    double checkpoint_interval = CHECKPOINT_INTERVAL;
+    char* resume_file = NULL; // checkpoint to resume from
+    char* snapshot_file = NULL; // best solution so far, rewritten while the search runs
+    double snapshot_interval = 0; // seconds between snapshots, 0 for one after each improvement
+    int multilevel_base = 0; // points of the first level, 0 to solve all points at once
+    int multilevel_step = 2; // points inserted per level
+    int precheck = PRECHECK_ON; // chirotope axioms checked before the search
+    int engine = ENGINE_LOCAL;
+    double relocate = 0.0; // fraction of moves that are exact relocations
+    int restart = RESTART_ELITE;
+    int restart_schedule = SCHEDULE_FIXED;
+    char* restart_log_file = NULL; // one JSON line per restart attempt
+
+    enum { OPT_CHECKPOINT = 256, OPT_CHECKPOINT_INTERVAL, OPT_RESUME, OPT_SNAPSHOT, OPT_SNAPSHOT_INTERVAL, OPT_MAX_ITERATIONS,
+        OPT_MULTILEVEL, OPT_MULTILEVEL_STEP, OPT_PRECHECK, OPT_ENGINE, OPT_RELOCATE,
+        OPT_RESTART, OPT_RESTART_SCHEDULE, OPT_RESTART_LOG };
+    static const struct option long_options[] = {
+        { "time-limit", required_argument, NULL, 'T' },
+        { "max-iterations", required_argument, NULL, OPT_MAX_ITERATIONS },
+        { "multilevel", required_argument, NULL, OPT_MULTILEVEL },
+        { "multilevel-step", required_argument, NULL, OPT_MULTILEVEL_STEP },
+        { "precheck", required_argument, NULL, OPT_PRECHECK },
+        { "engine", required_argument, NULL, OPT_ENGINE },
+        { "relocate", required_argument, NULL, OPT_RELOCATE },
+        { "restart", required_argument, NULL, OPT_RESTART },
+        { "restart-schedule", required_argument, NULL, OPT_RESTART_SCHEDULE },
+        { "restart-log", required_argument, NULL, OPT_RESTART_LOG },
+        { "checkpoint", required_argument, NULL, OPT_CHECKPOINT },
+        { "checkpoint-interval", required_argument, NULL, OPT_CHECKPOINT_INTERVAL },
+        { "resume", required_argument, NULL, OPT_RESUME },
+        { "snapshot", required_argument, NULL, OPT_SNAPSHOT },
+        { "snapshot-interval", required_argument, NULL, OPT_SNAPSHOT_INTERVAL },
+        { NULL, 0, NULL, 0 },
+    };
 
     // Parse optional arguments
     int opt;
 
-    while ((opt = getopt(argc - 1, argv + 1, "i:s:d:o:r:t:f:c:")) != -1) {
+    while ((opt = getopt_long(argc - first, argv + first, "i:s:d:o:r:t:f:c:k:w:m:T:p:S:I:", long_options, NULL)) != -1) {
         switch (opt) {
             case 'i':
                 sub_iterations = atoi(optarg);
@@ -136,6 +200,7 @@ int main(int argc, char* argv[]) {
                 break;
             case 'o':
                 strcpy(output_file, optarg);
+                output_given = true;
                 break;
             case 'r':
                 reset_its = atoi(optarg);
@@ -149,96 +214,501 @@ int main(int argc, char* argv[]) {
             case 'c':
                 strcpy(symmetry_file, optarg);
                 break;
+            case 'k':
+                num_candidates = atoi(optarg) > 0 ? atoi(optarg) : 1;
+                break;
+            case 'w':
+                weight_bump_its = atoi(optarg);
+                if (weight_bump_its < 0) {
+                    print_usage();
+                    return 1;
+                }
+                break;
+            case 'm':
+                margin = atof(optarg);
+                if (margin < 0) {
+                    printf("Error: the orientation margin must be >= 0\n");
+                    return 1;
+                }
+                break;
+            case 'p':
+                if (batch_mode) {
+                    print_usage();
+                    return 1;
+                }
+                portfolio_file = optarg;
+                break;
+            case 'S':
+                if (batch_mode) {
+                    print_usage();
+                    return 1;
+                }
+                if (!SEARCH_STATS) {
+                    printf("Error: search statistics are compiled out (built with STATS=0)\n");
+                    return 1;
+                }
+                stats_file = optarg;
+                break;
+            case 'I':
+                stats_interval = atof(optarg);
+                if (stats_interval <= 0) {
+                    print_usage();
+                    return 1;
+                }
+                break;
+            case OPT_CHECKPOINT:
+            case OPT_RESUME:
+            case OPT_SNAPSHOT:
+                if (batch_mode) {
+                    print_usage();
+                    return 1;
+                }
+                if (opt == OPT_CHECKPOINT) {
+                    checkpoint_file = optarg;
+                } else if (opt == OPT_RESUME) {
+                    resume_file = optarg;
+                } else {
+                    snapshot_file = optarg;
+                }
+                break;
+            case OPT_SNAPSHOT_INTERVAL:
+                snapshot_interval = atof(optarg);
+                if (snapshot_interval < 0) {
+                    print_usage();
+                    return 1;
+                }
+                break;
+            case OPT_CHECKPOINT_INTERVAL:
+                checkpoint_interval = atof(optarg);
+                if (checkpoint_interval <= 0) {
+                    print_usage();
+                    return 1;
+                }
+                break;
+            case 'T':
+                time_limit = atof(optarg);
+                if (time_limit <= 0) {
+                    print_usage();
+                    return 1;
+                }
+                break;
+            case OPT_MULTILEVEL:
+                multilevel_base = atoi(optarg);
+                if (batch_mode || multilevel_base < 3) {
+                    print_usage();
+                    return 1;
+                }
+                break;
+            case OPT_MULTILEVEL_STEP:
+                multilevel_step = atoi(optarg);
+                if (multilevel_step < 1) {
+                    print_usage();
+                    return 1;
+                }
+                break;
+            case OPT_PRECHECK:
+                if (strcmp(optarg, "off") == 0) {
+                    precheck = PRECHECK_OFF;
+                } else if (strcmp(optarg, "on") == 0) {
+                    precheck = PRECHECK_ON;
+                } else if (strcmp(optarg, "full") == 0) {
+                    precheck = PRECHECK_FULL;
+                } else {
+                    print_usage();
+                    return 1;
+                }
+                break;
+            case OPT_RELOCATE:
+                relocate = atof(optarg);
+                if (relocate < 0 || relocate > 1) {
+                    print_usage();
+                    return 1;
+                }
+                break;
+            case OPT_ENGINE:
+                engine = engine_parse(optarg);
+                if (engine < 0) {
+                    print_usage();
+                    return 1;
+                }
+                break;
+            case OPT_RESTART:
+                restart = restart_parse(optarg);
+                if (restart < 0) {
+                    print_usage();
+                    return 1;
+                }
+                break;
+            case OPT_RESTART_SCHEDULE:
+                restart_schedule = schedule_parse(optarg);
+                if (restart_schedule < 0) {
+                    print_usage();
+                    return 1;
+                }
+                break;
+            case OPT_RESTART_LOG:
+                if (batch_mode) {
+                    print_usage();
+                    return 1;
+                }
+                restart_log_file = optarg;
+                break;
+            case OPT_MAX_ITERATIONS:
+                max_iterations = atoll(optarg);
+                if (max_iterations <= 0) {
+                    print_usage();
+                    return 1;
+                }
+                break;
             default:
                 print_usage();
                 return 1;
         }
     }
-    
-    pthread_t threads[NUM_THREADS];
-        
-    int N, constraint_count;
-    Constraint constraints[MAX_CONSTRAINTS];
-    int** constraints_per_point = calloc(MAX_POINTS, sizeof(int*));
-    for(int i = 0; i < MAX_POINTS; ++i) {
-        constraints_per_point[i] = calloc(MAX_CONSTRAINTS, sizeof(int));
+
+    if (margin >= 0) {
+        predicate_set_margin(margin);
+    }
+    if (multilevel_base > 0 && (strlen(symmetry_file) > 0 || checkpoint_file != NULL || resume_file != NULL)) {
+        printf("Error: --multilevel does not support symmetries (-c) or checkpoints\n");
+        return 1;
     }
-    int* constraints_per_point_count = calloc(MAX_POINTS, sizeof(int));
-    
-    parse_constraints(orientation_file, &N, constraints, &constraint_count, constraints_per_point, constraints_per_point_count);
 
-    color_printf(YELLOW, "Parsed %d constraints over %d points\n\n", constraint_count, N);
-    
-    _N = N;
+    if (batch_mode) {
+        int count;
+        char** paths = batch_collect_paths(orientation_file, &count);
+        if (count == 0) {
+            printf("No orientation files in %s\n", orientation_file);
+            return 1;
+        }
+        solver_config_t config = solver_config_default();
+        config.sub_iterations = sub_iterations;
+        config.min_dist = min_dist;
+        config.reset_its = reset_its;
+        config.num_candidates = num_candidates;
+        config.engine = engine;
+        config.weight_bump_its = weight_bump_its;
+        config.relocate = relocate;
+        config.restart = restart;
+        config.restart_schedule = restart_schedule;
+        config.time_limit = time_limit > 0 ? time_limit : 5.0;
+        config.max_iterations = max_iterations;
+        config.quiet = true;
+
+        // the evaluation kernel is calibrated once, on the first instance that loads
+        for (int i = 0; i < count; i++) {
+            Problem problem;
+            if (read_orientations(paths[i], &problem) == NULL) {
+                rng_t calibration_rng;
+                rng_init(&calibration_rng, GLOBAL_SEED);
+                eval_kernel_init(&problem, &calibration_rng);
+                problem_free(&problem);
+                break;
+            }
+        }
+
+        color_printf(YELLOW, "Batch");
+        printf(": %d instances from %s, %d workers, %.1f s per instance, %s kernel\n\n",
+            count, orientation_file, NUM_THREADS, config.time_limit, eval_kernel.name);
+        int solved = run_batch(paths, count, NUM_THREADS, &config, fixed_points_file, symmetry_file, GLOBAL_SEED, precheck,
+            output_given ? output_file : "batch_summary.json");
+
+        for (int i = 0; i < count; i++) {
+            free(paths[i]);
+        }
+        free(paths);
+        free(output_file);
+        free(fixed_points_file);
+        free(symmetry_file);
+        return solved == count ? EXIT_SOLVED : EXIT_BUDGET;
+    }
+
+    struct timespec load_start = get_time();
+    Problem problem;
+    load_orientations(orientation_file, &problem);
+    int N = problem.N;
+
+    color_printf(YELLOW, "Loaded %d constraints over %d points", problem.constraint_count, N);
+    printf(" from %s in %.1f ms\n\n", is_generator_spec(orientation_file) ? "the generator" : problem.mapping ? "a mapped binary file" :
+        is_binary_orientation_file(orientation_file) ? "a binary file" : "a text file", elapsed_time_sec(load_start, get_time()) * 1000);
+
+    // signs that no point set has are rejected before any search
+    if (precheck != PRECHECK_OFF) {
+        precheck_result_t precheck_result;
+        bool feasible = precheck_run(&problem, NUM_THREADS, precheck == PRECHECK_FULL, &precheck_result);
+        precheck_print(&precheck_result);
+        if (!feasible) {
+            problem_free(&problem);
+            free(output_file);
+            free(fixed_points_file);
+            free(symmetry_file);
+            return EXIT_INFEASIBLE;
+        }
+    }
+
+    // SIGINT and SIGTERM are only taken by the monitor thread. They are blocked once the precheck,
+    // whose threads are joined, is over: until then, they end the process at once.
+    monitor_block_signals();
     
-    bool* is_point_fixed = calloc(MAX_POINTS, sizeof(bool));
-    Point* fixed_points = calloc(MAX_POINTS, sizeof(Point));
+    bool* is_point_fixed = calloc(N, sizeof(bool));
+    Point* fixed_points = calloc(N, sizeof(Point));
     
     parse_fixed_points(fixed_points_file, N, fixed_points, is_point_fixed);
     
     Symmetry symmetry;
     
-    parse_symmetry(symmetry_file, &symmetry);        
-   
-    // Synchronization mutexes.
-    sync_init(&_sync);
+    parse_symmetry(symmetry_file, N, &symmetry);        
+
+    // under a symmetry, moves and evaluations work on orbits and on one constraint per rotation class
+    orbit_index_t orbit_index;
+    const orbit_index_t* orbits = NULL;
+    if (symmetry.num_cycles > 0) {
+        orbit_index_build(&orbit_index, &problem, &symmetry);
+        orbits = &orbit_index;
+        color_printf(YELLOW, "Symmetry");
+        printf(": %d orbits, %d-fold rotation, %d representatives for %d constraints\n\n",
+            orbits->num_orbits, orbits->order, orbits->reps.constraint_count, problem.constraint_count);
+        if (engine != ENGINE_LOCAL) {
+            printf("Warning: the %s engine does not support symmetries, the local search runs alone\n\n", engine_names[engine]);
+        }
+        if (restart != RESTART_ELITE) {
+            printf("Warning: %s restarts do not support symmetries, elite restarts are used\n\n", restart_names[restart]);
+        }
+    }
+
+    // the pool of best solutions, shared by the threads
+    synchronization_t sync;
+    sync_init(&sync, N);
+    if (restart_log_file != NULL) {
+        sync.restart_log = fopen(restart_log_file, "w");
+        if (sync.restart_log == NULL) {
+            printf("Error opening restart log %s\n", restart_log_file);
+            return 1;
+        }
+    }
     
+    solver_config_t config = solver_config_default();
+    config.sub_iterations = sub_iterations;
+    config.min_dist = min_dist;
+    config.reset_its = reset_its;
+    config.num_candidates = num_candidates;
+    config.engine = engine;
+    config.weight_bump_its = weight_bump_its;
+    config.relocate = relocate;
+    config.restart = restart;
+    config.restart_schedule = restart_schedule;
+    config.time_limit = time_limit;
+    config.max_iterations = max_iterations;
+
+    // a resumed search takes its threads, their configurations, the elite pool and the orientation
+    // predicate from the checkpoint, and goes on saving to it unless told otherwise
+    checkpoint_t checkpoint;
+    if (resume_file != NULL) {
+        checkpoint_load(&checkpoint, resume_file, &problem, &sync);
+        NUM_THREADS = checkpoint.num_threads;
+        color_printf(YELLOW, "Resuming");
+        printf(" %d threads from %s (their configurations replace -i, -r, -k, -t and -p)\n\n", NUM_THREADS, resume_file);
+        if (checkpoint_file == NULL) {
+            checkpoint_file = resume_file;
+        }
+        // the budget is the one of this run
+        for (int i = 0; i < NUM_THREADS; i++) {
+            checkpoint.configs[i].time_limit = time_limit;
+            checkpoint.configs[i].max_iterations = max_iterations;
+        }
+        config = checkpoint.configs[0];
+    }
+
+    // with a portfolio, thread t runs entry t % count; otherwise every thread runs `config`
+    portfolio_t portfolio = { &config, 1 };
+    if (portfolio_file != NULL && resume_file == NULL) {
+        if (strcmp(portfolio_file, "default") == 0) {
+            portfolio_default(&config, &portfolio);
+        } else {
+            parse_portfolio(portfolio_file, &config, &portfolio);
+        }
+        color_printf(YELLOW, "Portfolio");
+        printf(": %d configurations over %d threads\n", portfolio.count, NUM_THREADS);
+        for (int e = 0; e < portfolio.count && e < NUM_THREADS; e++) {
+            char description[256];
+            solver_config_describe(&portfolio.configs[e], description, sizeof(description));
+            printf("\t entry %d: %s\n", e, description);
+        }
+        printf("\n");
+    }
+
+    print_memory_footprint(&problem, &config, orbits, NUM_THREADS);
+
+    color_printf(YELLOW, "Orientation predicate");
+    if (predicate.exact) {
+        printf(": exact signs (filtered, with exact fallback)\n");
+    } else if (predicate.relative > 0) {
+        printf(": |det| > %g * L^2, L the longest edge of the triangle, scale-relative\n", predicate.relative);
+    } else {
+        printf(": |det| > %g, absolute\n", predicate.absolute);
+    }
+
+    rng_t calibration_rng;
+    rng_init(&calibration_rng, GLOBAL_SEED);
+    int kernel_candidates = eval_kernel_init(&problem, &calibration_rng);
+    color_printf(YELLOW, "Evaluation kernel");
+    printf(": %s (fastest of %d), full evaluation at %.1f M constraints/s\n\n", eval_kernel.name, kernel_candidates, eval_kernel_rate / 1e6);
     
     
+    if (checkpoint_file != NULL) {
+        if (resume_file == NULL) {
+            checkpoint_init(&checkpoint, &problem, NUM_THREADS, &sync);
+            for (int i = 0; i < NUM_THREADS; i++) {
+                checkpoint.configs[i] = portfolio.configs[i % portfolio.count];
+            }
+        }
+        checkpoint_start(&checkpoint, checkpoint_file, checkpoint_interval);
+        color_printf(YELLOW, "Checkpoints");
+        printf(": every %.0f s to %s\n\n", checkpoint_interval, checkpoint_file);
+    }
+
+    pthread_t threads[NUM_THREADS];
     thread_params_t* params = calloc(NUM_THREADS, sizeof(thread_params_t));
-    
-    // Create threads
-    for (int i = 0; i < NUM_THREADS; i++) {
-   
-        params[i].thread_id = i + 1;
-        params[i].N = N;
-        params[i].constraints = constraints;
-        params[i].constraint_count = constraint_count;
-        params[i].constraints_per_point =  constraints_per_point;
-        params[i].constraints_per_point_count = constraints_per_point_count;
-        params[i].is_point_fixed = is_point_fixed;
-        params[i].fixed_points = fixed_points;
-        params[i].symmetry = &symmetry;
-        params[i].sub_iterations = sub_iterations;
-        params[i].MIN_DIST = min_dist;
-        params[i].points = calloc(MAX_POINTS, sizeof(Point));
-        params[i].output_file = output_file;
-        params[i].reset_its = reset_its;
-        params[i].sync = &_sync;
-        params[i].rng = malloc(sizeof(rng_t));
-        rng_init(params[i].rng, GLOBAL_SEED + i);
-
-        if (pthread_create(&threads[i], NULL, thread_solve, &params[i]) != 0) {
-            perror("Failed to create thread");
-            return 1;
+
+    search_stats_t* stats = NULL; // per thread
+    stats_stream_t stats_stream;
+    if (stats_file != NULL) {
+        stats = aligned_alloc(_Alignof(search_stats_t), NUM_THREADS * sizeof(search_stats_t));
+        for (int i = 0; i < NUM_THREADS; i++) {
+            stats_init(&stats[i]);
+        }
+        stats_stream_start(&stats_stream, stats_file, stats, NUM_THREADS, stats_interval);
+    }
+
+    monitor_t monitor;
+    monitor_init(&monitor, &sync, N);
+    if (snapshot_file != NULL) {
+        monitor.snapshot_path = snapshot_file;
+        monitor.snapshot_interval = snapshot_interval;
+        color_printf(YELLOW, "Snapshots");
+        if (snapshot_interval > 0) {
+            printf(": best solution every %.1f s to %s\n\n", snapshot_interval, snapshot_file);
+        } else {
+            printf(": best solution after each improvement to %s\n\n", snapshot_file);
         }
     }
+    monitor_start(&monitor);
     
     color_printf(CYAN, "=========================================================\n");
     color_printf(CYAN, "========================  STARTING  =====================\n");
     color_printf(CYAN, "=========================================================\n\n");
     
-       // Join all threads
-    for (int i = 0; i < NUM_THREADS; i++) {
-        if (pthread_join(threads[i], NULL) != 0) {
-            perror("Failed to join thread");
-            return 1;
+    bool solved = false;
+    if (multilevel_base > 0) {
+        solved = multilevel_solve(&problem, portfolio.configs, portfolio.count, NUM_THREADS, multilevel_base, multilevel_step,
+            is_point_fixed, fixed_points, &sync, output_file, GLOBAL_SEED, stats);
+    } else {
+        // Create threads
+        for (int i = 0; i < NUM_THREADS; i++) {
+   
+            params[i].thread_id = i + 1;
+            params[i].problem = &problem;
+            params[i].is_point_fixed = is_point_fixed;
+            params[i].fixed_points = fixed_points;
+            params[i].symmetry = &symmetry;
+            params[i].orbits = orbits;
+            params[i].config = checkpoint_file != NULL ? &checkpoint.configs[i] : &portfolio.configs[i % portfolio.count];
+            params[i].points = calloc(N, sizeof(Point));
+            params[i].output_file = output_file;
+            params[i].sync = &sync;
+            params[i].stats = stats != NULL ? &stats[i] : NULL;
+            params[i].state = checkpoint_file != NULL ? &checkpoint.states[i] : NULL;
+            params[i].rng = aligned_alloc(_Alignof(rng_t), sizeof(rng_t));
+            rng_init(params[i].rng, GLOBAL_SEED + i);
+            arena_init(&params[i].arena, solver_workspace_bytes(&problem, params[i].config, orbits));
+
+            if (pthread_create(&threads[i], NULL, thread_solve, &params[i]) != 0) {
+                perror("Failed to create thread");
+                return 1;
+            }
         }
+    
+        // Join all threads
+        for (int i = 0; i < NUM_THREADS; i++) {
+            if (pthread_join(threads[i], NULL) != 0) {
+                perror("Failed to join thread");
+                return 1;
+            }
 
-        free(params[i].points);
-        free(params[i].rng);
+            solved = solved || params[i].result.solved;
+            free(params[i].points);
+            free(params[i].rng);
+            arena_free(&params[i].arena);
         
+        }
     }
-    
-    free(constraints_per_point_count);
-    for(int i = 0; i < MAX_POINTS; ++i) {
-        free(constraints_per_point[i]);
+
+    monitor_stop(&monitor);
+    int interrupted = atomic_load(&monitor.interrupted);
+    if (snapshot_file != NULL) {
+        color_printf(YELLOW, "Snapshots");
+        printf(": %d written to %s\n", monitor.snapshots, snapshot_file);
+    }
+    monitor_free(&monitor);
+
+    if (!solved) {
+        // the budget ran out, or the run was interrupted: the result is the best solution of the pool
+        Point* best = calloc(N, sizeof(Point));
+        int violations = sync_copy_best_solution(&sync, best);
+        printf("\n");
+        color_printf(RED, interrupted ? "Interrupted" : "Budget exhausted");
+        if (violations == INT32_MAX) {
+            printf(": no solution was published yet\n");
+        } else {
+            serialize_solution(N, best, output_file);
+            printf(": best solution, with %d violations, saved to %s\n", violations, output_file);
+        }
+        free(best);
+        if (checkpoint_file != NULL && checkpoint_save(&checkpoint)) {
+            color_printf(YELLOW, "Checkpoint saved to %s\n", checkpoint_file);
+        }
+    }
+
+    color_printf(YELLOW, "Elite pool");
+    printf(": %lld solutions published, %lld contended accesses\n",
+        (long long)atomic_load(&sync.publications), (long long)atomic_load(&sync.contention));
+
+    if (stats_file != NULL) {
+        stats_stream_finish(&stats_stream);
+        stats_stream_destroy(&stats_stream);
+        color_printf(YELLOW, "Search statistics");
+        printf(" saved to %s\n", stats_file);
+        free(stats);
+    }
+
+    if (checkpoint_file != NULL) {
+        // the search is over: the last checkpoint is left as it is
+        checkpoint_stop(&checkpoint);
+        checkpoint_free(&checkpoint);
+    }
+
+    if (sync.restart_log != NULL) {
+        sync_flush_restart_log(&sync);
+        fclose(sync.restart_log);
+        color_printf(YELLOW, "Restart log");
+        printf(" saved to %s\n", restart_log_file);
+    }
+    sync_destroy(&sync);
+    if (portfolio_file != NULL && resume_file == NULL) {
+        portfolio_free(&portfolio);
+    }
+    problem_free(&problem);
+    symmetry_free(&symmetry);
+    if (orbits != NULL) {
+        orbit_index_free(&orbit_index);
     }
     
-    sync_destroy(&_sync);
-    
+    free(is_point_fixed);
+    free(fixed_points);
     free(params);
     free(output_file);
+    free(fixed_points_file);
+    free(symmetry_file);
 
-    return 0;
+    return solved ? EXIT_SOLVED : interrupted ? EXIT_INTERRUPTED : EXIT_BUDGET;
 }
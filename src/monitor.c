@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include "utils.c"
+#include "threading.c"
+
+#ifndef MONITOR_H
+#define MONITOR_H
+
+// The monitor thread of a run. SIGINT and SIGTERM are blocked in every thread and only the monitor
+// takes them, with sigtimedwait, so the interrupt is handled in plain thread context. It only raises
+// the stop flag of the pool: the workers return as they do when another thread solves the problem,
+// and main() saves the best solution once they are all joined. The monitor also writes snapshots of
+// the best solution of the elite pool, so that a run can be followed from outside, and the restart
+// log lines the workers buffered; the workers only publish to the pool and never wait on a file.
+#define MONITOR_POLL_MS 50
+
+// Exit codes of a run
+#define EXIT_SOLVED 0
+#define EXIT_ERROR 1        // as every exit(1) on invalid input
+#define EXIT_BUDGET 2       // the time or iteration budget ran out first (batch: some instance unsolved)
+#define EXIT_INTERRUPTED 3  // SIGINT or SIGTERM
+#define EXIT_INFEASIBLE 4   // the signs violate the chirotope axioms (see precheck.c)
+
+typedef struct {
+    synchronization_t* sync;
+    int N;
+    sigset_t signals;
+    atomic_int interrupted;         // the signal that stopped the run, 0 if none
+    const char* snapshot_path;      // NULL for no snapshots
+    char* temp_path;
+    double snapshot_interval;       // seconds between snapshots, 0 for one after each improvement
+    Point* points;
+    int snapshot_violations;        // of the last snapshot written
+    int snapshots;                  // snapshots written so far
+    struct timespec start;
+    atomic_bool done;
+    pthread_t thread;
+} monitor_t;
+
+static void monitor_signal_set(sigset_t* signals) {
+    sigemptyset(signals);
+    sigaddset(signals, SIGINT);
+    sigaddset(signals, SIGTERM);
+}
+
+// Blocks SIGINT and SIGTERM in the calling thread, and in all the threads it creates afterwards:
+// to be called before any other thread is started.
+void monitor_block_signals() {
+    sigset_t signals;
+    monitor_signal_set(&signals);
+    if (pthread_sigmask(SIG_BLOCK, &signals, NULL) != 0) {
+        perror("Failed to block signals");
+        exit(1);
+    }
+}
+
+void monitor_init(monitor_t* monitor, synchronization_t* sync, int N) {
+    monitor->sync = sync;
+    monitor->N = N;
+    monitor_signal_set(&monitor->signals);
+    atomic_init(&monitor->interrupted, 0);
+    monitor->snapshot_path = NULL;
+    monitor->temp_path = NULL;
+    monitor->snapshot_interval = 0;
+    monitor->points = calloc(N, sizeof(Point));
+    monitor->snapshot_violations = INT32_MAX;
+    monitor->snapshots = 0;
+    atomic_init(&monitor->done, false);
+}
+
+// Writes the best pooled solution to the snapshot file, through a temporary file renamed over it,
+// so that a reader never sees a partial snapshot: a JSON object with the seconds since the start,
+// the violations and the points.
+static void monitor_write_snapshot(monitor_t* monitor) {
+    int violations = sync_copy_best_solution(monitor->sync, monitor->points);
+    if (violations == INT32_MAX) {
+        return;
+    }
+    FILE* file = fopen(monitor->temp_path, "w");
+    if (file == NULL) {
+        printf("Warning: could not write snapshot %s\n", monitor->temp_path);
+        return;
+    }
+    fprintf(file, "{\"time\": %.3f, \"violations\": %d, \"points\": [", elapsed_time_sec(monitor->start, get_time()), violations);
+    for (int i = 0; i < monitor->N; i++) {
+        fprintf(file, "[" COORDINATE_FORMAT ", " COORDINATE_FORMAT "]%s", monitor->points[i].x, monitor->points[i].y,
+            i + 1 < monitor->N ? ", " : "");
+    }
+    fprintf(file, "]}\n");
+    if (fclose(file) != 0 || rename(monitor->temp_path, monitor->snapshot_path) != 0) {
+        printf("Warning: could not write snapshot %s\n", monitor->snapshot_path);
+        unlink(monitor->temp_path);
+        return;
+    }
+    monitor->snapshot_violations = violations;
+    monitor->snapshots++;
+}
+
+// SIGINT or SIGTERM: stops the workers through the stop flag of the pool. Nothing is written here,
+// while they may still be moving: main() saves the solution, the checkpoint and the statistics
+// after joining them, and ends with EXIT_INTERRUPTED. Later signals are ignored.
+static void monitor_interrupt(monitor_t* monitor, int sig_num) {
+    if (atomic_exchange(&monitor->interrupted, sig_num) != 0) {
+        return;
+    }
+    pthread_mutex_lock(&monitor->sync->print_mutex);
+    printf("\nInterrupt signal (%d) received: stopping the threads.\n", sig_num);
+    pthread_mutex_unlock(&monitor->sync->print_mutex);
+    sync_set_stop(monitor->sync);
+}
+
+static void* monitor_worker(void* arg) {
+    monitor_t* monitor = arg;
+    double next = monitor->snapshot_interval;
+    while (!atomic_load(&monitor->done)) {
+        struct timespec timeout = { 0, MONITOR_POLL_MS * 1000000 };
+        int sig_num = sigtimedwait(&monitor->signals, NULL, &timeout);
+        if (sig_num > 0) {
+            monitor_interrupt(monitor, sig_num);
+        }
+        sync_flush_restart_log(monitor->sync);
+        if (monitor->snapshot_path == NULL || elapsed_time_sec(monitor->start, get_time()) < next) {
+            continue;
+        }
+        if (sync_best_violations(monitor->sync) < monitor->snapshot_violations) {
+            monitor_write_snapshot(monitor);
+        }
+        next += monitor->snapshot_interval;
+    }
+    return NULL;
+}
+
+// Starts the monitor. The signals must have been blocked with monitor_block_signals() beforehand.
+void monitor_start(monitor_t* monitor) {
+    if (monitor->snapshot_path != NULL) {
+        monitor->temp_path = malloc(strlen(monitor->snapshot_path) + 5);
+        sprintf(monitor->temp_path, "%s.tmp", monitor->snapshot_path);
+    }
+    monitor->start = get_time();
+    if (pthread_create(&monitor->thread, NULL, monitor_worker, monitor) != 0) {
+        perror("Failed to create thread");
+        exit(1);
+    }
+}
+
+// Stops the monitor once the workers are done, writing a last snapshot if the best solution improved,
+// and the restart log lines left.
+void monitor_stop(monitor_t* monitor) {
+    atomic_store(&monitor->done, true);
+    pthread_join(monitor->thread, NULL);
+    sync_flush_restart_log(monitor->sync);
+    if (monitor->snapshot_path != NULL && sync_best_violations(monitor->sync) < monitor->snapshot_violations) {
+        monitor_write_snapshot(monitor);
+    }
+}
+
+void monitor_free(monitor_t* monitor) {
+    free(monitor->points);
+    free(monitor->temp_path);
+}
+
+#endif // MONITOR_H
@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <math.h>
+#include "utils.c"
+#include "evaluation.c"
+#include "violations.c"
+
+#ifndef MOVES_H
+#define MOVES_H
+
+// Move engine for single-point moves.
+// When only point p moves, each constraint of p is a fixed half-plane bounded by the line through
+// its two other points u and v: sign * det(p, u, v) is affine in the new position (x, y) of p.
+// The two other points are gathered once per chosen point, and a batch of candidate positions is
+// then scored with a branch-free kernel that the compiler vectorizes over the candidates.
+// A candidate scores the weights of the constraints it violates, as vstate_score_weight() gives
+// them (times the search weights with adaptive weighting), so that it is ranked as the acceptance
+// of the move will judge it. Scores follow the predicate rule without its exact fallback: they only
+// rank candidates, and the chosen one is re-scored with constraint_violated().
+//
+// The same half-planes give an exact relocation move (move_engine_relocate): on a line through p,
+// each half-plane is a ray, so sorting the d points where the rays start splits the line into the
+// cells of the arrangement it crosses, and a sweep over them finds the best one in O(d log d).
+
+// Where the line enters or leaves a half-plane, and the change of the score past that point.
+typedef struct {
+    double t;
+    int delta;
+} move_event_t;
+
+typedef struct {
+    int max_degree;
+    int max_candidates;
+
+    // half-planes of the chosen point
+    int point;
+    int degree;
+    double* ux;
+    double* uy;
+    double* vx;
+    double* vy;
+    double* sign;
+    int* weight;            // score weight of the constraints, 0 for sign 0, which are never violated
+    int* id;                // the constraints
+    long long current_score;    // weight of the constraints of the chosen point violated at its current position
+
+    // candidate batch
+    int num_candidates;
+    double* cx;
+    double* cy;
+    long long* score;       // weight of the constraints of the chosen point each candidate would violate
+
+    move_event_t* events;   // of a relocation, up to max_degree
+} move_engine_t;
+
+size_t move_engine_bytes(int max_degree, int max_candidates) {
+    return 5 * arena_round(max_degree * sizeof(double))
+        + 2 * arena_round(max_degree * sizeof(int))
+        + arena_round(max_degree * sizeof(move_event_t))
+        + 2 * arena_round(max_candidates * sizeof(double))
+        + arena_round(max_candidates * sizeof(long long));
+}
+
+void move_engine_init(move_engine_t* engine, int max_degree, int max_candidates, arena_t* arena) {
+    engine->max_degree = max_degree;
+    engine->max_candidates = max_candidates;
+    engine->ux = arena_alloc(arena, max_degree * sizeof(double));
+    engine->uy = arena_alloc(arena, max_degree * sizeof(double));
+    engine->vx = arena_alloc(arena, max_degree * sizeof(double));
+    engine->vy = arena_alloc(arena, max_degree * sizeof(double));
+    engine->sign = arena_alloc(arena, max_degree * sizeof(double));
+    engine->weight = arena_alloc(arena, max_degree * sizeof(int));
+    engine->id = arena_alloc(arena, max_degree * sizeof(int));
+    engine->events = arena_alloc(arena, max_degree * sizeof(move_event_t));
+    engine->cx = arena_alloc(arena, max_candidates * sizeof(double));
+    engine->cy = arena_alloc(arena, max_candidates * sizeof(double));
+    engine->score = arena_alloc(arena, max_candidates * sizeof(long long));
+    engine->point = -1;
+    engine->degree = 0;
+    engine->num_candidates = 0;
+}
+
+// Precompute the half-planes of the constraints of point p, and their weights in the state `vs`.
+void move_engine_prepare(move_engine_t* engine, const Problem* problem, const violation_state_t* vs, const Point* points, int p) {
+    point_cursor_t cursor = point_cursor(problem, p);
+    engine->point = p;
+    engine->degree = problem_degree(problem, p);
+    engine->current_score = 0;
+    int id;
+    Constraint record;
+    const Constraint* constraint = &record;
+    for (int t = 0; point_cursor_next(&cursor, &id, &record); t++) {
+        int w = vstate_score_weight(vs, id);
+        engine->current_score += vs->violated[id] ? w : 0;
+
+        // det(i, j, k) is invariant under cyclic shifts, so det = det(p, u, v)
+        // with (u, v) the two other points in cyclic order.
+        Point u, v;
+        if (constraint->i - 1 == p) {
+            u = points[constraint->j - 1];
+            v = points[constraint->k - 1];
+        } else if (constraint->j - 1 == p) {
+            u = points[constraint->k - 1];
+            v = points[constraint->i - 1];
+        } else {
+            u = points[constraint->i - 1];
+            v = points[constraint->j - 1];
+        }
+        engine->ux[t] = u.x;
+        engine->uy[t] = u.y;
+        engine->vx[t] = v.x;
+        engine->vy[t] = v.y;
+        engine->sign[t] = constraint->sign;
+        engine->weight[t] = constraint->sign != 0 ? w : 0;
+        engine->id[t] = id;
+    }
+}
+
+// Scores each of the num_candidates positions in cx/cy by the weight of the constraints of the
+// prepared point it would violate.
+void move_engine_score(move_engine_t* engine) {
+    int K = engine->num_candidates;
+    long long* restrict score = engine->score;
+    const double* restrict cx = engine->cx;
+    const double* restrict cy = engine->cy;
+    for (int q = 0; q < K; q++) {
+        score[q] = 0;
+    }
+    double absolute = predicate.exact ? 0.0 : predicate.absolute, relative = predicate.relative;
+    for (int t = 0; t < engine->degree; t++) {
+        double ux = engine->ux[t], uy = engine->uy[t], vx = engine->vx[t], vy = engine->vy[t];
+        double sign = engine->sign[t];
+        long long weight = engine->weight[t];
+        double uv = (vx - ux) * (vx - ux) + (vy - uy) * (vy - uy);
+        for (int q = 0; q < K; q++) {
+            // det(p, u, v) and the longest edge, as in predicate_violated()
+            double dxu = ux - cx[q], dyu = uy - cy[q], dxv = vx - cx[q], dyv = vy - cy[q];
+            double determinant = dyv * dxu - dxv * dyu;
+            double longest = fmax(fmax(dxu * dxu + dyu * dyu, dxv * dxv + dyv * dyv), uv);
+            score[q] += sign * determinant <= absolute + relative * longest ? weight : 0;
+        }
+    }
+}
+
+// Picks the first candidate that strictly improves on the current position, and otherwise the
+// first (i.e. a uniformly random) candidate, exactly as a single-candidate move would.
+int move_engine_pick(const move_engine_t* engine) {
+    for (int q = 0; q < engine->num_candidates; q++) {
+        if (engine->score[q] < engine->current_score) {
+            return q;
+        }
+    }
+    return 0;
+}
+
+// Samples num_candidates positions in the ball of the given radius around point p,
+// and returns the one picked by move_engine_pick.
+Point move_engine_sample_best(move_engine_t* engine, const Problem* problem, const violation_state_t* vs,
+    const Point* points, int p, double radius, int num_candidates, rng_t* rng) {
+    move_engine_prepare(engine, problem, vs, points, p);
+    engine->num_candidates = num_candidates < engine->max_candidates ? num_candidates : engine->max_candidates;
+    // all the offsets at once, then shifted to the point
+    rng_disk_offsets(rng, radius, engine->cx, engine->cy, engine->num_candidates);
+    for (int q = 0; q < engine->num_candidates; q++) {
+        engine->cx[q] += points[p].x;
+        engine->cy[q] += points[p].y;
+    }
+    move_engine_score(engine);
+    int best = move_engine_pick(engine);
+    return (Point){ engine->cx[best], engine->cy[best] };
+}
+
+static int compare_events(const void* a, const void* b) {
+    double x = ((const move_event_t*)a)->t, y = ((const move_event_t*)b)->t;
+    return (x > y) - (x < y);
+}
+
+// Exact relocation of point p along a random line through it: the position within `radius` of p on
+// that line that minimizes the weighted violations of its constraints (as scored by vstate_score_move),
+// at the middle of its cell, the best cell being drawn at random among ties. The half-planes use the
+// absolute margin only, so with a relative margin the position is a close guess, re-scored by the caller.
+Point move_engine_relocate(move_engine_t* engine, const Problem* problem, const violation_state_t* vs,
+    const Point* points, int p, double radius, rng_t* rng) {
+    move_engine_prepare(engine, problem, vs, points, p);
+    double theta = rng_double(rng) * 2 * M_PI;
+    double dx = cos(theta), dy = sin(theta);
+    double px = points[p].x, py = points[p].y;
+    double absolute = predicate.exact ? 0.0 : predicate.absolute;
+
+    // at p + t (dx, dy), sign * det - absolute = a + t b: each constraint is violated on one side of
+    // t = -a / b, or everywhere or nowhere if b = 0
+    long long score = 0; // at t = -radius
+    int count = 0;
+    for (int t = 0; t < engine->degree; t++) {
+        int w = engine->weight[t];
+        if (w == 0) {
+            continue;
+        }
+        double ux = engine->ux[t], uy = engine->uy[t], vx = engine->vx[t], vy = engine->vy[t];
+        double sign = engine->sign[t];
+        double a = sign * ((vy - py) * (ux - px) - (vx - px) * (uy - py)) - absolute;
+        double b = sign * ((uy - vy) * dx + (vx - ux) * dy);
+        if (b == 0) {
+            score += a <= 0 ? w : 0;
+            continue;
+        }
+        double root = -a / b;
+        if (b > 0) {
+            // violated up to root
+            if (root > -radius) {
+                score += w;
+                if (root < radius) {
+                    engine->events[count++] = (move_event_t){ root, -w };
+                }
+            }
+        } else if (root < radius) {
+            // violated from root on
+            if (root <= -radius) {
+                score += w;
+            } else {
+                engine->events[count++] = (move_event_t){ root, w };
+            }
+        }
+    }
+    qsort(engine->events, count, sizeof(move_event_t), compare_events);
+
+    long long best = LLONG_MAX;
+    int ties = 0;
+    double best_t = 0, low = -radius;
+    for (int e = 0; e <= count; e++) {
+        double high = e < count ? engine->events[e].t : radius;
+        if (high > low && score <= best) {
+            ties = score < best ? 1 : ties + 1;
+            best = score;
+            if (ties == 1 || rng_double(rng) * ties < 1) {
+                best_t = (low + high) / 2;
+            }
+        }
+        if (e < count) {
+            score += engine->events[e].delta;
+            low = high;
+        }
+    }
+    return (Point){ px + best_t * dx, py + best_t * dy };
+}
+
+#endif // MOVES_H
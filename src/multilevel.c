@@ -0,0 +1,277 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "utils.c"
+#include "evaluation.c"
+#include "solver.c"
+#include "threading.c"
+#include "stats.c"
+#include "rng.c"
+
+#ifndef MULTILEVEL_H
+#define MULTILEVEL_H
+
+// Multilevel solving (--multilevel): the sub-chirotope of the first `base` points is solved first,
+// with the constraints among them only (as scripts/reduce_pointsets.py cuts a prefix of the points).
+// The next points are then inserted `step` at a time: each one is placed where it violates the fewest
+// of its constraints against the points already placed, and the search only runs on the new level if
+// the placement left violations. The last level is the whole problem.
+
+#define MULTILEVEL_SAMPLES 256          // random positions tried for an inserted point
+#define MULTILEVEL_REFINE_ROUNDS 12     // then rounds of samples around the best one, with halving radius
+#define MULTILEVEL_REFINE_SAMPLES 16
+#define MULTILEVEL_STALL_ITS 50000      // iterations per thread to repair a placement before a restart
+
+typedef struct {
+    int thread_id;
+    const Problem* problem;             // the level's
+    solver_config_t config;
+    synchronization_t* sync;
+    const bool* is_point_fixed;
+    const Point* fixed_points;
+    const Symmetry* symmetry;
+    const char* output_file;
+    Point* points;                      // N entries, the first n in use
+    rng_t rng;
+    arena_t arena;
+    search_stats_t* stats;
+    thread_state_t state;               // the placement the level starts from
+    solve_result_t result;
+} multilevel_thread_t;
+
+// The sub-problem of the first n points: the constraints among them, in the original order, so that
+// a complete chirotope stays complete.
+void problem_prefix(const Problem* problem, int n, Problem* sub) {
+    int count = 0;
+    for (int c = 0; c < problem->constraint_count; c++) {
+        const Constraint* constraint = &problem->constraints[c];
+        count += constraint->i <= n && constraint->j <= n && constraint->k <= n;
+    }
+    sub->N = n;
+    sub->constraint_count = count;
+    sub->constraints = malloc((count > 0 ? count : 1) * sizeof(Constraint));
+    count = 0;
+    for (int c = 0; c < problem->constraint_count; c++) {
+        const Constraint* constraint = &problem->constraints[c];
+        if (constraint->i <= n && constraint->j <= n && constraint->k <= n) {
+            sub->constraints[count++] = *constraint;
+        }
+    }
+    problem_build_index(sub);
+}
+
+// Number of `constraints` violated with point p at `candidate`.
+static int multilevel_score(const Constraint* constraints, int count, Point* points, int p, Point candidate) {
+    points[p] = candidate;
+    int violated = 0;
+    for (int c = 0; c < count; c++) {
+        const Constraint* constraint = &constraints[c];
+        violated += constraint_violated(constraint, points[constraint->i - 1], points[constraint->j - 1], points[constraint->k - 1]);
+    }
+    return violated;
+}
+
+// Places point p of the level problem given points 0 ... p-1: the best of random positions over the
+// extent of the placed points (tripled, so that the cells outside their hull are reached too), refined
+// around it. `constraints` has room for the degree of p. Returns the violations of p against the placed points.
+static int multilevel_place_point(const Problem* level, Point* points, int p, Constraint* constraints, rng_t* rng) {
+    int count = 0;
+    point_cursor_t cursor = point_cursor(level, p);
+    int id;
+    Constraint constraint;
+    while (point_cursor_next(&cursor, &id, &constraint)) {
+        if (constraint.i <= p + 1 && constraint.j <= p + 1 && constraint.k <= p + 1) {
+            constraints[count++] = constraint;
+        }
+    }
+
+    Point low = points[0], high = points[0];
+    for (int q = 1; q < p; q++) {
+        low.x = fmin(low.x, points[q].x);
+        low.y = fmin(low.y, points[q].y);
+        high.x = fmax(high.x, points[q].x);
+        high.y = fmax(high.y, points[q].y);
+    }
+    double width = fmax(high.x - low.x, 1.0), height = fmax(high.y - low.y, 1.0);
+
+    Point best = { 0, 0 };
+    int best_violations = INT32_MAX;
+    for (int s = 0; s < MULTILEVEL_SAMPLES && best_violations > 0; s++) {
+        Point candidate = { low.x - width + 3 * width * rng_double(rng), low.y - height + 3 * height * rng_double(rng) };
+        int violations = multilevel_score(constraints, count, points, p, candidate);
+        if (violations < best_violations) {
+            best = candidate;
+            best_violations = violations;
+        }
+    }
+    double radius = fmax(width, height) / 4;
+    for (int round = 0; round < MULTILEVEL_REFINE_ROUNDS && best_violations > 0; round++, radius /= 2) {
+        for (int s = 0; s < MULTILEVEL_REFINE_SAMPLES && best_violations > 0; s++) {
+            Point candidate = random_point_in_ball(best, radius, rng);
+            int violations = multilevel_score(constraints, count, points, p, candidate);
+            if (violations < best_violations) {
+                best = candidate;
+                best_violations = violations;
+            }
+        }
+    }
+    points[p] = best;
+    return best_violations;
+}
+
+static void* multilevel_thread(void* arg) {
+    multilevel_thread_t* thread = arg;
+    thread->result = solve(thread->problem, &thread->config, thread->points, thread->output_file, thread->thread_id,
+        thread->sync, &thread->rng, &thread->arena, thread->is_point_fixed, thread->fixed_points, thread->symmetry,
+        NULL, thread->stats, &thread->state);
+    return NULL;
+}
+
+// Runs one attempt at a level: all the threads from `placed` if `resume`, else from random points.
+// Returns the index of a thread that solved it, or -1, and adds the iterations of the threads.
+static int multilevel_run_level(multilevel_thread_t* threads, int num_threads, const solver_config_t* configs,
+    int config_count, const Problem* level, synchronization_t* sync, const char* output_file, bool quiet,
+    bool resume, const Point* placed, long long max_iterations, struct timespec start, long long* iterations) {
+    pthread_t* handles = malloc(num_threads * sizeof(pthread_t));
+    double remaining = configs[0].time_limit - elapsed_time_sec(start, get_time());
+    for (int t = 0; t < num_threads; t++) {
+        multilevel_thread_t* thread = &threads[t];
+        thread->problem = level;
+        thread->config = configs[t % config_count];
+        thread->config.quiet = quiet;
+        thread->config.max_iterations = max_iterations;
+        if (configs[0].time_limit > 0) {
+            thread->config.time_limit = remaining > 0 ? remaining : 1e-9;
+        }
+        thread->sync = sync;
+        thread->output_file = output_file;
+        thread_state_t* state = &thread->state;
+        state->resume = resume;
+        memcpy(state->points, placed, level->N * sizeof(Point));
+        state->rng = thread->rng;
+        state->iterations = 0;
+        state->its_since_checkpoint = 0;
+        state->reset_its = thread->config.reset_its;
+        state->weight_count = 0; // the weights of the previous level are for other constraints
+        if (pthread_create(&handles[t], NULL, multilevel_thread, thread) != 0) {
+            perror("Failed to create thread");
+            exit(1);
+        }
+    }
+    int winner = -1;
+    for (int t = 0; t < num_threads; t++) {
+        pthread_join(handles[t], NULL);
+        *iterations += threads[t].result.iterations;
+        if (threads[t].result.solved) {
+            winner = t;
+        }
+    }
+    free(handles);
+    return winner;
+}
+
+// Solves `problem` level by level with `num_threads` threads, thread t running configs[t % config_count].
+// Each level is solved by all the threads from the same placement; the last one shares `sync` and
+// saves the solution to `output_file`. Returns whether the problem was solved within the budget.
+bool multilevel_solve(const Problem* problem, const solver_config_t* configs, int config_count, int num_threads,
+    int base, int step, const bool* is_point_fixed, const Point* fixed_points, synchronization_t* sync,
+    const char* output_file, unsigned long long seed, search_stats_t* stats) {
+    int N = problem->N;
+    bool quiet = configs[0].quiet;
+    Symmetry symmetry = { NULL, NULL, 0 };
+    multilevel_thread_t* threads = aligned_alloc(_Alignof(multilevel_thread_t), num_threads * sizeof(multilevel_thread_t));
+    for (int t = 0; t < num_threads; t++) {
+        multilevel_thread_t* thread = &threads[t];
+        thread->thread_id = t + 1;
+        thread->is_point_fixed = is_point_fixed;
+        thread->fixed_points = fixed_points;
+        thread->symmetry = &symmetry;
+        thread->points = calloc(N, sizeof(Point));
+        rng_init(&thread->rng, seed + t);
+        // the levels are subsets of the problem, so its workspace fits them all
+        arena_init(&thread->arena, solver_workspace_bytes(problem, &configs[t % config_count], NULL));
+        thread->stats = stats != NULL ? &stats[t] : NULL;
+        thread_state_init(&thread->state, N, problem->constraint_count);
+    }
+    Point* placed = calloc(N, sizeof(Point));
+    Constraint* constraints = malloc(problem_max_degree(problem) * sizeof(Constraint));
+    rng_t placement_rng;
+    rng_init(&placement_rng, seed + num_threads);
+
+    struct timespec start = get_time();
+    bool solved = false;
+    int n = base < N ? base : N;
+    int previous = 0; // points of the previous level
+    for (int level = 0; ; level++) {
+        Problem sub;
+        problem_prefix(problem, n, &sub);
+        bool last = n == N;
+        int placed_violations = 0;
+        if (level > 0) {
+            for (int p = previous; p < n; p++) {
+                placed_violations += is_point_fixed[p] ? 0 : multilevel_place_point(&sub, placed, p, constraints, &placement_rng);
+                if (is_point_fixed[p]) {
+                    placed[p] = fixed_points[p];
+                }
+            }
+        }
+
+        synchronization_t level_sync;
+        synchronization_t* shared = last ? sync : &level_sync;
+        if (!last) {
+            sync_init(&level_sync, n);
+            level_sync.parent_stop = &sync->stop_flag; // an interrupt stops the level
+        }
+        // a placement the search cannot repair within MULTILEVEL_STALL_ITS is dropped, and the level
+        // solved again from random points (with an empty pool, but for the last level, whose pool is shared)
+        long long max_iterations = configs[0].max_iterations;
+        bool capped = level > 0 && (max_iterations == 0 || max_iterations > MULTILEVEL_STALL_ITS);
+        long long iterations = 0;
+        int winner = multilevel_run_level(threads, num_threads, configs, config_count, &sub, shared,
+            last ? output_file : "/dev/null", quiet || !last, level > 0, placed,
+            capped ? MULTILEVEL_STALL_ITS : max_iterations, start, &iterations);
+        bool restarted = winner < 0 && capped && !sync_should_stop(sync);
+        if (restarted) {
+            if (!last) {
+                sync_destroy(&level_sync);
+                sync_init(&level_sync, n);
+                level_sync.parent_stop = &sync->stop_flag;
+            }
+            winner = multilevel_run_level(threads, num_threads, configs, config_count, &sub, shared,
+                last ? output_file : "/dev/null", quiet || !last, false, placed, max_iterations, start, &iterations);
+        }
+        if (!last) {
+            sync_destroy(&level_sync);
+        }
+        if (!quiet && !last) {
+            color_printf(YELLOW, "[Level %d] ", level);
+            printf("%d points, %d constraints: inserted with %d violations, %s%s after %lld iterations [t %.2f s]\n",
+                n, sub.constraint_count, placed_violations, winner >= 0 ? "solved" : "unsolved",
+                restarted ? " from random points" : "", iterations, elapsed_time_sec(start, get_time()));
+        }
+        problem_free(&sub);
+        if (winner < 0 || last) {
+            solved = winner >= 0;
+            break;
+        }
+        memcpy(placed, threads[winner].points, n * sizeof(Point));
+        previous = n;
+        n = n + step < N ? n + step : N;
+    }
+
+    for (int t = 0; t < num_threads; t++) {
+        free(threads[t].points);
+        arena_free(&threads[t].arena);
+        thread_state_destroy(&threads[t].state);
+    }
+    free(threads);
+    free(placed);
+    free(constraints);
+    return solved;
+}
+
+#endif // MULTILEVEL_H
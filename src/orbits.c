@@ -0,0 +1,357 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "utils.c"
+#include "evaluation.c"
+#include "violations.c"
+
+#ifndef ORBITS_H
+#define ORBITS_H
+
+// Orbit-level view of a problem under a symmetry (-c).
+// Every cycle of the symmetry is an orbit, and every point outside the cycles is an orbit of its own.
+// Only the orbit leader is free: member j of a cycle of length len is the leader rotated by 2*pi*j/len,
+// so a move always drags the whole orbit along.
+//
+// When every point lies in a cycle, rotating the whole configuration by 2*pi/m, with m the gcd of the
+// cycle lengths, maps the (symmetric) configuration onto itself and permutes the points. A constraint
+// and its image under that rotation are then satisfied together, so only one representative per class
+// is kept, weighted by the size of its class.
+typedef struct {
+    int N;
+    int order;              // m, the order of the rotation used for deduplication (1 -> none)
+    int num_orbits;
+    int* orbit_of;          // orbit of each point
+    int* orbit_offsets;     // orbit members in CSR form, leader first, in cycle order
+    int* orbit_members;
+    int max_orbit_size;
+
+    Problem reps;           // one representative constraint per rotation class
+    int* rep_weight;        // size of the class of each representative
+
+    int* orbit_rep_offsets; // representatives touching each orbit, in CSR form
+    int* orbit_reps;
+    int max_orbit_degree;
+} orbit_index_t;
+
+static int gcd(int a, int b) {
+    while (b != 0) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static inline int orbit_size(const orbit_index_t* orbits, int orbit) {
+    return orbits->orbit_offsets[orbit + 1] - orbits->orbit_offsets[orbit];
+}
+
+static inline const int* orbit_point_members(const orbit_index_t* orbits, int orbit) {
+    return orbits->orbit_members + orbits->orbit_offsets[orbit];
+}
+
+static inline int orbit_degree(const orbit_index_t* orbits, int orbit) {
+    return orbits->orbit_rep_offsets[orbit + 1] - orbits->orbit_rep_offsets[orbit];
+}
+
+static inline const int* orbit_rep_constraints(const orbit_index_t* orbits, int orbit) {
+    return orbits->orbit_reps + orbits->orbit_rep_offsets[orbit];
+}
+
+// Sorts a triple in place and returns the sign of the sorting permutation.
+static int sort_triple(int* t) {
+    int parity = 1;
+    for (int a = 0; a < 2; a++) {
+        for (int b = 0; b < 2 - a; b++) {
+            if (t[b] > t[b+1]) {
+                int tmp = t[b];
+                t[b] = t[b+1];
+                t[b+1] = tmp;
+                parity = -parity;
+            }
+        }
+    }
+    return parity;
+}
+
+// Open addressing map from a sorted 0-based triple to its constraint id.
+typedef struct {
+    int64_t* keys;
+    int* values;
+    size_t mask;
+} triple_map_t;
+
+static inline int64_t triple_key(int N, const int* t) {
+    return ((int64_t)t[0] * N + t[1]) * N + t[2];
+}
+
+static inline size_t triple_hash(int64_t key, size_t mask) {
+    uint64_t h = (uint64_t)key * 0x9E3779B97F4A7C15ULL;
+    return (size_t)(h >> 17) & mask;
+}
+
+static void triple_map_init(triple_map_t* map, int count) {
+    size_t capacity = 16;
+    while (capacity < 2 * (size_t)count) {
+        capacity *= 2;
+    }
+    map->keys = malloc(capacity * sizeof(int64_t));
+    map->values = malloc(capacity * sizeof(int));
+    map->mask = capacity - 1;
+    for (size_t s = 0; s < capacity; s++) {
+        map->keys[s] = -1;
+    }
+}
+
+static void triple_map_put(triple_map_t* map, int64_t key, int value) {
+    size_t s = triple_hash(key, map->mask);
+    while (map->keys[s] != -1 && map->keys[s] != key) {
+        s = (s + 1) & map->mask;
+    }
+    map->keys[s] = key;
+    map->values[s] = value;
+}
+
+static int triple_map_get(const triple_map_t* map, int64_t key) {
+    size_t s = triple_hash(key, map->mask);
+    while (map->keys[s] != -1) {
+        if (map->keys[s] == key) {
+            return map->values[s];
+        }
+        s = (s + 1) & map->mask;
+    }
+    return -1;
+}
+
+static void triple_map_free(triple_map_t* map) {
+    free(map->keys);
+    free(map->values);
+}
+
+// Groups the constraints of `problem` into classes of constraints mapped onto each other by the
+// point permutation `perm` (of order m), and stores one representative per class in orbits->reps.
+// An image whose sign disagrees with the rotated representative is kept as a constraint of its own,
+// the instance is then simply unsatisfiable under this symmetry.
+static void orbit_index_dedup(orbit_index_t* orbits, const Problem* problem, const int* perm, int m) {
+    int N = problem->N;
+    int count = problem->constraint_count;
+    triple_map_t map;
+    triple_map_init(&map, count);
+    for (int c = 0; c < count; c++) {
+        int t[3] = { problem->constraints[c].i - 1, problem->constraints[c].j - 1, problem->constraints[c].k - 1 };
+        sort_triple(t);
+        triple_map_put(&map, triple_key(N, t), c);
+    }
+
+    bool* visited = calloc(count > 0 ? count : 1, sizeof(bool));
+    orbits->reps.N = N;
+    orbits->reps.constraints = malloc((count > 0 ? count : 1) * sizeof(Constraint));
+    orbits->rep_weight = malloc((count > 0 ? count : 1) * sizeof(int));
+    int reps = 0;
+    for (int c = 0; c < count; c++) {
+        if (visited[c]) {
+            continue;
+        }
+        visited[c] = true;
+        const Constraint* constraint = &problem->constraints[c];
+        int weight = 1;
+        int t[3] = { constraint->i - 1, constraint->j - 1, constraint->k - 1 };
+        for (int r = 1; r < m; r++) {
+            // t holds the r-th image of the constraint, in its original (unsorted) order
+            for (int a = 0; a < 3; a++) {
+                t[a] = perm[t[a]];
+            }
+            int sorted[3] = { t[0], t[1], t[2] };
+            int parity = sort_triple(sorted);
+            int d = triple_map_get(&map, triple_key(N, sorted));
+            if (d == -1 || visited[d]) {
+                continue;
+            }
+            // det is invariant under rotations, so the image must have the same sign once reordered
+            const Constraint* image = &problem->constraints[d];
+            int u[3] = { image->i - 1, image->j - 1, image->k - 1 };
+            if (image->sign * sort_triple(u) == constraint->sign * parity) {
+                visited[d] = true;
+                weight++;
+            }
+        }
+        orbits->reps.constraints[reps] = *constraint;
+        orbits->rep_weight[reps] = weight;
+        reps++;
+    }
+    orbits->reps.constraint_count = reps;
+    problem_build_index(&orbits->reps);
+
+    free(visited);
+    triple_map_free(&map);
+}
+
+void orbit_index_build(orbit_index_t* orbits, const Problem* problem, const Symmetry* symmetry) {
+    int N = problem->N;
+    orbits->N = N;
+    orbits->orbit_of = malloc(N * sizeof(int));
+    orbits->orbit_offsets = malloc((N + 1) * sizeof(int));
+    orbits->orbit_members = malloc(N * sizeof(int));
+    for (int p = 0; p < N; p++) {
+        orbits->orbit_of[p] = -1;
+    }
+
+    // cycles first, then the points outside of every cycle
+    int orbit = 0;
+    int used = 0;
+    int m = 0;
+    for (int c = 0; c < symmetry->num_cycles; c++) {
+        orbits->orbit_offsets[orbit] = used;
+        for (int j = 0; j < symmetry->cycle_lengths[c]; j++) {
+            int p = symmetry->cycles[c][j];
+            if (orbits->orbit_of[p] != -1) {
+                printf("ERROR: Point %d appears in more than one cycle of the symmetry file\n", p + 1);
+                exit(1);
+            }
+            orbits->orbit_of[p] = orbit;
+            orbits->orbit_members[used++] = p;
+        }
+        m = gcd(m, symmetry->cycle_lengths[c]);
+        orbit++;
+    }
+    for (int p = 0; p < N; p++) {
+        if (orbits->orbit_of[p] == -1) {
+            orbits->orbit_offsets[orbit] = used;
+            orbits->orbit_of[p] = orbit++;
+            orbits->orbit_members[used++] = p;
+            m = 1; // a free point is not moved by the rotation
+        }
+    }
+    orbits->orbit_offsets[orbit] = used;
+    orbits->num_orbits = orbit;
+    orbits->order = m > 0 ? m : 1;
+    orbits->max_orbit_size = 0;
+    for (int o = 0; o < orbits->num_orbits; o++) {
+        orbits->max_orbit_size = orbit_size(orbits, o) > orbits->max_orbit_size ? orbit_size(orbits, o) : orbits->max_orbit_size;
+    }
+
+    // the rotation by 2*pi/m moves member j of a cycle of length len to member j + len/m
+    int* perm = malloc(N * sizeof(int));
+    for (int p = 0; p < N; p++) {
+        perm[p] = p;
+    }
+    for (int c = 0; c < symmetry->num_cycles && orbits->order > 1; c++) {
+        int len = symmetry->cycle_lengths[c];
+        for (int j = 0; j < len; j++) {
+            perm[symmetry->cycles[c][j]] = symmetry->cycles[c][(j + len / orbits->order) % len];
+        }
+    }
+    orbit_index_dedup(orbits, problem, perm, orbits->order);
+    free(perm);
+
+    // representatives touching each orbit, each listed once
+    int R = orbits->reps.constraint_count;
+    int* last_seen = malloc(orbits->num_orbits * sizeof(int));
+    for (int o = 0; o < orbits->num_orbits; o++) {
+        last_seen[o] = -1;
+    }
+    orbits->orbit_rep_offsets = calloc(orbits->num_orbits + 1, sizeof(int));
+    for (int c = 0; c < R; c++) {
+        const Constraint* constraint = &orbits->reps.constraints[c];
+        int touched[3] = { orbits->orbit_of[constraint->i - 1], orbits->orbit_of[constraint->j - 1], orbits->orbit_of[constraint->k - 1] };
+        for (int a = 0; a < 3; a++) {
+            if (last_seen[touched[a]] != c) {
+                last_seen[touched[a]] = c;
+                orbits->orbit_rep_offsets[touched[a] + 1]++;
+            }
+        }
+    }
+    for (int o = 0; o < orbits->num_orbits; o++) {
+        orbits->orbit_rep_offsets[o + 1] += orbits->orbit_rep_offsets[o];
+    }
+    orbits->orbit_reps = malloc((orbits->orbit_rep_offsets[orbits->num_orbits] > 0 ? orbits->orbit_rep_offsets[orbits->num_orbits] : 1) * sizeof(int));
+    int* fill = malloc(orbits->num_orbits * sizeof(int));
+    memcpy(fill, orbits->orbit_rep_offsets, orbits->num_orbits * sizeof(int));
+    for (int o = 0; o < orbits->num_orbits; o++) {
+        last_seen[o] = -1;
+    }
+    for (int c = 0; c < R; c++) {
+        const Constraint* constraint = &orbits->reps.constraints[c];
+        int touched[3] = { orbits->orbit_of[constraint->i - 1], orbits->orbit_of[constraint->j - 1], orbits->orbit_of[constraint->k - 1] };
+        for (int a = 0; a < 3; a++) {
+            if (last_seen[touched[a]] != c) {
+                last_seen[touched[a]] = c;
+                orbits->orbit_reps[fill[touched[a]]++] = c;
+            }
+        }
+    }
+    orbits->max_orbit_degree = 0;
+    for (int o = 0; o < orbits->num_orbits; o++) {
+        orbits->max_orbit_degree = orbit_degree(orbits, o) > orbits->max_orbit_degree ? orbit_degree(orbits, o) : orbits->max_orbit_degree;
+    }
+    free(fill);
+    free(last_seen);
+}
+
+size_t orbit_index_bytes(const orbit_index_t* orbits) {
+    return problem_bytes(&orbits->reps)
+        + orbits->reps.constraint_count * sizeof(int)
+        + (3 * orbits->N + 1) * sizeof(int)
+        + (orbits->num_orbits + 1 + orbits->orbit_rep_offsets[orbits->num_orbits]) * sizeof(int);
+}
+
+void orbit_index_free(orbit_index_t* orbits) {
+    problem_free(&orbits->reps);
+    free(orbits->rep_weight);
+    free(orbits->orbit_of);
+    free(orbits->orbit_offsets);
+    free(orbits->orbit_members);
+    free(orbits->orbit_rep_offsets);
+    free(orbits->orbit_reps);
+}
+
+// Moves an orbit: its leader goes to `lead` and every other member to the matching rotation of it.
+void orbit_place(const orbit_index_t* orbits, Point* points, int orbit, Point lead) {
+    const int* members = orbit_point_members(orbits, orbit);
+    int len = orbit_size(orbits, orbit);
+    for (int j = 0; j < len; j++) {
+        points[members[j]] = rotate_r_k(lead, j, len);
+    }
+}
+
+// Change in the weighted number of violated representatives (in violated_score with adaptive weighting)
+// if the leader of `orbit` is moved to `lead`.
+// Only the representatives touching the orbit are evaluated; the flips are written to `changed`.
+// `points` is used as scratch and holds the moved orbit on return, `saved` must hold max_orbit_size
+// points and receives the previous positions of the members, so that the caller can undo the move.
+long long orbit_score_move(const orbit_index_t* orbits, const violation_state_t* vs, Point* points,
+    int orbit, Point lead, Point* saved, int* changed, int* changed_count) {
+    const int* members = orbit_point_members(orbits, orbit);
+    int len = orbit_size(orbits, orbit);
+    for (int j = 0; j < len; j++) {
+        saved[j] = points[members[j]];
+    }
+    orbit_place(orbits, points, orbit, lead);
+
+    const int* reps = orbit_rep_constraints(orbits, orbit);
+    int degree = orbit_degree(orbits, orbit);
+    long long delta = 0;
+    *changed_count = 0;
+    for (int t = 0; t < degree; t++) {
+        int c = reps[t];
+        const Constraint* constraint = &orbits->reps.constraints[c];
+        bool violated = constraint_violated(constraint, points[constraint->i - 1], points[constraint->j - 1], points[constraint->k - 1]);
+        if (violated != vs->violated[c]) {
+            delta += violated ? vstate_score_weight(vs, c) : -vstate_score_weight(vs, c);
+            changed[(*changed_count)++] = c;
+        }
+    }
+    return delta;
+}
+
+void orbit_restore(const orbit_index_t* orbits, Point* points, int orbit, const Point* saved) {
+    const int* members = orbit_point_members(orbits, orbit);
+    int len = orbit_size(orbits, orbit);
+    for (int j = 0; j < len; j++) {
+        points[members[j]] = saved[j];
+    }
+}
+
+#endif // ORBITS_H
@@ -0,0 +1,229 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "utils.c"
+
+#ifndef PENALTY_H
+#define PENALTY_H
+
+// The continuous engine: all the points move at once, down the gradient of a smooth penalty
+//   f = sum over the constraints of softplus(β (margin - sign * det)) / β  +  λ |p - center|^2
+// which is about the missing margin for a violated constraint and vanishes for a satisfied one,
+// unlike the violation count, which is flat between two flips. det is bilinear in the points, so
+// the gradient is exact and costs one pass over the constraint columns. It is minimized with
+// L-BFGS and a backtracking line search. The small pull towards the center of the initial box
+// keeps the points at the scale the local search works at.
+#define PENALTY_MARGIN 1.0          // det aimed at, at the scale of the initial 10 x 10 box
+#define PENALTY_SHARPNESS 4.0       // β
+#define PENALTY_CUTOFF -30.0        // β (margin - sign * det) below which a term is taken as 0
+#define PENALTY_PULL 1e-4           // λ
+#define PENALTY_CENTER 5.0
+#define PENALTY_HISTORY 8           // (s, y) pairs kept by L-BFGS
+#define PENALTY_ITERATIONS 100      // L-BFGS iterations per run
+#define PENALTY_LINE_SEARCH 30      // step halvings before a run gives up
+#define PENALTY_TOLERANCE 1e-9      // on the largest gradient component
+#define PENALTY_KICK 1.0            // radius of the random moves of the points of violated constraints after a run
+#define PENALTY_RESET_RUNS 50       // runs without improvement before a reset, with the penalty engine alone
+#define PENALTY_PLATEAU 2000        // hybrid: local search iterations without improvement before a run
+
+// Engines of a solve() call
+#define ENGINE_LOCAL 0              // the random-ball local search alone
+#define ENGINE_HYBRID 1             // the local search, polished by the penalty engine on plateaus and after resets
+#define ENGINE_PENALTY 2            // the penalty engine alone, restarted with random kicks
+
+static const char* const engine_names[] = { "local", "hybrid", "penalty" };
+
+// The engine called `name`, or -1.
+int engine_parse(const char* name) {
+    for (int e = 0; e < (int)(sizeof(engine_names) / sizeof(engine_names[0])); e++) {
+        if (strcmp(name, engine_names[e]) == 0) {
+            return e;
+        }
+    }
+    return -1;
+}
+
+// L-BFGS buffers over the 2N coordinates, x then y.
+typedef struct {
+    int n;
+    double* v;
+    double* gradient;
+    double* direction;
+    double* v_next;
+    double* gradient_next;
+    double* s;              // PENALTY_HISTORY rows of n
+    double* y;
+    double* rho;
+    double* alpha;
+} penalty_workspace_t;
+
+size_t penalty_workspace_bytes(int N) {
+    int n = 2 * N;
+    return 5 * arena_round(n * sizeof(double)) + 2 * arena_round(PENALTY_HISTORY * n * sizeof(double))
+        + 2 * arena_round(PENALTY_HISTORY * sizeof(double));
+}
+
+void penalty_workspace_init(penalty_workspace_t* ws, int N, arena_t* arena) {
+    int n = 2 * N;
+    ws->n = n;
+    ws->v = arena_alloc(arena, n * sizeof(double));
+    ws->gradient = arena_alloc(arena, n * sizeof(double));
+    ws->direction = arena_alloc(arena, n * sizeof(double));
+    ws->v_next = arena_alloc(arena, n * sizeof(double));
+    ws->gradient_next = arena_alloc(arena, n * sizeof(double));
+    ws->s = arena_alloc(arena, PENALTY_HISTORY * n * sizeof(double));
+    ws->y = arena_alloc(arena, PENALTY_HISTORY * n * sizeof(double));
+    ws->rho = arena_alloc(arena, PENALTY_HISTORY * sizeof(double));
+    ws->alpha = arena_alloc(arena, PENALTY_HISTORY * sizeof(double));
+}
+
+// Penalty at the coordinates v (x[0 ... N-1], then y), with its gradient, zero for frozen points.
+double penalty_value(const ConstraintColumns* columns, int count, int N, const bool* frozen, const double* v, double* gradient) {
+    const double* x = v;
+    const double* y = v + N;
+    double* gx = gradient;
+    double* gy = gradient + N;
+    double f = 0;
+    for (int p = 0; p < N; p++) {
+        double cx = x[p] - PENALTY_CENTER, cy = y[p] - PENALTY_CENTER;
+        f += PENALTY_PULL * (cx * cx + cy * cy);
+        gx[p] = 2 * PENALTY_PULL * cx;
+        gy[p] = 2 * PENALTY_PULL * cy;
+    }
+    for (int c = 0; c < count; c++) {
+        int sign = columns->sign[c];
+        int i = columns->i[c], j = columns->j[c], k = columns->k[c];
+        double dxj = x[j] - x[i], dyj = y[j] - y[i], dxk = x[k] - x[i], dyk = y[k] - y[i];
+        double z = PENALTY_SHARPNESS * (PENALTY_MARGIN - sign * (dxj * dyk - dyj * dxk));
+        if (sign == 0 || z < PENALTY_CUTOFF) {
+            continue;
+        }
+        // softplus(z) / β and its derivative in det, -sign * sigmoid(z)
+        double e = exp(-fabs(z));
+        f += ((z > 0 ? z : 0) + log1p(e)) / PENALTY_SHARPNESS;
+        double d = -sign * (z > 0 ? 1 / (1 + e) : e / (1 + e));
+        gx[i] += d * (dyj - dyk);
+        gy[i] += d * (dxk - dxj);
+        gx[j] += d * dyk;
+        gy[j] -= d * dxk;
+        gx[k] -= d * dyj;
+        gy[k] += d * dxj;
+    }
+    for (int p = 0; p < N; p++) {
+        if (frozen[p]) {
+            gx[p] = 0;
+            gy[p] = 0;
+        }
+    }
+    return f;
+}
+
+static double penalty_dot(const double* a, const double* b, int n) {
+    double sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+// Runs L-BFGS from `points` for up to `iterations` iterations and writes the result back.
+// Returns the final penalty.
+double penalty_minimize(penalty_workspace_t* ws, const Problem* problem, const bool* frozen, Point* points, int iterations) {
+    int N = problem->N, n = ws->n;
+    const ConstraintColumns* columns = &problem->columns;
+    for (int p = 0; p < N; p++) {
+        ws->v[p] = points[p].x;
+        ws->v[N + p] = points[p].y;
+    }
+    double f = penalty_value(columns, problem->constraint_count, N, frozen, ws->v, ws->gradient);
+    int stored = 0, newest = -1; // pairs in the history, and the row of the last one
+
+    for (int it = 0; it < iterations; it++) {
+        double largest = 0;
+        for (int i = 0; i < n; i++) {
+            largest = fmax(largest, fabs(ws->gradient[i]));
+        }
+        if (largest < PENALTY_TOLERANCE) {
+            break;
+        }
+
+        // two-loop recursion: direction = -H gradient
+        memcpy(ws->direction, ws->gradient, n * sizeof(double));
+        for (int h = 0; h < stored; h++) {
+            int row = (newest - h + PENALTY_HISTORY) % PENALTY_HISTORY;
+            ws->alpha[row] = ws->rho[row] * penalty_dot(&ws->s[row * n], ws->direction, n);
+            for (int i = 0; i < n; i++) {
+                ws->direction[i] -= ws->alpha[row] * ws->y[row * n + i];
+            }
+        }
+        double scale = stored > 0
+            ? 1 / (ws->rho[newest] * penalty_dot(&ws->y[newest * n], &ws->y[newest * n], n))
+            : 1 / fmax(largest, 1.0);
+        for (int i = 0; i < n; i++) {
+            ws->direction[i] *= scale;
+        }
+        for (int h = stored - 1; h >= 0; h--) {
+            int row = (newest - h + PENALTY_HISTORY) % PENALTY_HISTORY;
+            double beta = ws->rho[row] * penalty_dot(&ws->y[row * n], ws->direction, n);
+            for (int i = 0; i < n; i++) {
+                ws->direction[i] += (ws->alpha[row] - beta) * ws->s[row * n + i];
+            }
+        }
+        for (int i = 0; i < n; i++) {
+            ws->direction[i] = -ws->direction[i];
+        }
+        double slope = penalty_dot(ws->gradient, ws->direction, n);
+        if (slope >= 0) {
+            // not a descent direction: start over from the gradient
+            for (int i = 0; i < n; i++) {
+                ws->direction[i] = -ws->gradient[i] * scale;
+            }
+            slope = penalty_dot(ws->gradient, ws->direction, n);
+            stored = 0;
+        }
+
+        // backtracking until the Armijo condition holds
+        double step = 1, f_next = f;
+        bool found = false;
+        for (int halving = 0; halving < PENALTY_LINE_SEARCH && !found; halving++, step /= 2) {
+            for (int i = 0; i < n; i++) {
+                ws->v_next[i] = ws->v[i] + step * ws->direction[i];
+            }
+            f_next = penalty_value(columns, problem->constraint_count, N, frozen, ws->v_next, ws->gradient_next);
+            found = f_next <= f + 1e-4 * step * slope;
+        }
+        if (!found) {
+            break;
+        }
+
+        // the pair is kept if the curvature along the step is positive
+        double sy = 0;
+        for (int i = 0; i < n; i++) {
+            sy += (ws->v_next[i] - ws->v[i]) * (ws->gradient_next[i] - ws->gradient[i]);
+        }
+        if (sy > 1e-12) {
+            int row = (newest + 1) % PENALTY_HISTORY;
+            for (int i = 0; i < n; i++) {
+                ws->s[row * n + i] = ws->v_next[i] - ws->v[i];
+                ws->y[row * n + i] = ws->gradient_next[i] - ws->gradient[i];
+            }
+            ws->rho[row] = 1 / sy;
+            newest = row;
+            stored = stored < PENALTY_HISTORY ? stored + 1 : PENALTY_HISTORY;
+        }
+        memcpy(ws->v, ws->v_next, n * sizeof(double));
+        memcpy(ws->gradient, ws->gradient_next, n * sizeof(double));
+        f = f_next;
+    }
+
+    for (int p = 0; p < N; p++) {
+        points[p].x = ws->v[p];
+        points[p].y = ws->v[N + p];
+    }
+    return f;
+}
+
+#endif // PENALTY_H
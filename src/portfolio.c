@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "utils.c"
+#include "solver.c"
+
+#ifndef PORTFOLIO_H
+#define PORTFOLIO_H
+
+// A portfolio of search configurations for the threads of one run: thread t uses entry
+// t % count, so that different settings race on the same instance and share the elite pool.
+// Entry 0 is always the configuration given on the command line.
+//
+// Portfolio files have one configuration per line, as space-separated key=value pairs; keys left
+// out keep their command-line value, and lines starting with # are comments:
+//   sub_iterations=20 final_radius=30 min_radius=0.01
+//   reset_its=100000 reset_multiplier=1.25
+//   engine=hybrid candidates=4
+//   restart=crossover restart_schedule=luby
+typedef struct {
+    solver_config_t* configs;
+    int count;
+} portfolio_t;
+
+// Sets one key of a configuration. Returns false for an unknown key, engine, restart strategy or schedule.
+static bool portfolio_set(solver_config_t* config, const char* key, const char* text) {
+    double value = atof(text);
+    if (strcmp(key, "sub_iterations") == 0) {
+        config->sub_iterations = value;
+    } else if (strcmp(key, "reset_its") == 0) {
+        config->reset_its = value;
+    } else if (strcmp(key, "reset_multiplier") == 0) {
+        config->reset_multiplier = value;
+    } else if (strcmp(key, "final_radius") == 0) {
+        config->final_radius = value;
+    } else if (strcmp(key, "min_radius") == 0) {
+        config->min_radius = value;
+    } else if (strcmp(key, "candidates") == 0) {
+        config->num_candidates = value >= 1 ? value : 1;
+    } else if (strcmp(key, "relocate") == 0) {
+        config->relocate = value < 0 ? 0 : value > 1 ? 1 : value;
+    } else if (strcmp(key, "weight_bump_its") == 0) {
+        config->weight_bump_its = value > 0 ? value : 0;
+    } else if (strcmp(key, "engine") == 0) {
+        config->engine = engine_parse(text);
+        return config->engine >= 0;
+    } else if (strcmp(key, "restart") == 0) {
+        config->restart = restart_parse(text);
+        return config->restart >= 0;
+    } else if (strcmp(key, "restart_schedule") == 0) {
+        config->restart_schedule = schedule_parse(text);
+        return config->restart_schedule >= 0;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static void portfolio_add(portfolio_t* portfolio, const solver_config_t* config) {
+    portfolio->configs = realloc(portfolio->configs, (portfolio->count + 1) * sizeof(solver_config_t));
+    portfolio->configs[portfolio->count] = *config;
+    portfolio->configs[portfolio->count].portfolio_entry = portfolio->count;
+    portfolio->count++;
+}
+
+// Built-in portfolio around `base`: shorter and longer moves, tighter local search, rare and
+// growing resets, multi-candidate moves, and crossover restarts.
+void portfolio_default(const solver_config_t* base, portfolio_t* portfolio) {
+    static const char* entries[] = {
+        "",
+        "sub_iterations=5 final_radius=8",
+        "sub_iterations=20 final_radius=40 min_radius=0.01",
+        "final_radius=4 min_radius=0.01 reset_its=10000",
+        "reset_its=100000 reset_multiplier=1.25",
+        "candidates=8",
+        "sub_iterations=15 final_radius=60 reset_its=20000",
+        "sub_iterations=12 final_radius=2 min_radius=0.001 reset_its=50000 reset_multiplier=1.25",
+        "restart=crossover",
+    };
+    portfolio->configs = NULL;
+    portfolio->count = 0;
+    for (size_t e = 0; e < sizeof(entries) / sizeof(entries[0]); e++) {
+        solver_config_t config = *base;
+        char line[MAX_LINE_LENGTH];
+        strcpy(line, entries[e]);
+        for (char* token = strtok(line, " "); token != NULL; token = strtok(NULL, " ")) {
+            char* equals = strchr(token, '=');
+            *equals = '\0';
+            portfolio_set(&config, token, equals + 1);
+        }
+        portfolio_add(portfolio, &config);
+    }
+}
+
+// Reads a portfolio file, prepending the configuration `base`.
+void parse_portfolio(const char* portfolio_file, const solver_config_t* base, portfolio_t* portfolio) {
+    FILE* file = fopen(portfolio_file, "r");
+    if (file == NULL) {
+        printf("Error opening portfolio file\n");
+        exit(1);
+    }
+    portfolio->configs = NULL;
+    portfolio->count = 0;
+    portfolio_add(portfolio, base);
+
+    char line[MAX_LINE_LENGTH];
+    int line_number = 0;
+    while (fgets(line, sizeof(line), file)) {
+        line_number++;
+        line[strcspn(line, "#\r\n")] = '\0';
+        solver_config_t config = *base;
+        int keys = 0;
+        for (char* token = strtok(line, " \t"); token != NULL; token = strtok(NULL, " \t")) {
+            char* equals = strchr(token, '=');
+            if (equals != NULL) {
+                *equals = '\0';
+            }
+            if (equals == NULL || !portfolio_set(&config, token, equals + 1)) {
+                printf("ERROR: Invalid entry '%s' in line %d of the portfolio file\n", token, line_number);
+                exit(1);
+            }
+            keys++;
+        }
+        if (keys > 0) {
+            portfolio_add(portfolio, &config);
+        }
+    }
+    fclose(file);
+}
+
+void portfolio_free(portfolio_t* portfolio) {
+    free(portfolio->configs);
+    portfolio->configs = NULL;
+    portfolio->count = 0;
+}
+
+#endif // PORTFOLIO_H
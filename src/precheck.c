@@ -0,0 +1,386 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "utils.c"
+
+#ifndef PRECHECK_H
+#define PRECHECK_H
+
+// Combinatorial pre-check of an instance: the signs must satisfy the axioms of an acyclic rank 3
+// chirotope for any point set to realize them, so a violation proves the instance infeasible before
+// the search starts. Checked:
+// - alternation: a triple given twice, in any order, has consistent signs, and a triple with a
+//   repeated point has sign 0
+// - 4-point subsets a, b, c, d: det(bcd) - det(acd) + det(abd) - det(abc) = 0 for points of the
+//   plane, so the signs of these four terms cannot all agree
+// - 5-point subsets: the 3-term Grassmann-Pluecker relations, for x and a, b, c, d the terms
+//   χ(xab)χ(xcd), -χ(xac)χ(xbd), χ(xad)χ(xbc) take both signs, or are all 0
+// Subsets with a triple missing from the instance are skipped. For complete instances without zero
+// signs, the relations through x are checked together in O(N^2): they hold iff the directions from x
+// to the other points can be ordered by angle, once they are all turned into the half-plane left of
+// one of them, i.e. iff the tournament "b is counterclockwise from a" is transitive.
+
+#define PRECHECK_OFF 0
+#define PRECHECK_ON 1                       // enumerations over PRECHECK_MAX_SUBSETS subsets are skipped
+#define PRECHECK_FULL 2
+#define PRECHECK_MAX_SUBSETS 100000000LL
+#define PRECHECK_MAX_TRIPLES (1LL << 30)    // of the sign table, 2 bits each
+
+#define PRECHECK_ABSENT 3                   // code of a triple missing from the instance
+#define PRECHECK_MISSING 2                  // precheck_chi() of such a triple
+
+typedef struct {
+    bool infeasible;
+    const char* axiom;      // that is violated, if infeasible
+    int points[5];          // 1-based, ascending: the offending points
+    int point_count;
+    bool checked_four;      // every 4-point subset was checked
+    bool checked_five;      // every 5-point relation was checked
+    double seconds;
+} precheck_result_t;
+
+enum { PRECHECK_PASS_FOUR, PRECHECK_PASS_FIVE, PRECHECK_PASS_CONTRACTIONS };
+
+typedef struct {
+    const Problem* problem;
+    int N;
+    uint8_t* table;         // sign + 1 of the triple of colex rank r, or PRECHECK_ABSENT, 4 per byte
+    int pass;
+    atomic_int next;        // next point to take, as the first one of the subsets or as x
+    atomic_bool found;
+    pthread_mutex_t lock;
+    precheck_result_t* result;
+} precheck_t;
+
+static inline int precheck_code(const uint8_t* table, int64_t rank) {
+    return (table[rank >> 2] >> (2 * (rank & 3))) & 3;
+}
+
+// Sign of the triple of distinct 0-based points (a, b, c), in that order, or PRECHECK_MISSING.
+static inline int precheck_chi(const uint8_t* table, int a, int b, int c) {
+    int parity = 1, t;
+    if (a > b) { t = a; a = b; b = t; parity = -parity; }
+    if (b > c) { t = b; b = c; c = t; parity = -parity; }
+    if (a > b) { t = a; a = b; b = t; parity = -parity; }
+    int code = precheck_code(table, colex_rank(a, b, c));
+    return code == PRECHECK_ABSENT ? PRECHECK_MISSING : parity * (code - 1);
+}
+
+// Whether terms summing to zero have consistent signs: both signs, or none.
+static inline bool precheck_balanced(const int* terms, int count) {
+    bool positive = false, negative = false;
+    for (int t = 0; t < count; t++) {
+        positive |= terms[t] > 0;
+        negative |= terms[t] < 0;
+    }
+    return positive == negative;
+}
+
+// Records a violation among the 0-based `points`, unless another thread was first.
+static void precheck_report(precheck_t* check, const char* axiom, const int* points, int count) {
+    pthread_mutex_lock(&check->lock);
+    precheck_result_t* result = check->result;
+    if (!result->infeasible) {
+        result->infeasible = true;
+        result->axiom = axiom;
+        result->point_count = 0;
+        for (int p = 0; p < count; p++) {
+            bool seen = false;
+            for (int q = 0; q < result->point_count; q++) {
+                seen |= result->points[q] == points[p] + 1;
+            }
+            if (!seen) {
+                result->points[result->point_count++] = points[p] + 1;
+            }
+        }
+        for (int p = 1; p < result->point_count; p++) {
+            for (int q = p; q > 0 && result->points[q-1] > result->points[q]; q--) {
+                int t = result->points[q];
+                result->points[q] = result->points[q-1];
+                result->points[q-1] = t;
+            }
+        }
+    }
+    atomic_store(&check->found, true);
+    pthread_mutex_unlock(&check->lock);
+}
+
+// Fills the sign table, checking alternation on the way. Returns whether it holds.
+static bool precheck_alternation(precheck_t* check) {
+    const Problem* problem = check->problem;
+    for (int c = 0; c < problem->constraint_count; c++) {
+        const Constraint* constraint = &problem->constraints[c];
+        int p[3] = { constraint->i - 1, constraint->j - 1, constraint->k - 1 };
+        if (p[0] == p[1] || p[1] == p[2] || p[0] == p[2]) {
+            if (constraint->sign != 0) {
+                precheck_report(check, "alternation", p, 3);
+                return false;
+            }
+            continue;
+        }
+        int parity = 1;
+        for (int a = 0; a < 2; a++) {
+            for (int b = 0; b < 2 - a; b++) {
+                if (p[b] > p[b+1]) {
+                    int t = p[b];
+                    p[b] = p[b+1];
+                    p[b+1] = t;
+                    parity = -parity;
+                }
+            }
+        }
+        int64_t rank = colex_rank(p[0], p[1], p[2]);
+        int code = parity * constraint->sign + 1;
+        int previous = precheck_code(check->table, rank);
+        if (previous != PRECHECK_ABSENT && previous != code) {
+            precheck_report(check, "alternation", p, 3);
+            return false;
+        }
+        check->table[rank >> 2] = (check->table[rank >> 2] & ~(3 << (2 * (rank & 3)))) | (code << (2 * (rank & 3)));
+    }
+    return true;
+}
+
+// The 4-point subsets whose first point is a. The points are in order, so their signs are read by rank.
+static void precheck_four(precheck_t* check, int a) {
+    const uint8_t* table = check->table;
+    int N = check->N;
+    for (int b = a + 1; b < N && !atomic_load_explicit(&check->found, memory_order_relaxed); b++) {
+        for (int c = b + 1; c < N; c++) {
+            int abc = precheck_code(table, colex_rank(a, b, c));
+            if (abc == PRECHECK_ABSENT) {
+                continue;
+            }
+            int64_t pairs_bc = (int64_t)c * (c - 1) / 2 + b, pairs_ac = (int64_t)c * (c - 1) / 2 + a;
+            int64_t pairs_ab = (int64_t)b * (b - 1) / 2 + a;
+            for (int d = c + 1; d < N; d++) {
+                int64_t below = triples_below(d);
+                int bcd = precheck_code(table, below + pairs_bc), acd = precheck_code(table, below + pairs_ac);
+                int abd = precheck_code(table, below + pairs_ab);
+                if (bcd == PRECHECK_ABSENT || acd == PRECHECK_ABSENT || abd == PRECHECK_ABSENT) {
+                    continue;
+                }
+                int terms[4] = { bcd - 1, 1 - acd, abd - 1, 1 - abc };
+                if (!precheck_balanced(terms, 4)) {
+                    int points[4] = { a, b, c, d };
+                    precheck_report(check, "4-point (acyclicity)", points, 4);
+                    return;
+                }
+            }
+        }
+    }
+}
+
+// Whether the Grassmann-Pluecker relation of x and a < b < c < d holds, or misses a triple.
+static bool precheck_relation(const uint8_t* table, int x, int a, int b, int c, int d) {
+    int chi[6] = { precheck_chi(table, x, a, b), precheck_chi(table, x, c, d), precheck_chi(table, x, a, c),
+        precheck_chi(table, x, b, d), precheck_chi(table, x, a, d), precheck_chi(table, x, b, c) };
+    for (int t = 0; t < 6; t++) {
+        if (chi[t] == PRECHECK_MISSING) {
+            return true;
+        }
+    }
+    int terms[3] = { chi[0] * chi[1], -chi[2] * chi[3], chi[4] * chi[5] };
+    return precheck_balanced(terms, 3);
+}
+
+// Whether the relations of the 5 ascending points hold, reporting them otherwise.
+static bool precheck_five_points(precheck_t* check, const int* p) {
+    for (int m = 0; m < 5; m++) {
+        int q[4], n = 0;
+        for (int o = 0; o < 5; o++) {
+            if (o != m) {
+                q[n++] = p[o];
+            }
+        }
+        if (!precheck_relation(check->table, p[m], q[0], q[1], q[2], q[3])) {
+            precheck_report(check, "5-point (Grassmann-Pluecker)", p, 5);
+            return false;
+        }
+    }
+    return true;
+}
+
+// The 5-point subsets whose first point is a.
+static void precheck_five(precheck_t* check, int a) {
+    int N = check->N;
+    for (int b = a + 1; b < N && !atomic_load_explicit(&check->found, memory_order_relaxed); b++) {
+        for (int c = b + 1; c < N; c++) {
+            for (int d = c + 1; d < N; d++) {
+                for (int e = d + 1; e < N; e++) {
+                    int p[5] = { a, b, c, d, e };
+                    if (!precheck_five_points(check, p)) {
+                        return;
+                    }
+                }
+            }
+        }
+    }
+}
+
+// All the relations through x, for a complete instance without zero signs. Point r, the first other
+// than x, is the reference: every other point a is turned by ε(a) = χ(x, r, a) into the half-plane
+// left of r, and a beats b if b is then counterclockwise from a. The tournament is transitive iff the
+// scores are 0 ... n-1; otherwise some a beats b with score(a) <= score(b), so b beats some c that
+// a doesn't beat, and x, r, a, b, c break a relation.
+static void precheck_contraction(precheck_t* check, int x, int8_t* turn, int* scores, int* seen) {
+    const uint8_t* table = check->table;
+    int N = check->N;
+    int r = x == 0 ? 1 : 0;
+    for (int a = 0; a < N; a++) {
+        turn[a] = a == x ? 0 : a == r ? 1 : precheck_chi(table, x, r, a);
+        scores[a] = 0;
+        seen[a] = 0;
+    }
+    for (int a = 0; a < N; a++) {
+        for (int b = a + 1; b < N; b++) {
+            if (a != x && b != x) {
+                scores[turn[a] * turn[b] * precheck_chi(table, x, a, b) > 0 ? a : b]++;
+            }
+        }
+    }
+    int tied = -1;
+    for (int a = 0; a < N && tied < 0; a++) {
+        if (a != x && seen[scores[a]]++ > 0) {
+            tied = a;
+        }
+    }
+    for (int a = 0; a < N && tied >= 0; a++) {
+        if (a == x || a == tied || scores[a] != scores[tied]) {
+            continue;
+        }
+        int winner = turn[a] * turn[tied] * precheck_chi(table, x, a, tied) > 0 ? a : tied;
+        int loser = winner == a ? tied : a;
+        for (int c = 0; c < N; c++) {
+            if (c != x && c != winner && c != loser
+                && turn[loser] * turn[c] * precheck_chi(table, x, loser, c) > 0
+                && turn[winner] * turn[c] * precheck_chi(table, x, winner, c) < 0) {
+                int points[5] = { x, r, winner, loser, c };
+                precheck_report(check, "5-point (Grassmann-Pluecker)", points, 5);
+                return;
+            }
+        }
+    }
+}
+
+static void* precheck_worker(void* arg) {
+    precheck_t* check = arg;
+    int8_t* turn = malloc(check->N);
+    int* scores = malloc(check->N * sizeof(int));
+    int* seen = malloc(check->N * sizeof(int));
+    int a;
+    while (!atomic_load(&check->found) && (a = atomic_fetch_add(&check->next, 1)) < check->N) {
+        switch (check->pass) {
+            case PRECHECK_PASS_FOUR:
+                precheck_four(check, a);
+                break;
+            case PRECHECK_PASS_FIVE:
+                precheck_five(check, a);
+                break;
+            default:
+                precheck_contraction(check, a, turn, scores, seen);
+                break;
+        }
+    }
+    free(turn);
+    free(scores);
+    free(seen);
+    return NULL;
+}
+
+static void precheck_run_pass(precheck_t* check, int pass, int num_threads) {
+    check->pass = pass;
+    atomic_store(&check->next, 0);
+    pthread_t* threads = malloc(num_threads * sizeof(pthread_t));
+    for (int t = 0; t < num_threads; t++) {
+        if (pthread_create(&threads[t], NULL, precheck_worker, check) != 0) {
+            perror("Failed to create thread");
+            exit(1);
+        }
+    }
+    for (int t = 0; t < num_threads; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    free(threads);
+}
+
+static int64_t precheck_binomial(int64_t n, int k) {
+    int64_t value = 1;
+    for (int i = 0; i < k; i++) {
+        value = value * (n - i) / (i + 1);
+    }
+    return value;
+}
+
+// With `contractions` false, the 5-point subsets are enumerated even where the contractions would do.
+static bool precheck_problem(const Problem* problem, int num_threads, bool full, bool contractions, precheck_result_t* result) {
+    struct timespec start = get_time();
+    int N = problem->N;
+    memset(result, 0, sizeof(*result));
+    if (N < 3 || triples_below(N) > PRECHECK_MAX_TRIPLES) {
+        result->seconds = elapsed_time_sec(start, get_time());
+        return true;
+    }
+    precheck_t check;
+    check.problem = problem;
+    check.N = N;
+    check.table = malloc((triples_below(N) + 3) / 4);
+    memset(check.table, 0xFF, (triples_below(N) + 3) / 4);
+    atomic_init(&check.next, 0);
+    atomic_init(&check.found, false);
+    pthread_mutex_init(&check.lock, NULL);
+    check.result = result;
+    num_threads = num_threads > 0 ? num_threads : 1;
+
+    bool uniform = contractions && problem->complete;
+    for (int c = 0; c < problem->constraint_count && uniform; c++) {
+        uniform = problem->constraints[c].sign != 0;
+    }
+    if (precheck_alternation(&check)) {
+        int64_t four = precheck_binomial(N, 4);
+        int64_t five = uniform ? N * precheck_binomial(N - 1, 2) : precheck_binomial(N, 5);
+        result->checked_four = full || four <= PRECHECK_MAX_SUBSETS;
+        result->checked_five = full || five <= PRECHECK_MAX_SUBSETS;
+        if (result->checked_four) {
+            precheck_run_pass(&check, PRECHECK_PASS_FOUR, num_threads);
+        }
+        if (result->checked_five && !result->infeasible) {
+            precheck_run_pass(&check, uniform ? PRECHECK_PASS_CONTRACTIONS : PRECHECK_PASS_FIVE, num_threads);
+        }
+    }
+
+    pthread_mutex_destroy(&check.lock);
+    free(check.table);
+    result->seconds = elapsed_time_sec(start, get_time());
+    return !result->infeasible;
+}
+
+// Checks the axioms on `problem` with `num_threads` threads. With `full`, the subsets are enumerated
+// however many there are. Returns false if the instance is infeasible.
+bool precheck_run(const Problem* problem, int num_threads, bool full, precheck_result_t* result) {
+    return precheck_problem(problem, num_threads, full, true, result);
+}
+
+// One line on the outcome, as printed before a run.
+void precheck_print(const precheck_result_t* result) {
+    if (result->infeasible) {
+        color_printf(RED, "INFEASIBLE");
+        printf(": the %s axiom is violated by points", result->axiom);
+        for (int p = 0; p < result->point_count; p++) {
+            printf(" %d", result->points[p]);
+        }
+        printf(" (%.1f ms)\n", result->seconds * 1000);
+        return;
+    }
+    color_printf(YELLOW, "Chirotope axioms");
+    printf(": alternation%s%s conditions hold (%.1f ms)", result->checked_four ? (result->checked_five ? ", 4-point" : " and 4-point") : "",
+        result->checked_five ? " and 5-point" : "", result->seconds * 1000);
+    printf("%s\n\n", result->checked_four && result->checked_five ? "" : "; larger subsets skipped, see --precheck full");
+}
+
+#endif // PRECHECK_H
@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <stdbool.h>
+#include "utils.c"
+
+#ifndef PREDICATES_H
+#define PREDICATES_H
+
+// Exact orientation sign, after J. R. Shewchuk, "Adaptive Precision Floating-Point Arithmetic and
+// Fast Robust Geometric Predicates" (1997).
+// The determinant is first computed in doubles together with an upper bound on its rounding error;
+// only when its magnitude is below that bound (nearly collinear points) is the sign recomputed
+// exactly, by summing the exact products with floating-point expansions.
+
+// (3 + 16 eps) eps with eps = 2^-53: error bound of the filtered determinant, relative to
+// |l| + |r| where det = l - r (Shewchuk's ccwerrboundA)
+#define ORIENT_ERRBOUND ((3.0 + 16.0 * 0x1p-53) * 0x1p-53)
+
+// 2^27 + 1, splits a double into two non-overlapping 26-bit halves
+#define SPLITTER 134217729.0
+
+// a + b = x + y exactly, with x = fl(a + b)
+static inline void two_sum(double a, double b, double* x, double* y) {
+    *x = a + b;
+    double bv = *x - a;
+    double av = *x - bv;
+    *y = (a - av) + (b - bv);
+}
+
+static inline void split(double a, double* hi, double* lo) {
+    double c = SPLITTER * a;
+    double big = c - a;
+    *hi = c - big;
+    *lo = a - *hi;
+}
+
+// a * b = x + y exactly, with x = fl(a * b)
+static inline void two_product(double a, double b, double* x, double* y) {
+    *x = a * b;
+    double ahi, alo, bhi, blo;
+    split(a, &ahi, &alo);
+    split(b, &bhi, &blo);
+    double err1 = *x - ahi * bhi;
+    double err2 = err1 - alo * bhi;
+    double err3 = err2 - ahi * blo;
+    *y = alo * blo - err3;
+}
+
+// Adds b to the expansion e (m components, increasing magnitude, non-overlapping) into h,
+// dropping zero components. Returns the length of h, at most m + 1. h may alias e.
+static int grow_expansion(int m, const double* e, double b, double* h) {
+    double q = b;
+    int n = 0;
+    for (int t = 0; t < m; t++) {
+        double sum, err;
+        two_sum(q, e[t], &sum, &err);
+        q = sum;
+        if (err != 0.0) {
+            h[n++] = err;
+        }
+    }
+    if (q != 0.0 || n == 0) {
+        h[n++] = q;
+    }
+    return n;
+}
+
+// Sign of det(pa, pb, pc) = ax*by - ax*cy - ay*bx + ay*cx + bx*cy - by*cx, computed exactly.
+int orient2d_exact_sign(Point pa, Point pb, Point pc) {
+    double terms[6][2] = {
+        { pa.x, pb.y }, { -pa.x, pc.y }, { -pa.y, pb.x },
+        { pa.y, pc.x }, { pb.x, pc.y }, { -pb.y, pc.x },
+    };
+    double expansion[13];
+    int length = 0;
+    for (int t = 0; t < 6; t++) {
+        double x, y;
+        two_product(terms[t][0], terms[t][1], &x, &y);
+        length = grow_expansion(length, expansion, y, expansion);
+        length = grow_expansion(length, expansion, x, expansion);
+    }
+    // the most significant component carries the sign of the sum
+    double top = expansion[length - 1];
+    return (top > 0) - (top < 0);
+}
+
+// Sign of det(pa, pb, pc), with the same expression as det(), exact for all inputs.
+int orient2d_sign(Point pa, Point pb, Point pc) {
+    double l = (pc.y - pa.y) * (pb.x - pa.x);
+    double r = (pc.x - pa.x) * (pb.y - pa.y);
+    double determinant = l - r;
+    if (fabs(determinant) > ORIENT_ERRBOUND * (fabs(l) + fabs(r))) {
+        return (determinant > 0) - (determinant < 0);
+    }
+    return orient2d_exact_sign(pa, pb, pc);
+}
+
+#endif // PREDICATES_H
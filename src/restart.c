@@ -0,0 +1,257 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+
+#include "utils.c"
+#include "violations.c"
+#include "threading.c"
+
+#ifndef RESTART_H
+#define RESTART_H
+
+// Restarts of the local search. When a thread goes reset_its iterations without a new low, it takes
+// a solution of the elite pool and moves on from a perturbation of it. The strategy decides the
+// perturbation, and the schedule how many iterations the next attempt gets.
+#define RESTART_ELITE 0             // the elite solution, or the best of RANDOM_MOVE_TESTS jittered copies of it
+#define RESTART_PARTIAL 1           // the elite solution with only its most violated points moved
+#define RESTART_CROSSOVER 2         // a region of the elite solution taken from another one, aligned onto it
+
+#define SCHEDULE_FIXED 0            // reset_its, grown per thread by the reset multiplier
+#define SCHEDULE_GEOMETRIC 1        // reset_its * multiplier^k, k counting the restarts of all the threads
+#define SCHEDULE_LUBY 2             // reset_its * luby(k), k counting the restarts of all the threads
+
+#define RESTART_PARTIAL_FRACTION 0.25   // of the points with a violation, the most violated ones are moved
+#define RESTART_PARTIAL_RADIUS 10.0     // radius of their moves, at the scale of the initial 10 x 10 box
+#define RESTART_CANDIDATES 8            // positions scored incrementally per moved point
+#define RESTART_CROSSOVER_CUTS 8        // cuts tried per crossover
+
+static const char* const restart_names[] = { "elite", "partial", "crossover" };
+static const char* const schedule_names[] = { "fixed", "geometric", "luby" };
+
+// The restart strategy called `name`, or -1.
+int restart_parse(const char* name) {
+    for (int r = 0; r < (int)(sizeof(restart_names) / sizeof(restart_names[0])); r++) {
+        if (strcmp(name, restart_names[r]) == 0) {
+            return r;
+        }
+    }
+    return -1;
+}
+
+// The restart schedule called `name`, or -1.
+int schedule_parse(const char* name) {
+    for (int s = 0; s < (int)(sizeof(schedule_names) / sizeof(schedule_names[0])); s++) {
+        if (strcmp(name, schedule_names[s]) == 0) {
+            return s;
+        }
+    }
+    return -1;
+}
+
+// The i-th term (from 1) of the Luby sequence 1 1 2 1 1 2 4 1 1 2 1 1 2 4 8 ...
+long long luby(long long i) {
+    for (;;) {
+        int k = 1;
+        while ((1LL << k) - 1 < i) {
+            k++;
+        }
+        if (i == (1LL << k) - 1) {
+            return 1LL << (k - 1);
+        }
+        i -= (1LL << (k - 1)) - 1;
+    }
+}
+
+// Iterations until the restart after the one numbered `index` (from 0) over all the threads,
+// `current` being the interval that ended. Never below 2, as a shrinking multiplier leaves it.
+long long restart_interval(int schedule, long long reset_its, double multiplier, long long current, long long index) {
+    switch (schedule) {
+        case SCHEDULE_GEOMETRIC:
+            return fmax(2, fmin(1e15, reset_its * pow(multiplier != 1.0 ? multiplier : 1.25, index + 1)));
+        case SCHEDULE_LUBY:
+            return reset_its * luby(index + 1) > 2 ? reset_its * luby(index + 1) : 2;
+        default:
+            return multiplier != 1.0 ? fmax(2, current * multiplier) : current;
+    }
+}
+
+typedef struct {
+    int violations;
+    int point;
+} restart_rank_t;
+
+// Scratch buffers of the restart strategies.
+typedef struct {
+    restart_rank_t* ranks;  // N
+    Point* other;           // N: the second parent of a crossover
+    Point* child;           // N
+} restart_workspace_t;
+
+size_t restart_workspace_bytes(int N) {
+    return arena_round(N * sizeof(restart_rank_t)) + 2 * arena_round(N * sizeof(Point));
+}
+
+void restart_workspace_init(restart_workspace_t* ws, int N, arena_t* arena) {
+    ws->ranks = arena_alloc(arena, N * sizeof(restart_rank_t));
+    ws->other = arena_alloc(arena, N * sizeof(Point));
+    ws->child = arena_alloc(arena, N * sizeof(Point));
+}
+
+static int compare_ranks(const void* a, const void* b) {
+    const restart_rank_t* ra = a;
+    const restart_rank_t* rb = b;
+    if (ra->violations != rb->violations) {
+        return rb->violations - ra->violations;
+    }
+    return ra->point - rb->point;
+}
+
+// Moves the most violated points of `points`, each to the best of RESTART_CANDIDATES random
+// positions around it. The candidates are scored incrementally, against the state `vs` of the
+// current points, which is kept up to date. Returns the constraints scored.
+long long restart_partial(restart_workspace_t* ws, violation_state_t* vs, const Problem* problem, Point* points,
+    const bool* frozen, int* changed, rng_t* rng) {
+    int N = problem->N;
+    int count = 0;
+    for (int p = 0; p < N; p++) {
+        if (!frozen[p] && vs->violations_per_point[p] > 0) {
+            ws->ranks[count++] = (restart_rank_t){ vs->violations_per_point[p], p };
+        }
+    }
+    qsort(ws->ranks, count, sizeof(restart_rank_t), compare_ranks);
+    int moved = count > 0 ? (int)ceil(count * RESTART_PARTIAL_FRACTION) : 0;
+
+    long long scored = 0;
+    for (int r = 0; r < moved; r++) {
+        int p = ws->ranks[r].point;
+        int changed_count;
+        Point best = points[p];
+        long long best_delta = LLONG_MAX;
+        for (int c = 0; c < RESTART_CANDIDATES; c++) {
+            Point candidate = random_point_in_ball(points[p], RESTART_PARTIAL_RADIUS, rng);
+            long long delta = vstate_score_move(vs, problem, points, p, candidate, changed, &changed_count);
+            if (delta < best_delta) {
+                best_delta = delta;
+                best = candidate;
+            }
+        }
+        // the point moves even if it gets worse: this is a perturbation, not a descent
+        vstate_score_move(vs, problem, points, p, best, changed, &changed_count);
+        points[p] = best;
+        vstate_apply(vs, problem, changed, changed_count);
+        scored += (RESTART_CANDIDATES + 1LL) * problem_degree(problem, p);
+    }
+    return scored;
+}
+
+// Least-squares affine map taking `from` onto `to`, as to ≈ A from + t. Returns false if it is
+// degenerate or reverses orientations: only a map with a positive determinant keeps every
+// orientation, so that the mapped points still solve what `from` solved.
+static bool restart_align(const Point* from, const Point* to, int N, double a[2][2], double t[2]) {
+    double fx = 0, fy = 0, tx = 0, ty = 0;
+    for (int p = 0; p < N; p++) {
+        fx += from[p].x; fy += from[p].y;
+        tx += to[p].x; ty += to[p].y;
+    }
+    fx /= N; fy /= N; tx /= N; ty /= N;
+    // A = (sum to' from'^T) (sum from' from'^T)^-1 over the centered points
+    double sxx = 0, sxy = 0, syy = 0, cxx = 0, cxy = 0, cyx = 0, cyy = 0;
+    for (int p = 0; p < N; p++) {
+        double ux = from[p].x - fx, uy = from[p].y - fy;
+        double vx = to[p].x - tx, vy = to[p].y - ty;
+        sxx += ux * ux; sxy += ux * uy; syy += uy * uy;
+        cxx += vx * ux; cxy += vx * uy; cyx += vy * ux; cyy += vy * uy;
+    }
+    double det = sxx * syy - sxy * sxy;
+    if (det <= 1e-12 * (sxx + syy) * (sxx + syy)) {
+        return false;
+    }
+    a[0][0] = (cxx * syy - cxy * sxy) / det;
+    a[0][1] = (cxy * sxx - cxx * sxy) / det;
+    a[1][0] = (cyx * syy - cyy * sxy) / det;
+    a[1][1] = (cyy * sxx - cyx * sxy) / det;
+    if (a[0][0] * a[1][1] - a[0][1] * a[1][0] <= 0) {
+        return false;
+    }
+    t[0] = tx - a[0][0] * fx - a[0][1] * fy;
+    t[1] = ty - a[1][0] * fx - a[1][1] * fy;
+    return true;
+}
+
+// The child of a crossover: `points`, with the points on the positive side of the line through
+// points[through] with normal (nx, ny) taken from `other`.
+static void restart_cut(const Point* points, const Point* other, int N, const bool* frozen,
+    int through, double nx, double ny, Point* child) {
+    for (int p = 0; p < N; p++) {
+        double side = (points[p].x - points[through].x) * nx + (points[p].y - points[through].y) * ny;
+        child[p] = !frozen[p] && side > 0 ? other[p] : points[p];
+    }
+}
+
+// Crossover of `points` with `other`, another solution of the pool: `other` is mapped onto `points`
+// by restart_align, and the points on one side of a random line through a random point take their
+// mapped positions. The best of RESTART_CROSSOVER_CUTS cuts replaces `points`. Returns its
+// violations, or -1 (leaving `points` alone) if the two solutions do not align.
+int restart_crossover(restart_workspace_t* ws, violation_state_t* vs, const Problem* problem, Point* points,
+    const Point* other, const bool* frozen, rng_t* rng) {
+    int N = problem->N;
+    double a[2][2], t[2];
+    if (!restart_align(other, points, N, a, t)) {
+        return -1;
+    }
+    for (int p = 0; p < N; p++) {
+        ws->other[p] = (Point){ a[0][0] * other[p].x + a[0][1] * other[p].y + t[0],
+            a[1][0] * other[p].x + a[1][1] * other[p].y + t[1] };
+    }
+
+    int best_violations = INT32_MAX, best_through = 0;
+    double best_nx = 0, best_ny = 0;
+    for (int cut = 0; cut < RESTART_CROSSOVER_CUTS; cut++) {
+        int through = rng_double(rng) * N;
+        through = through < N ? through : N - 1;
+        double angle = 2 * M_PI * rng_double(rng);
+        double nx = cos(angle), ny = sin(angle);
+        restart_cut(points, ws->other, N, frozen, through, nx, ny, ws->child);
+        int violations = vstate_count_violations(vs, problem, ws->child);
+        if (violations < best_violations) {
+            best_violations = violations;
+            best_through = through;
+            best_nx = nx;
+            best_ny = ny;
+        }
+    }
+    restart_cut(points, ws->other, N, frozen, best_through, best_nx, best_ny, ws->child);
+    memcpy(points, ws->child, N * sizeof(Point));
+    return best_violations;
+}
+
+// One restart attempt of a thread: from a restart to the next one, or to the end of the search.
+typedef struct {
+    int strategy;           // -1 before the first restart
+    long long number;       // of the restart over all the threads
+    long long iteration;    // of the thread, at the restart
+    double time;            // seconds into the solve() call, at the restart
+    long long interval;     // iterations without a new low it was given
+    int violations;         // right after the restart
+} restart_attempt_t;
+
+// Buffers the outcome of an attempt for the restart log, if any, as one JSON line: `lowest` is the
+// lowest violations it reached, and `end` what ended it ("restart", "solved" or "stopped").
+// The line is written later, by sync_flush_restart_log.
+void restart_log_attempt(synchronization_t* sync, int thread_id, const restart_attempt_t* attempt,
+    long long it, double time, int lowest, const char* end) {
+    if (sync->restart_log == NULL || attempt->strategy < 0) {
+        return;
+    }
+    char line[512];
+    int length = snprintf(line, sizeof(line), "{\"thread\": %d, \"restart\": %lld, \"strategy\": \"%s\", \"interval\": %lld, "
+        "\"start\": %.3f, \"seconds\": %.3f, \"iterations\": %lld, \"violations\": %d, \"lowest\": %d, \"end\": \"%s\"}\n",
+        thread_id, attempt->number, restart_names[attempt->strategy], attempt->interval, attempt->time,
+        time - attempt->time, it - attempt->iteration, attempt->violations, lowest, end);
+    sync_append_restart_log(sync, line, length < (int)sizeof(line) ? (size_t)length : sizeof(line) - 1);
+}
+
+#endif // RESTART_H
@@ -1,17 +1,62 @@
+#include <stdint.h>
+
 #ifndef RNG_H
 #define RNG_H
 
+// xoshiro256** (Blackman and Vigna): 256 bits of state and 64-bit outputs, for a few cycles per draw.
+// Each thread owns its generator, and the state fills a cache line of its own, so that the
+// generators of different threads never share one.
 typedef struct {
-    unsigned long long int state;
+    _Alignas(64) uint64_t s[4];
 } rng_t;
 
-float rng_float(rng_t* rng) {
-    rng->state = (rng->state * 1103515245 + 12345) & 0x7fffffff;
-    return (float)rng->state / 0x7fffffff;
+static inline uint64_t rng_rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t rng_next(rng_t* rng) {
+    uint64_t* s = rng->s;
+    uint64_t result = rng_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rng_rotl(s[3], 45);
+    return result;
 }
 
+// Uniform in [0, 1), with the full 53 bits of a double.
+static inline double rng_double(rng_t* rng) {
+    return (rng_next(rng) >> 11) * 0x1.0p-53;
+}
+
+// The state is filled by splitmix64 from the seed, so that consecutive seeds (one per thread) give
+// unrelated streams, and no seed gives the all-zero state.
 void rng_init(rng_t* rng, unsigned long long int seed) {
-    rng->state = seed;
+    uint64_t z = seed;
+    for (int i = 0; i < 4; i++) {
+        z += 0x9e3779b97f4a7c15ULL;
+        uint64_t x = z;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        rng->s[i] = x ^ (x >> 31);
+    }
+}
+
+// K offsets uniform in the disk of radius r, into dx and dy. Pairs uniform in the square [-1, 1)^2
+// are drawn until they fall in the unit disk, which π/4 of them do: no sqrt, cos or sin.
+void rng_disk_offsets(rng_t* rng, double r, double* dx, double* dy, int K) {
+    for (int q = 0; q < K; ) {
+        double u = 2 * rng_double(rng) - 1;
+        double v = 2 * rng_double(rng) - 1;
+        if (u * u + v * v < 1) {
+            dx[q] = r * u;
+            dy[q] = r * v;
+            q++;
+        }
+    }
 }
 
-#endif
\ No newline at end of file
+#endif
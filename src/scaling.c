@@ -0,0 +1,310 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+#include <pthread.h>
+
+#include "utils.c"
+#include "solver.c"
+#include "generator.c"
+#include "threading.c"
+#include "rng.c"
+
+#ifndef SCALING_H
+#define SCALING_H
+
+// `localizer scale`: a scaling study run in-process. For every N of a sweep and every thread count,
+// the solver runs on generated instances (one per seed) until it solves them or the time limit
+// passes, and the time-to-solution percentiles and move rates are reported per N.
+
+#define SCALING_MAX_VALUES 64
+
+typedef struct {
+    int thread_id;
+    const Problem* problem;
+    const solver_config_t* config;
+    synchronization_t* sync;
+    const bool* is_point_fixed;
+    const Point* fixed_points;
+    const Symmetry* symmetry;
+    Point* points;
+    rng_t rng;
+    arena_t arena;
+    search_stats_t stats;
+    solve_result_t result;
+} scaling_thread_t;
+
+// One cell of the study: an N and a thread count, over all seeds.
+typedef struct {
+    int N;
+    int threads;
+    int runs;
+    int solved;
+    double* times;      // per run, INFINITY if unsolved
+    double moves_per_s; // mean over the runs
+} scaling_cell_t;
+
+static void* scaling_thread(void* arg) {
+    scaling_thread_t* thread = arg;
+    thread->result = solve(thread->problem, thread->config, thread->points, "/dev/null", thread->thread_id,
+        thread->sync, &thread->rng, &thread->arena, thread->is_point_fixed, thread->fixed_points,
+        thread->symmetry, NULL, &thread->stats, NULL);
+    return NULL;
+}
+
+// Parses a comma-separated list of positive integers into values. Returns their number, or 0.
+static int parse_int_list(const char* list, int* values) {
+    int count = 0;
+    const char* s = list;
+    while (*s != '\0' && count < SCALING_MAX_VALUES) {
+        char* end;
+        long value = strtol(s, &end, 10);
+        if (end == s || value <= 0 || (*end != ',' && *end != '\0')) {
+            return 0;
+        }
+        values[count++] = value;
+        s = *end == ',' ? end + 1 : end;
+    }
+    return count;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted values; INFINITY if it falls on an unsolved run.
+static double percentile(const double* sorted, int count, double q) {
+    int rank = (int)ceil(q * count) - 1;
+    return sorted[rank < 0 ? 0 : rank];
+}
+
+// Solves the instance with `num_threads` threads sharing an elite pool, like the main command.
+static void scaling_run(const Problem* problem, const solver_config_t* config, int num_threads, int seed,
+    double* time_to_solution, double* moves_per_s) {
+    int N = problem->N;
+    synchronization_t sync;
+    sync_init(&sync, N);
+    bool* is_point_fixed = calloc(N, sizeof(bool));
+    Point* fixed_points = calloc(N, sizeof(Point));
+    Symmetry symmetry = { NULL, NULL, 0 };
+    scaling_thread_t* threads = aligned_alloc(_Alignof(scaling_thread_t), num_threads * sizeof(scaling_thread_t));
+    pthread_t* handles = malloc(num_threads * sizeof(pthread_t));
+
+    struct timespec start = get_time();
+    for (int t = 0; t < num_threads; t++) {
+        scaling_thread_t* thread = &threads[t];
+        thread->thread_id = t + 1;
+        stats_init(&thread->stats);
+        thread->problem = problem;
+        thread->config = config;
+        thread->sync = &sync;
+        thread->is_point_fixed = is_point_fixed;
+        thread->fixed_points = fixed_points;
+        thread->symmetry = &symmetry;
+        thread->points = calloc(N, sizeof(Point));
+        rng_init(&thread->rng, seed + t);
+        arena_init(&thread->arena, solver_workspace_bytes(problem, config, NULL));
+        if (pthread_create(&handles[t], NULL, scaling_thread, thread) != 0) {
+            perror("Failed to create thread");
+            exit(1);
+        }
+    }
+    long long moves = 0;
+    *time_to_solution = INFINITY;
+    for (int t = 0; t < num_threads; t++) {
+        pthread_join(handles[t], NULL);
+        // the exact count of moves with the search counters, an upper bound without
+        moves += SEARCH_STATS ? stat_load(&threads[t].stats.sub_iterations) : threads[t].result.iterations * config->sub_iterations;
+        if (threads[t].result.solved) {
+            *time_to_solution = threads[t].result.seconds;
+        }
+        free(threads[t].points);
+        arena_free(&threads[t].arena);
+    }
+    *moves_per_s = moves / elapsed_time_sec(start, get_time());
+
+    free(handles);
+    free(threads);
+    free(fixed_points);
+    free(is_point_fixed);
+    sync_destroy(&sync);
+}
+
+static void print_time(double seconds) {
+    if (isinf(seconds)) {
+        color_printf(RED, "%9s", "-");
+    } else {
+        printf("%9.3f", seconds);
+    }
+}
+
+static void json_print_time(FILE* file, const char* key, double seconds) {
+    if (isinf(seconds)) {
+        fprintf(file, "\"%s\": null", key);
+    } else {
+        fprintf(file, "\"%s\": %.4f", key, seconds);
+    }
+}
+
+static void scaling_write_summary(const char* path, const scaling_cell_t* cells, int count,
+    const char* distribution, double time_limit) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        printf("Error opening file %s\n", path);
+        exit(1);
+    }
+    fprintf(file, "{\n  \"distribution\": \"%s\",\n  \"time_limit\": %g,\n  \"kernel\": \"%s\",\n  \"results\": [\n",
+        distribution, time_limit, eval_kernel.name);
+    for (int c = 0; c < count; c++) {
+        const scaling_cell_t* cell = &cells[c];
+        fprintf(file, "    {\"N\": %d, \"threads\": %d, \"runs\": %d, \"solved\": %d, ",
+            cell->N, cell->threads, cell->runs, cell->solved);
+        json_print_time(file, "p50", percentile(cell->times, cell->runs, 0.5));
+        fprintf(file, ", ");
+        json_print_time(file, "p90", percentile(cell->times, cell->runs, 0.9));
+        fprintf(file, ", ");
+        json_print_time(file, "max", percentile(cell->times, cell->runs, 1.0));
+        fprintf(file, ", \"moves_per_s\": %.0f, \"times\": [", cell->moves_per_s);
+        for (int r = 0; r < cell->runs; r++) {
+            if (isinf(cell->times[r])) {
+                fprintf(file, "null");
+            } else {
+                fprintf(file, "%.4f", cell->times[r]);
+            }
+            fprintf(file, "%s", r + 1 < cell->runs ? ", " : "");
+        }
+        fprintf(file, "]}%s\n", c + 1 < count ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+}
+
+static void print_scaling_usage() {
+    color_printf(RED, "Usage: scale [-N sizes, e.g. 10,20,50] [-n seeds] [-t thread counts, e.g. 1,4] [-T seconds per run]\n"
+        " [-g uniform|clustered|convex|degenerate] [-s seed] [-o summary.json] [-i sub_iterations] [-r reset_interval] [-k candidates]\n");
+}
+
+// `localizer scale [options]`, with argv[0] the subcommand.
+int run_scaling_study(int argc, char** argv) {
+    int sizes[SCALING_MAX_VALUES] = { 10, 20, 50, 100, 200 };
+    int size_count = 5;
+    int thread_counts[SCALING_MAX_VALUES] = { 1 };
+    int thread_count = 1;
+    int seeds = 5;
+    int seed = 42;
+    int distribution = POINTS_UNIFORM;
+    const char* summary = "scaling_summary.json";
+    solver_config_t config = solver_config_default();
+    config.time_limit = 10;
+    config.quiet = true;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "N:n:t:T:g:s:o:i:r:k:")) != -1) {
+        switch (opt) {
+            case 'N':
+                size_count = parse_int_list(optarg, sizes);
+                break;
+            case 't':
+                thread_count = parse_int_list(optarg, thread_counts);
+                break;
+            case 'n':
+                seeds = atoi(optarg);
+                break;
+            case 'T':
+                config.time_limit = atof(optarg);
+                break;
+            case 'g':
+                distribution = parse_distribution(optarg);
+                break;
+            case 's':
+                seed = atoi(optarg);
+                break;
+            case 'o':
+                summary = optarg;
+                break;
+            case 'i':
+                config.sub_iterations = atoi(optarg);
+                break;
+            case 'r':
+                config.reset_its = atoi(optarg);
+                break;
+            case 'k':
+                config.num_candidates = atoi(optarg) > 0 ? atoi(optarg) : 1;
+                break;
+            default:
+                print_scaling_usage();
+                return 1;
+        }
+    }
+    if (size_count == 0 || thread_count == 0 || seeds < 1 || config.time_limit <= 0 || distribution < 0) {
+        print_scaling_usage();
+        return 1;
+    }
+    for (int s = 0; s < size_count; s++) {
+        if (sizes[s] < 3) {
+            print_scaling_usage();
+            return 1;
+        }
+    }
+
+    // the evaluation kernel is calibrated once, on the largest instance
+    int largest = 0;
+    for (int s = 1; s < size_count; s++) {
+        largest = sizes[s] > sizes[largest] ? s : largest;
+    }
+    Problem problem;
+    generate_problem(&problem, sizes[largest], distribution, seed);
+    rng_t calibration_rng;
+    rng_init(&calibration_rng, seed);
+    eval_kernel_init(&problem, &calibration_rng);
+    problem_free(&problem);
+
+    color_printf(YELLOW, "Scaling study");
+    printf(": %d sizes x %d thread counts x %d seeds, %s points, %.1f s per run, %s kernel\n\n",
+        size_count, thread_count, seeds, distribution_names[distribution], config.time_limit, eval_kernel.name);
+    color_printf(CYAN, "%6s %8s %8s %9s %9s %9s %12s\n", "N", "threads", "solved", "p50 [s]", "p90 [s]", "max [s]", "Mmoves/s");
+
+    int cell_count = size_count * thread_count;
+    scaling_cell_t* cells = calloc(cell_count, sizeof(scaling_cell_t));
+    for (int s = 0; s < size_count; s++) {
+        for (int t = 0; t < thread_count; t++) {
+            scaling_cell_t* cell = &cells[s * thread_count + t];
+            cell->N = sizes[s];
+            cell->threads = thread_counts[t];
+            cell->runs = seeds;
+            cell->times = malloc(seeds * sizeof(double));
+            for (int r = 0; r < seeds; r++) {
+                // the same instances for every thread count
+                generate_problem(&problem, cell->N, distribution, seed + r);
+                double moves_per_s;
+                scaling_run(&problem, &config, cell->threads, seed + r, &cell->times[r], &moves_per_s);
+                problem_free(&problem);
+                cell->solved += !isinf(cell->times[r]);
+                cell->moves_per_s += moves_per_s / seeds;
+            }
+            qsort(cell->times, seeds, sizeof(double), compare_doubles);
+
+            printf("%6d %8d %5d/%-2d ", cell->N, cell->threads, cell->solved, cell->runs);
+            print_time(percentile(cell->times, seeds, 0.5));
+            printf(" ");
+            print_time(percentile(cell->times, seeds, 0.9));
+            printf(" ");
+            print_time(percentile(cell->times, seeds, 1.0));
+            printf(" %12.3f\n", cell->moves_per_s / 1e6);
+            fflush(stdout);
+        }
+    }
+
+    scaling_write_summary(summary, cells, cell_count, distribution_names[distribution], config.time_limit);
+    color_printf(YELLOW, "\nSummary saved to %s\n", summary);
+    for (int c = 0; c < cell_count; c++) {
+        free(cells[c].times);
+    }
+    free(cells);
+    return 0;
+}
+
+#endif // SCALING_H
@@ -6,13 +6,170 @@
 #include "utils.c"
 
 #include "evaluation.c"
+#include "violations.c"
+#include "moves.c"
+#include "orbits.c"
 #include "threading.c"
+#include "stats.c"
+#include "penalty.c"
+#include "restart.c"
+
+#ifndef SOLVER_H
+#define SOLVER_H
 
 #define RESET_MULTIPLIER 1.25
 #define MIN_RADIUS 0.1
+#define FINAL_RADIUS 15.0
 #define TEST_PERTURBATION 0.2
+#define RANDOM_MOVE_TESTS 100 // perturbations tried by test_random_moves
+#define WEIGHT_BUMP_ITS 200 // iterations without an improving move before the search weights are bumped
+#define WEIGHT_DECAY_PERIOD 10 // bumps of the search weights between two decays
+
+// Search hyperparameters of a solve() call
+typedef struct {
+    int sub_iterations;
+    double min_dist;            // negative -> turned off
+    long long int reset_its;
+    double reset_multiplier;    // the reset interval grows by this factor after each reset
+    double final_radius;        // radius of the first sub-iteration's ball, halved at each one
+    double min_radius;          // down to this
+    int num_candidates;         // candidate positions scored per single-point move
+    double relocate;            // fraction of single-point moves that are exact relocations along a line
+    int engine;                 // ENGINE_LOCAL, ENGINE_HYBRID or ENGINE_PENALTY (local search only under a symmetry)
+    int weight_bump_its;        // iterations without an improving move before the violated constraints' search
+                                // weights are bumped, 0 for no adaptive weighting
+    int restart;                // RESTART_ELITE, RESTART_PARTIAL or RESTART_CROSSOVER (elite only under a symmetry)
+    int restart_schedule;       // SCHEDULE_FIXED, SCHEDULE_GEOMETRIC or SCHEDULE_LUBY
+    double time_limit;          // seconds per solve() call, <= 0 for none
+    long long max_iterations;   // iterations per solve() call (a resumed search counts from its checkpoint), <= 0 for none
+    bool quiet;                 // no progress or solution printing (the solution is still saved)
+    int portfolio_entry;        // index of the configuration in a portfolio, -1 outside one
+} solver_config_t;
+
+solver_config_t solver_config_default() {
+    return (solver_config_t){
+        .sub_iterations = 10,
+        .min_dist = -1.0,
+        .reset_its = 30000,
+        .reset_multiplier = 1.0,
+        .final_radius = FINAL_RADIUS,
+        .min_radius = MIN_RADIUS,
+        .num_candidates = 1,
+        .relocate = 0.0,
+        .engine = ENGINE_LOCAL,
+        .weight_bump_its = WEIGHT_BUMP_ITS,
+        .restart = RESTART_ELITE,
+        .restart_schedule = SCHEDULE_FIXED,
+        .time_limit = 0.0,
+        .max_iterations = 0,
+        .quiet = false,
+        .portfolio_entry = -1,
+    };
+}
+
+// One-line description of the search hyperparameters, as accepted in a portfolio file.
+void solver_config_describe(const solver_config_t* config, char* buffer, size_t size) {
+    snprintf(buffer, size, "sub_iterations=%d reset_its=%lld reset_multiplier=%g final_radius=%g min_radius=%g candidates=%d relocate=%g engine=%s weight_bump_its=%d restart=%s restart_schedule=%s",
+        config->sub_iterations, config->reset_its, config->reset_multiplier, config->final_radius,
+        config->min_radius, config->num_candidates, config->relocate, engine_names[config->engine], config->weight_bump_its,
+        restart_names[config->restart], schedule_names[config->restart_schedule]);
+}
+
+// Outcome of one solve() call
+typedef struct {
+    bool solved;            // this call found, verified and saved the solution
+    long long iterations;
+    double seconds;
+} solve_result_t;
+
+// Per-thread state and scratch buffers, carved out of the thread's arena.
+typedef struct {
+    violation_state_t vs;
+    move_engine_t moves;
+    int* changed;   // constraints flipped by the last scored move, up to the max (orbit) degree
+    Point* saved;   // previous positions of the members of a moved orbit
+    bool* frozen;   // points never drawn for a move: fixed points, or every member of an orbit with one
+    Point* test_pts;
+    Point* best_tests;
+    penalty_workspace_t penalty; // only with the penalty engine
+    restart_workspace_t restart;
+} solver_workspace_t;
+
+// The problem the search actually evaluates: the weighted representatives under a symmetry,
+// or the problem itself.
+static inline const Problem* solver_problem(const Problem* problem, const orbit_index_t* orbits) {
+    return orbits ? &orbits->reps : problem;
+}
+
+static int solver_max_changed(const Problem* problem, const orbit_index_t* orbits) {
+    int max_degree = problem_max_degree(solver_problem(problem, orbits));
+    return orbits && orbits->max_orbit_degree > max_degree ? orbits->max_orbit_degree : max_degree;
+}
+
+size_t solver_workspace_bytes(const Problem* problem, const solver_config_t* config, const orbit_index_t* orbits) {
+    int N = problem->N;
+    const Problem* work = solver_problem(problem, orbits);
+    return vstate_bytes(N, work->constraint_count)
+        + (config->weight_bump_its > 0 ? vstate_weighting_bytes(work->constraint_count) : 0)
+        + move_engine_bytes(problem_max_degree(work), config->num_candidates)
+        + arena_round(solver_max_changed(problem, orbits) * sizeof(int))
+        + arena_round((orbits ? orbits->max_orbit_size : 1) * sizeof(Point))
+        + arena_round(N * sizeof(bool))
+        + 2 * arena_round(N * sizeof(Point))
+        + restart_workspace_bytes(N)
+        + (config->engine != ENGINE_LOCAL ? penalty_workspace_bytes(N) : 0);
+}
 
-// Right now this is a full reset, but it should be something smarter soon.
+// Whether an orbit has a fixed member, in which case it never moves.
+static bool orbit_is_fixed(const orbit_index_t* orbits, int orbit, const bool* is_point_fixed) {
+    const int* members = orbit_point_members(orbits, orbit);
+    for (int j = 0; j < orbit_size(orbits, orbit); j++) {
+        if (is_point_fixed[members[j]]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void solver_workspace_init(solver_workspace_t* ws, const Problem* problem, const solver_config_t* config, const orbit_index_t* orbits,
+    const bool* is_point_fixed, arena_t* arena) {
+    int N = problem->N;
+    const Problem* work = solver_problem(problem, orbits);
+    ws->frozen = arena_alloc(arena, N * sizeof(bool));
+    for (int p = 0; p < N; p++) {
+        ws->frozen[p] = orbits ? orbit_is_fixed(orbits, orbits->orbit_of[p], is_point_fixed) : is_point_fixed[p];
+    }
+    vstate_init(&ws->vs, N, work->constraint_count, orbits ? orbits->rep_weight : NULL, ws->frozen, arena);
+    if (config->weight_bump_its > 0) {
+        vstate_enable_weighting(&ws->vs, arena);
+    }
+    move_engine_init(&ws->moves, problem_max_degree(work), config->num_candidates, arena);
+    ws->changed = arena_alloc(arena, solver_max_changed(problem, orbits) * sizeof(int));
+    ws->saved = arena_alloc(arena, (orbits ? orbits->max_orbit_size : 1) * sizeof(Point));
+    ws->test_pts = arena_alloc(arena, N * sizeof(Point));
+    ws->best_tests = arena_alloc(arena, N * sizeof(Point));
+    restart_workspace_init(&ws->restart, N, arena);
+    if (config->engine != ENGINE_LOCAL) {
+        penalty_workspace_init(&ws->penalty, N, arena);
+    }
+}
+
+// Full re-evaluation of the current points into the incremental state.
+// The minimum distance requirement is only checked here, as an extra violation.
+int full_evaluation(violation_state_t* vs, const Problem* problem, const Point* points, double MIN_DIST, double* min_distance) {
+    vstate_rebuild(vs, problem, points);
+    int total_violations = vs->violated_weight;
+    if (MIN_DIST > 0) {
+        int m1, m2;
+        min_dist(points, problem->N, min_distance, &m1, &m2);
+        if (*min_distance < MIN_DIST) {
+            total_violations++;
+        }
+    }
+    return total_violations;
+}
+
+// Takes a solution of the elite pool, which the restart strategy then perturbs.
 void reset(Point* points, int N, synchronization_t* sync, rng_t* rng, const bool* is_point_fixed, const Point* fixed_points, const Symmetry* symmetry) {
     // color_printf(RED, "\n================================  RESET ================================\n\n");
     int new_violations = 0;
@@ -28,17 +185,15 @@ void reset(Point* points, int N, synchronization_t* sync, rng_t* rng, const bool
     enforce_symmetry(symmetry, points);
 }
 
-void test_random_moves(int N, Point* points, const Constraint* constraints, int constraint_count, const int** constraints_per_point, rng_t* rng, 
+void test_random_moves(const Problem* problem, Point* points, solver_workspace_t* ws, rng_t* rng, 
     int* total_violations, const bool* is_point_fixed, const Symmetry* symmetry) {
-    int violations_per_point_relative[N];
+    int N = problem->N;
     int min_test_violations = INT32_MAX;
-    Point best_tests[N];
+    Point* best_tests = ws->best_tests;
+    Point* test_pts = ws->test_pts;
     
-    double min_distance = DBL_MAX;
-    for(int i = 0; i < 100; ++i) {
-        Point test_pts[N];
+    for(int i = 0; i < RANDOM_MOVE_TESTS; ++i) {
         memcpy(test_pts, points, N * sizeof(Point));
-        int violations_curr = 0;
         for(int j = 0; j < N; ++j) {
             if(!is_point_fixed[j])  {
                 test_pts[j] = random_point_in_ball(points[j], TEST_PERTURBATION, rng);
@@ -47,9 +202,7 @@ void test_random_moves(int N, Point* points, const Constraint* constraints, int
         
         enforce_symmetry(symmetry, test_pts);
         
-        int point_with_max_violations;
-        evaluate(test_pts, N, constraints, constraint_count, constraints_per_point, 0.0,
-            &violations_curr, violations_per_point_relative, &point_with_max_violations, &min_distance, -1, -1);
+        int violations_curr = vstate_count_violations(&ws->vs, problem, test_pts);
             
         if(violations_curr < min_test_violations) {
             min_test_violations = violations_curr;
@@ -58,45 +211,183 @@ void test_random_moves(int N, Point* points, const Constraint* constraints, int
         
     
     }
-    if(min_test_violations < *total_violations || rng_float(rng) < 0.3) {
+    if(min_test_violations < *total_violations || rng_double(rng) < 0.3) {
         memcpy(points, best_tests, N * sizeof(Point));
     }
         
 }
 
-void print_stats(int thread_id, double time_elapsed, long long int it, int total_violations, double min_distance, int point_with_max_violations, int* violations_per_point, synchronization_t* sync) {
+// Perturbs `points`, just taken from the pool by reset(), as the restart `strategy` does, with the
+// incremental state up to date for them. Returns the strategy applied: a crossover needs a second
+// solution of the pool, different from the first one; without it, the points are perturbed as by a
+// partial restart.
+int restart_perturb(int strategy, solver_workspace_t* ws, const Problem* work, Point* points, int* total_violations,
+    synchronization_t* sync, rng_t* rng, const bool* is_point_fixed, const Symmetry* symmetry,
+    search_stats_t* stats, phase_clock_t* clock) {
+    int N = work->N;
+    if (strategy == RESTART_CROSSOVER) {
+        STATS_PHASE(stats, clock, PHASE_SYNC);
+        int other = sync_get_random_solution(sync, ws->test_pts, rng);
+        STATS_ADD(stats, fetches, 1);
+        STATS_PHASE(stats, clock, PHASE_RESET);
+        if (other == INT32_MAX || memcmp(ws->test_pts, points, N * sizeof(Point)) == 0 ||
+            restart_crossover(&ws->restart, &ws->vs, work, points, ws->test_pts, ws->frozen, rng) < 0) {
+            strategy = RESTART_PARTIAL;
+        } else {
+            STATS_ADD(stats, evaluated_constraints, (long long)RESTART_CROSSOVER_CUTS * work->constraint_count);
+        }
+    }
+    STATS_PHASE(stats, clock, PHASE_RESET);
+    if (strategy == RESTART_ELITE) {
+        test_random_moves(work, points, ws, rng, total_violations, is_point_fixed, symmetry);
+        STATS_ADD(stats, random_move_tests, 1);
+        STATS_ADD(stats, evaluated_constraints, (long long)RANDOM_MOVE_TESTS * work->constraint_count);
+    } else if (strategy == RESTART_PARTIAL) {
+        long long evaluated = restart_partial(&ws->restart, &ws->vs, work, points, ws->frozen, ws->changed, rng);
+        STATS_ADD(stats, evaluated_constraints, evaluated);
+    }
+    return strategy;
+}
+
+// Runs the penalty engine from the current points. The result is kept if it violates no more
+// constraints than they did, and they are restored otherwise. Returns the violations.
+static int penalty_polish(solver_workspace_t* ws, const Problem* problem, Point* points, int total_violations,
+    double MIN_DIST, double* min_distance) {
+    int N = problem->N;
+    memcpy(ws->best_tests, points, N * sizeof(Point));
+    penalty_minimize(&ws->penalty, problem, ws->frozen, points, PENALTY_ITERATIONS);
+    int violations = full_evaluation(&ws->vs, problem, points, MIN_DIST, min_distance);
+    if (violations <= total_violations) {
+        return violations;
+    }
+    memcpy(points, ws->best_tests, N * sizeof(Point));
+    return full_evaluation(&ws->vs, problem, points, MIN_DIST, min_distance);
+}
+
+// Runs of the penalty engine for as long as they lower the violations. Returns the violations.
+static int penalty_descend(solver_workspace_t* ws, const Problem* problem, Point* points, int total_violations,
+    double MIN_DIST, double* min_distance, search_stats_t* stats) {
+    for (int previous = INT32_MAX; total_violations > 0 && total_violations < previous; ) {
+        previous = total_violations;
+        total_violations = penalty_polish(ws, problem, points, total_violations, MIN_DIST, min_distance);
+        STATS_ADD(stats, penalty_runs, 1);
+        STATS_ADD(stats, evaluated_constraints, problem->constraint_count);
+    }
+    return total_violations;
+}
+
+// Kick of the penalty engine when a run did not improve: the points of violated constraints are
+// moved at random within `radius`.
+static void penalty_kick(const violation_state_t* vs, Point* points, int N, const bool* frozen, double radius, rng_t* rng) {
+    for (int p = 0; p < N; p++) {
+        if (!frozen[p] && vs->violations_per_point[p] > 0) {
+            points[p] = random_point_in_ball(points[p], radius, rng);
+        }
+    }
+}
+
+// `weighted` is the score with adaptive weighting, or -1 without.
+void print_stats(int thread_id, double time_elapsed, long long int it, int total_violations, long long weighted, double min_distance, int point_with_max_violations, int* violations_per_point, synchronization_t* sync) {
     pthread_mutex_lock(&sync->print_mutex);
     color_printf(YELLOW, "[Thread %d] ", thread_id);
     printf("[t ");
     color_printf(CYAN, "%.2f", time_elapsed);
     printf(" s]\t[kilo itr %lld]\t", it / 1000);
     printf("[unsat"); color_printf(RED, " %d", total_violations);
+    if (weighted >= 0) {
+        printf("]\t[weighted %lld", weighted);
+    }
     printf("]\t[min dist %.3f]\t[max unsat point ", min_distance);
     color_printf(YELLOW, "%d", point_with_max_violations + 1);
     printf(" ; %d]\n", violations_per_point[point_with_max_violations]);
     pthread_mutex_unlock(&sync->print_mutex);
 }
 
-void solve(int N,
-    const Constraint* constraints,
-    int constraint_count,
-    const int** constraints_per_point,
-    const int* constraints_per_point_count,
-    int sub_iterations,
-    double MIN_DIST,
+// Final check of a solution found by the search. The points are rounded to the coordinates they are
+// saved with, and checked against every constraint (under a symmetry only the representatives were
+// evaluated): with the predicate rule, and with exact signs, which is what a validator checks.
+static bool solution_verified(violation_state_t* vs, const Problem* problem, Point* points) {
+    round_to_serialized(problem->N, points);
+    points_to_soa(points, problem->N, vs->x, vs->y);
+    if (eval_kernel.fn(&problem->columns, problem->constraint_count, vs->x, vs->y, NULL) > 0) {
+        return false;
+    }
+    for (int c = 0; c < problem->constraint_count; c++) {
+        const Constraint* constraint = &problem->constraints[c];
+        if (constraint->sign != 0 &&
+            constraint->sign * orient2d_sign(points[constraint->i - 1], points[constraint->j - 1], points[constraint->k - 1]) <= 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Runs the search until a solution is found, another thread sharing `sync` stops it, or the time
+// or iteration budget of the configuration runs out. Counters and phase times are added to `stats`, if not NULL. If `state` is not NULL,
+// the search state is published to it every 1000 iterations for checkpoints, and a state restored
+// from a checkpoint is resumed instead of starting from a random assignment.
+solve_result_t solve(const Problem* problem,
+    const solver_config_t* config,
     Point* points,
     const char* output_file,
-    long long int reset_its,
     int thread_id,
     synchronization_t* sync,
     rng_t* rng,
+    arena_t* arena,
     const bool* is_point_fixed,
     const Point* fixed_points,
-    const Symmetry* symmetry)
+    const Symmetry* symmetry,
+    const orbit_index_t* orbits,
+    search_stats_t* stats,
+    thread_state_t* state)
 {
+    int N = problem->N;
+    int sub_iterations = config->sub_iterations;
+    double MIN_DIST = config->min_dist;
+    long long int reset_its = config->reset_its;
+    solver_workspace_t ws;
+    search_stats_t local_stats;
+    if (stats == NULL) {
+        stats_init(&local_stats);
+        stats = &local_stats;
+    }
+    phase_clock_t clock;
+    STATS_CLOCK_START(&clock, PHASE_OTHER);
+    arena_reset(arena);
+    solver_workspace_init(&ws, problem, config, orbits, is_point_fixed, arena);
+    violation_state_t* vs = &ws.vs;
+    // under a symmetry, the search runs on the weighted representatives of the constraints
+    const Problem* work = solver_problem(problem, orbits);
+    // the penalty engine works on the whole problem, so under a symmetry only the local search runs.
+    // Alone, it checks for a stop after every run, which is one iteration.
+    int engine = orbits == NULL ? config->engine : ENGINE_LOCAL;
+    int stop_check = engine == ENGINE_PENALTY ? 1 : 1000;
+    int clock_check = engine == ENGINE_PENALTY ? 1 : 100;
+    bool kick = false; // the last run of the penalty engine did not improve
+    // partial and crossover restarts move single points, which would break the orbits of a symmetry
+    int restart = orbits == NULL ? config->restart : RESTART_ELITE;
+    restart_attempt_t attempt = { .strategy = -1 };
     
-    // each thread starts from a random assignment
-    generate_random_assignment(N, points, rng);
+    long long int it = 0;
+    long long its_since_checkpoint = 0;
+    long long its_since_improving_move = 0; // with adaptive weighting, counts towards the next bump
+    long long bumps = 0;
+    bool stopped = false; // by another thread, or by the budget, rather than by a solution
+    if (state != NULL && state->resume) {
+        memcpy(points, state->points, N * sizeof(Point));
+        *rng = state->rng;
+        it = state->iterations;
+        its_since_checkpoint = state->its_since_checkpoint;
+        reset_its = state->reset_its;
+        // the adaptive weights go on too, when the checkpoint has them for the same constraints
+        if (vs->search_weight != NULL && state->weight_count == vs->constraint_count) {
+            memcpy(vs->search_weight, state->search_weight, state->weight_count * sizeof(uint16_t));
+        }
+        state->resume = false;
+    } else {
+        // each thread starts from a random assignment
+        generate_random_assignment(N, points, rng);
+    }
     
     // Apply fixed points if any
     for (int i = 0; i < N; i++) {
@@ -108,140 +399,242 @@ void solve(int N,
     enforce_symmetry(symmetry, points);
     
     struct timespec start_time = get_time();
-    long long int it = 0;
 
-    int total_violations = INT32_MAX; // initialize to "infinity"
-    int violations_per_point[N], point_with_max_violations;
     double min_distance = 1.0;
 
     // evaluate the random assignment over all the constraints
-    evaluate(points, N, constraints, constraint_count, constraints_per_point, MIN_DIST,
-        &total_violations, violations_per_point, &point_with_max_violations, &min_distance, -1, -1);
+    STATS_PHASE(stats, &clock, PHASE_FULL_EVAL);
+    int total_violations = full_evaluation(vs, work, points, MIN_DIST, &min_distance);
+    STATS_ADD(stats, evaluated_constraints, work->constraint_count);
+    // the hybrid engine starts the local search where the penalty engine stops improving
+    if (engine == ENGINE_HYBRID && it == 0) {
+        STATS_PHASE(stats, &clock, PHASE_PENALTY);
+        total_violations = penalty_descend(&ws, work, points, total_violations, MIN_DIST, &min_distance, stats);
+    }
+    // with adaptive weighting, moves may trade violations for lower weights: only a new low of the
+    // violations since the last reset is progress
+    int lowest = total_violations;
+    // the loop itself is charged to local evaluation, so that a plain iteration reads no clock
+    STATS_PHASE(stats, &clock, PHASE_LOCAL_EVAL);
 
-    long long its_since_checkpoint = 0;
-    
     // points will be sampled from a ball with exponentially increasing radius
-    double final_radius = 15.0;
+    double final_radius = config->final_radius;
     
-    Point test_pts[N];
-    int violations_per_point_relative[N];
-    int violations_chosen = 0;
-    int max_violation_relative = 0;
-    double min_dist_relative;
-    
-    while (total_violations > 0) {
+    while (true) {
+        if (total_violations == 0) {
+            STATS_PHASE(stats, &clock, PHASE_FULL_EVAL);
+            STATS_ADD(stats, evaluated_constraints, problem->constraint_count);
+            if (solution_verified(vs, problem, points)) {
+                break;
+            }
+            // rounding broke a constraint: go on from the rounded points, or from a reset if
+            // only exact signs tell that a constraint is violated
+            total_violations = full_evaluation(vs, work, points, MIN_DIST, &min_distance);
+            STATS_ADD(stats, evaluated_constraints, work->constraint_count);
+            if (total_violations == 0) {
+                its_since_checkpoint = reset_its + 1;
+            }
+            STATS_PHASE(stats, &clock, PHASE_LOCAL_EVAL);
+        }
        
-        if (its_since_checkpoint > reset_its) {
+        if (its_since_checkpoint > (engine == ENGINE_PENALTY ? PENALTY_RESET_RUNS : reset_its)) {
+            STATS_PHASE(stats, &clock, PHASE_OTHER);
+            double time_elapsed = elapsed_time_sec(start_time, get_time());
+            restart_log_attempt(sync, thread_id, &attempt, it, time_elapsed, lowest, "restart");
+            STATS_PHASE(stats, &clock, PHASE_SYNC);
             reset(points, N, sync, rng, is_point_fixed, fixed_points, symmetry);
+            STATS_ADD(stats, resets, 1);
+            STATS_ADD(stats, fetches, 1);
 
             its_since_checkpoint = 0;
+            long long number = atomic_fetch_add_explicit(&sync->restarts, 1, memory_order_relaxed);
+            reset_its = restart_interval(config->restart_schedule, config->reset_its, config->reset_multiplier, reset_its, number);
             
-            evaluate(points, N, constraints, constraint_count, constraints_per_point, MIN_DIST,
-                &total_violations, violations_per_point, &point_with_max_violations, &min_distance, -1, -1);
-                
-            test_random_moves(N, points, constraints, constraint_count, constraints_per_point, rng, &total_violations, is_point_fixed, symmetry);
+            STATS_PHASE(stats, &clock, PHASE_FULL_EVAL);
+            total_violations = full_evaluation(vs, work, points, MIN_DIST, &min_distance);
+            STATS_ADD(stats, evaluated_constraints, work->constraint_count);
+
+            int strategy = restart_perturb(restart, &ws, work, points, &total_violations, sync, rng, is_point_fixed, symmetry,
+                stats, &clock);
             
-            evaluate(points, N, constraints, constraint_count, constraints_per_point, MIN_DIST,
-                &total_violations, violations_per_point, &point_with_max_violations, &min_distance, -1, -1);
+            STATS_PHASE(stats, &clock, PHASE_FULL_EVAL);
+            total_violations = full_evaluation(vs, work, points, MIN_DIST, &min_distance);
+            STATS_ADD(stats, evaluated_constraints, work->constraint_count);
+            kick = false;
+            if (engine == ENGINE_HYBRID) {
+                STATS_PHASE(stats, &clock, PHASE_PENALTY);
+                total_violations = penalty_descend(&ws, work, points, total_violations, MIN_DIST, &min_distance, stats);
+            }
+            lowest = total_violations;
+            attempt = (restart_attempt_t){ strategy, number, it, time_elapsed, reset_its, total_violations };
+            STATS_PHASE(stats, &clock, PHASE_LOCAL_EVAL);
         }
 
         if (total_violations == 0) {
-            break;
+            continue;
         }
 
         // every X iterations we check if a different thread has finished, in which case this call terminates
-        if(it % 1000 == 0) {
+        if(it % stop_check == 0) {
             if(sync_should_stop(sync)) {
-                return;
+                stopped = true;
+                break;
+            }
+            if (state != NULL) {
+                thread_state_publish(state, N, points, rng, it, its_since_checkpoint, reset_its, total_violations,
+                    vs->search_weight, vs->constraint_count);
             }
         }
+        if (config->max_iterations > 0 && it >= config->max_iterations) {
+            stopped = true;
+            break;
+        }
+        if (config->time_limit > 0 && it % clock_check == 0 && elapsed_time_sec(start_time, get_time()) > config->time_limit) {
+            stopped = true;
+            break;
+        }
 
-        // twice per reset we print states
-        if (it % (reset_its / 2) == 0) {
+        // twice per reset we print states (the schedules may have shortened the reset interval to 2)
+        long long print_period = engine == ENGINE_PENALTY ? PENALTY_RESET_RUNS / 2 : reset_its / 2;
+        if (!config->quiet && it % (print_period > 1 ? print_period : 1) == 0) {
             double time_elapsed = elapsed_time_sec(start_time, get_time());
-            print_stats(thread_id, time_elapsed, it, total_violations, min_distance, point_with_max_violations, violations_per_point, sync);
+            int point_with_max_violations = vstate_point_with_max_violations(vs);
+            STATS_PHASE(stats, &clock, PHASE_OTHER);
+            print_stats(thread_id, time_elapsed, it, total_violations, vs->search_weight ? vs->violated_score : -1, min_distance, point_with_max_violations, vs->violations_per_point, sync);
+            STATS_PHASE(stats, &clock, PHASE_LOCAL_EVAL);
         }
 
-      
-        for (int sub_it = 0; sub_it < sub_iterations; sub_it++) {
-            // choose a point to move proportionally to constraint violations
-            int chosen_for_replacement = sample_proportional(violations_per_point, N, rng);
-            
-            // Skip if this is a fixed point
-            if (is_point_fixed[chosen_for_replacement]) {
-                // Try again with another point if this one is fixed
+        if (engine == ENGINE_PENALTY) {
+            // one run from the current points, kicked if the last run did not improve; the outcome
+            // replaces them unless it violates more constraints
+            STATS_PHASE(stats, &clock, PHASE_PENALTY);
+            memcpy(ws.test_pts, points, N * sizeof(Point));
+            if (kick) {
+                penalty_kick(vs, points, N, ws.frozen, PENALTY_KICK * its_since_checkpoint, rng);
+            }
+            penalty_minimize(&ws.penalty, work, ws.frozen, points, PENALTY_ITERATIONS);
+            STATS_ADD(stats, penalty_runs, 1);
+            STATS_PHASE(stats, &clock, PHASE_FULL_EVAL);
+            int violations = full_evaluation(vs, work, points, MIN_DIST, &min_distance);
+            STATS_ADD(stats, evaluated_constraints, work->constraint_count);
+            kick = violations >= total_violations;
+            if (violations > total_violations) {
+                memcpy(points, ws.test_pts, N * sizeof(Point));
+                violations = full_evaluation(vs, work, points, MIN_DIST, &min_distance);
+                STATS_ADD(stats, evaluated_constraints, work->constraint_count);
+            } else if (violations < total_violations) {
+                STATS_ADD(stats, publishes, 1);
+                STATS_PHASE(stats, &clock, PHASE_SYNC);
+                sync_broadcast_new_solution(sync, points, violations);
+                its_since_checkpoint = 0;
+            }
+            total_violations = violations;
+            lowest = lowest < total_violations ? lowest : total_violations;
+            STATS_PHASE(stats, &clock, PHASE_LOCAL_EVAL);
+            it++;
+            its_since_checkpoint++;
+            continue;
+        }
+
+        // on a plateau of the local search, the hybrid engine tries the penalty engine
+        if (engine == ENGINE_HYBRID && its_since_checkpoint > 0 && its_since_checkpoint % PENALTY_PLATEAU == 0) {
+            STATS_PHASE(stats, &clock, PHASE_PENALTY);
+            int violations = penalty_polish(&ws, work, points, total_violations, MIN_DIST, &min_distance);
+            STATS_ADD(stats, penalty_runs, 1);
+            STATS_ADD(stats, evaluated_constraints, work->constraint_count);
+            if (violations < total_violations) {
+                STATS_ADD(stats, publishes, 1);
+                STATS_PHASE(stats, &clock, PHASE_SYNC);
+                sync_broadcast_new_solution(sync, points, violations);
+                its_since_checkpoint = 0;
+            }
+            total_violations = violations;
+            lowest = lowest < total_violations ? lowest : total_violations;
+            STATS_PHASE(stats, &clock, PHASE_LOCAL_EVAL);
+            if (total_violations == 0) {
                 continue;
             }
-            
-            // first evaluation regarding the chosen point
-            // local evaluation only looks at constaints involving the chosen point.
-            if (symmetry->num_cycles == 0) {
-                evaluate(points, N, constraints, constraint_count,
-                    constraints_per_point, MIN_DIST,
-                    &violations_chosen, violations_per_point_relative, &max_violation_relative, 
-                    &min_dist_relative, chosen_for_replacement, constraints_per_point_count[chosen_for_replacement]);
-            } else {
-                evaluate(points, N, constraints, constraint_count,
-                        constraints_per_point, MIN_DIST,
-                        &violations_chosen, violations_per_point_relative, &max_violation_relative, 
-                        &min_dist_relative, -1, -1);
+        }
+
+        // on a plateau of the weighted score, the constraints still violated weigh more
+        if (vs->search_weight != NULL && its_since_improving_move >= config->weight_bump_its) {
+            vstate_bump_weights(vs, work);
+            STATS_ADD(stats, weight_bumps, 1);
+            if (++bumps % WEIGHT_DECAY_PERIOD == 0) {
+                vstate_decay_weights(vs, work);
+            }
+            its_since_improving_move = 0;
+        }
+      
+        for (int sub_it = 0; sub_it < sub_iterations; sub_it++) {
+            // choose a point to move proportionally to constraint violations (fixed points are never drawn)
+            int chosen_for_replacement = vstate_sample_point(vs, rng);
+            if (chosen_for_replacement == -1) {
+                break;
             }
-    
-            // create copy 
-            memcpy(test_pts, points, N * sizeof(Point));
-            
-                
-            // update the chosen point in the copy
-            test_pts[chosen_for_replacement] = random_point_in_ball(points[chosen_for_replacement],
-                fmax(MIN_RADIUS, final_radius / pow(2, sub_it)), rng);
             
-        
-            enforce_symmetry(symmetry, test_pts);
-        
-            // evaluate the updated points
-            int total_violations_with_test, temp_violations_per_point[N], temp_max_violation_point;
-            double temp_min_dist;
+            double radius = fmax(config->min_radius, final_radius / pow(2, sub_it));
             
-            if (symmetry->num_cycles == 0) {
-                evaluate(test_pts, N, constraints, constraint_count,
-                    constraints_per_point, MIN_DIST,
-                    &total_violations_with_test, temp_violations_per_point, &temp_max_violation_point, &temp_min_dist, chosen_for_replacement, constraints_per_point_count[chosen_for_replacement]);
+            long long improv;
+            int changed_count = 0;
+            int orbit = -1;
+            Point candidate;
+            if (orbits == NULL) {
+                if (config->relocate > 0 && rng_double(rng) < config->relocate) {
+                    // the best cell along a line, within the largest radius of the moves
+                    candidate = move_engine_relocate(&ws.moves, problem, vs, points, chosen_for_replacement, final_radius, rng);
+                    STATS_ADD(stats, evaluated_constraints, problem_degree(problem, chosen_for_replacement));
+                } else if (config->num_candidates > 1) {
+                    candidate = move_engine_sample_best(&ws.moves, problem, vs, points, chosen_for_replacement,
+                        radius, config->num_candidates, rng);
+                } else {
+                    candidate = random_point_in_ball(points[chosen_for_replacement], radius, rng);
+                }
+                // only the constraints involving the chosen point can change.
+                // The chosen candidate is re-scored with the same predicate as full evaluations,
+                // so that the incremental state never drifts from them.
+                improv = vstate_score_move(vs, problem, points, chosen_for_replacement, candidate, ws.changed, &changed_count);
+                STATS_ADD(stats, evaluated_constraints,
+                    (config->num_candidates > 1 ? config->num_candidates + 1 : 1) * (long long)problem_degree(problem, chosen_for_replacement));
             } else {
-                evaluate(test_pts, N, constraints, constraint_count,
-                    constraints_per_point, MIN_DIST,
-                    &total_violations_with_test, temp_violations_per_point, &temp_max_violation_point, &temp_min_dist, -1, -1);
+                // the move drags the whole orbit of the chosen point along: the leader moves and
+                // only the representatives touching the orbit are re-evaluated
+                orbit = orbits->orbit_of[chosen_for_replacement];
+                int leader = orbit_point_members(orbits, orbit)[0];
+                candidate = random_point_in_ball(points[leader], radius, rng);
+                improv = orbit_score_move(orbits, vs, points, orbit, candidate, ws.saved, ws.changed, &changed_count);
+                STATS_ADD(stats, evaluated_constraints, orbit_degree(orbits, orbit));
             }
             
-            int local_violations = violations_per_point_relative[chosen_for_replacement];
-            int local_violations_with_test = temp_violations_per_point[chosen_for_replacement];
-            
-            int improv = (symmetry->num_cycles == 0) ? local_violations_with_test - local_violations : total_violations_with_test - total_violations;
+            STATS_ADD(stats, sub_iterations, 1);
+            STATS_ADD(stats, accepted_moves, improv <= 0);
+            STATS_ADD(stats, rejected_moves, improv > 0);
+            if (improv > 0 && orbit != -1) {
+                orbit_restore(orbits, points, orbit, ws.saved);
+            }
+
             if (improv <= 0) {
-                // update points
-                points[chosen_for_replacement] = test_pts[chosen_for_replacement];
-                  
-                enforce_symmetry(symmetry, points);
-                
-       
-                if (symmetry->num_cycles > 0) {
-                    // TODO: this temporary
-                    evaluate(points, N, constraints, constraint_count, constraints_per_point, MIN_DIST,
-                        &total_violations, violations_per_point, &point_with_max_violations, &min_distance, -1, -1);
-                } else {
-                    // update violations
-                    for (int i = 0; i < N; i++) {
-                        violations_per_point[i] += temp_violations_per_point[i] - violations_per_point_relative[i];
-                    }
-                }   
+                // update points (a scored orbit move is already in place)
+                if (orbit == -1) {
+                    points[chosen_for_replacement] = candidate;
+                }
+                // with adaptive weighting, improv is the change of the weighted score
+                int before = vs->violated_weight;
+                vstate_apply(vs, work, ws.changed, changed_count);
+                total_violations += vs->violated_weight - before;
                  
                 // update check point if there is a strict improvement
                 if (improv < 0) {
-                    if (symmetry->num_cycles == 0) {
-                        total_violations += local_violations_with_test - local_violations; 
+                    STATS_ADD(stats, improving_moves, 1);
+                    its_since_improving_move = 0;
+                    if (vs->search_weight == NULL || total_violations < lowest) {
+                        lowest = total_violations;
+                        STATS_ADD(stats, publishes, 1);
+                        STATS_PHASE(stats, &clock, PHASE_SYNC);
+                        sync_broadcast_new_solution(sync, points, total_violations);
+                        STATS_PHASE(stats, &clock, PHASE_LOCAL_EVAL);
+                        its_since_checkpoint = 0; 
                     }
-                   
-                    sync_broadcast_new_solution(sync, points, total_violations);
-                    its_since_checkpoint = 0; 
                   
                     break;
                 }
@@ -257,23 +650,37 @@ void solve(int N,
         
         it++;
         its_since_checkpoint++;
+        its_since_improving_move++;
     }
     
-    if(sync_set_stop(sync)) { // only print and save if no other thread has done so first.
-    
-        // final solution check.
-        evaluate(points, N, constraints, constraint_count, constraints_per_point, MIN_DIST,
-        &total_violations, violations_per_point, &point_with_max_violations, &min_distance, -1, -1);
+    STATS_PHASE(stats, &clock, PHASE_OTHER);
+    double time_elapsed = elapsed_time_sec(start_time, get_time());
+    restart_log_attempt(sync, thread_id, &attempt, it, time_elapsed, stopped ? lowest : 0, stopped ? "stopped" : "solved");
+    if (stopped) {
+        return (solve_result_t){ false, it, time_elapsed };
+    }
+    if (!sync_set_stop(sync)) { // only print and save if no other thread has done so first.
+        return (solve_result_t){ false, it, time_elapsed };
+    }
 
-        assert(total_violations == 0);
+    // final solution check.
+    int point_with_max_violations;
+    evaluate(points, problem, MIN_DIST,
+    &total_violations, vs->violations_per_point, &point_with_max_violations, &min_distance, -1);
 
-        double time_elapsed = elapsed_time_sec(start_time, get_time());
+    assert(total_violations == 0);
 
+    if (!config->quiet) {
         color_printf(GREEN, "\n====================  SOLVED  ====================\n\n");
         color_printf(YELLOW, "Time");  printf(": %.3f seconds\n", time_elapsed);
         color_printf(YELLOW, "Total iterations"); printf(": %lld\n", it);
         color_printf(YELLOW, "Minimum distance"); printf(": %.3f\n", min_distance);
         color_printf(YELLOW, "Thread number"); printf(": %d\n", thread_id);
+        if (config->portfolio_entry >= 0) {
+            char description[256];
+            solver_config_describe(config, description, sizeof(description));
+            color_printf(YELLOW, "Configuration"); printf(": portfolio entry %d, %s\n", config->portfolio_entry, description);
+        }
         color_printf(GREEN, "\nSolution:\n");
 
         for (int i = 0; i < N; i++) {
@@ -281,8 +688,13 @@ void solve(int N,
         }
 
         printf("\n");
+    }
 
-        serialize_solution(N, points, output_file);
+    serialize_solution(N, points, output_file);
+    if (!config->quiet) {
         color_printf(YELLOW, "Solution saved to %s\n", output_file);
     }
+    return (solve_result_t){ true, it, time_elapsed };
 }
+
+#endif // SOLVER_H
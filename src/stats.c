@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include "utils.c"
+
+#ifndef STATS_H
+#define STATS_H
+
+// Search counters and phase timers of the solver threads.
+// Each thread owns one search_stats_t and is its only writer; the stream thread may take snapshots
+// at any time, so the counters are atomics updated with relaxed loads and stores, which compile to
+// plain moves. The final line is written by main() once the threads are joined. Built with SEARCH_STATS=0 (`make STATS=0`), the
+// STATS_* macros expand to nothing and the search carries no cost at all.
+#ifndef SEARCH_STATS
+#define SEARCH_STATS 1
+#endif
+
+typedef atomic_llong stat_counter_t;
+
+// Phases the time of a search is split into; every moment of a solve() call is charged to one of them.
+typedef enum {
+    PHASE_LOCAL_EVAL,   // sub-iterations: sampling, scoring and applying moves
+    PHASE_FULL_EVAL,    // full re-evaluations and solution checks
+    PHASE_RESET,        // the random perturbation tests after a reset
+    PHASE_SYNC,         // publishing to and fetching from the elite pool
+    PHASE_PENALTY,      // runs of the penalty engine
+    PHASE_OTHER,        // stop checks, progress printing
+    PHASE_COUNT
+} search_phase_t;
+
+static const char* const phase_names[PHASE_COUNT] = { "local_eval", "full_eval", "reset", "sync", "penalty", "other" };
+
+typedef struct {
+    _Alignas(64) stat_counter_t sub_iterations;   // own cache line, per thread
+    stat_counter_t evaluated_constraints;
+    stat_counter_t accepted_moves;          // moves that did not increase the violations
+    stat_counter_t rejected_moves;
+    stat_counter_t improving_moves;         // strictly decreasing the violations, also counted as accepted
+    stat_counter_t resets;
+    stat_counter_t random_move_tests;       // test_random_moves() calls
+    stat_counter_t publishes;               // solutions offered to the elite pool
+    stat_counter_t fetches;                 // solutions taken from the elite pool
+    stat_counter_t penalty_runs;            // runs of the penalty engine
+    stat_counter_t weight_bumps;            // bumps of the search weights of the violated constraints
+    stat_counter_t phase_ns[PHASE_COUNT];
+} search_stats_t;
+
+// The phase a thread is in, and since when.
+typedef struct {
+    struct timespec since;
+    search_phase_t phase;
+} phase_clock_t;
+
+void stats_init(search_stats_t* stats) {
+    atomic_init(&stats->sub_iterations, 0);
+    atomic_init(&stats->evaluated_constraints, 0);
+    atomic_init(&stats->accepted_moves, 0);
+    atomic_init(&stats->rejected_moves, 0);
+    atomic_init(&stats->improving_moves, 0);
+    atomic_init(&stats->resets, 0);
+    atomic_init(&stats->random_move_tests, 0);
+    atomic_init(&stats->publishes, 0);
+    atomic_init(&stats->fetches, 0);
+    atomic_init(&stats->penalty_runs, 0);
+    atomic_init(&stats->weight_bumps, 0);
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        atomic_init(&stats->phase_ns[p], 0);
+    }
+}
+
+static inline long long stat_load(const stat_counter_t* counter) {
+    return atomic_load_explicit((stat_counter_t*)counter, memory_order_relaxed);
+}
+
+// Single writer: a relaxed load and store, no locked read-modify-write.
+static inline void stat_add(stat_counter_t* counter, long long n) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+static inline void phase_clock_start(phase_clock_t* clock, search_phase_t phase) {
+    clock->since = get_time();
+    clock->phase = phase;
+}
+
+// Charges the time since the last switch to the current phase, and enters `phase`.
+static inline void phase_clock_switch(search_stats_t* stats, phase_clock_t* clock, search_phase_t phase) {
+    struct timespec now = get_time();
+    long long ns = (now.tv_sec - clock->since.tv_sec) * 1000000000LL + (now.tv_nsec - clock->since.tv_nsec);
+    stat_add(&stats->phase_ns[clock->phase], ns);
+    clock->since = now;
+    clock->phase = phase;
+}
+
+#if SEARCH_STATS
+#define STATS_ADD(stats, field, n) stat_add(&(stats)->field, (n))
+#define STATS_CLOCK_START(clock, phase) phase_clock_start((clock), (phase))
+#define STATS_PHASE(stats, clock, phase) phase_clock_switch((stats), (clock), (phase))
+#else
+// the count is still evaluated, so that a local kept for it is used: it must have no side effects all the same
+#define STATS_ADD(stats, field, n) ((void)(stats), (void)(n))
+#define STATS_CLOCK_START(clock, phase) ((void)(clock))
+#define STATS_PHASE(stats, clock, phase) ((void)(stats), (void)(clock))
+#endif
+
+static void stats_write_counters(FILE* file, const search_stats_t* stats) {
+    fprintf(file, "\"sub_iterations\": %lld, \"evaluated_constraints\": %lld, \"accepted_moves\": %lld, "
+        "\"rejected_moves\": %lld, \"improving_moves\": %lld, \"resets\": %lld, \"random_move_tests\": %lld, "
+        "\"publishes\": %lld, \"fetches\": %lld, \"penalty_runs\": %lld, \"weight_bumps\": %lld, \"phase_seconds\": {",
+        stat_load(&stats->sub_iterations), stat_load(&stats->evaluated_constraints), stat_load(&stats->accepted_moves),
+        stat_load(&stats->rejected_moves), stat_load(&stats->improving_moves), stat_load(&stats->resets),
+        stat_load(&stats->random_move_tests), stat_load(&stats->publishes), stat_load(&stats->fetches),
+        stat_load(&stats->penalty_runs), stat_load(&stats->weight_bumps));
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        fprintf(file, "\"%s\": %.6f%s", phase_names[p], stat_load(&stats->phase_ns[p]) / 1e9, p + 1 < PHASE_COUNT ? ", " : "}");
+    }
+}
+
+// Appends one snapshot of the threads' counters, and their sum, as a single line of JSON.
+void stats_write_snapshot(FILE* file, const search_stats_t* stats, int count, double elapsed, bool final) {
+    search_stats_t total;
+    stats_init(&total);
+    for (int t = 0; t < count; t++) {
+        stat_add(&total.sub_iterations, stat_load(&stats[t].sub_iterations));
+        stat_add(&total.evaluated_constraints, stat_load(&stats[t].evaluated_constraints));
+        stat_add(&total.accepted_moves, stat_load(&stats[t].accepted_moves));
+        stat_add(&total.rejected_moves, stat_load(&stats[t].rejected_moves));
+        stat_add(&total.improving_moves, stat_load(&stats[t].improving_moves));
+        stat_add(&total.resets, stat_load(&stats[t].resets));
+        stat_add(&total.random_move_tests, stat_load(&stats[t].random_move_tests));
+        stat_add(&total.publishes, stat_load(&stats[t].publishes));
+        stat_add(&total.fetches, stat_load(&stats[t].fetches));
+        stat_add(&total.penalty_runs, stat_load(&stats[t].penalty_runs));
+        stat_add(&total.weight_bumps, stat_load(&stats[t].weight_bumps));
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            stat_add(&total.phase_ns[p], stat_load(&stats[t].phase_ns[p]));
+        }
+    }
+
+    fprintf(file, "{\"time\": %.3f, \"final\": %s, \"total\": {", elapsed, final ? "true" : "false");
+    stats_write_counters(file, &total);
+    fprintf(file, "}, \"threads\": [");
+    for (int t = 0; t < count; t++) {
+        fprintf(file, "{\"thread\": %d, ", t + 1);
+        stats_write_counters(file, &stats[t]);
+        fprintf(file, "}%s", t + 1 < count ? ", " : "");
+    }
+    fprintf(file, "]}\n");
+    fflush(file);
+}
+
+// Writes the stats of `count` threads to a file of JSON lines: a snapshot every `interval` seconds
+// if interval > 0, and the final one when stopped.
+typedef struct {
+    FILE* file;
+    const search_stats_t* stats;
+    int count;
+    double interval;
+    struct timespec start;
+    atomic_bool done;
+    pthread_mutex_t write_mutex;
+    pthread_t thread;
+} stats_stream_t;
+
+static void* stats_stream_worker(void* arg) {
+    stats_stream_t* stream = arg;
+    double next = stream->interval;
+    while (!atomic_load(&stream->done)) {
+        struct timespec pause = { 0, 50 * 1000000 };
+        nanosleep(&pause, NULL);
+        double elapsed = elapsed_time_sec(stream->start, get_time());
+        if (elapsed >= next) {
+            pthread_mutex_lock(&stream->write_mutex);
+            if (!atomic_load(&stream->done)) {
+                stats_write_snapshot(stream->file, stream->stats, stream->count, elapsed, false);
+            }
+            pthread_mutex_unlock(&stream->write_mutex);
+            next += stream->interval;
+        }
+    }
+    return NULL;
+}
+
+void stats_stream_start(stats_stream_t* stream, const char* path, const search_stats_t* stats, int count, double interval) {
+    stream->file = fopen(path, "w");
+    if (stream->file == NULL) {
+        printf("Error opening file %s\n", path);
+        exit(1);
+    }
+    stream->stats = stats;
+    stream->count = count;
+    stream->interval = interval;
+    stream->start = get_time();
+    atomic_init(&stream->done, false);
+    pthread_mutex_init(&stream->write_mutex, NULL);
+    if (interval > 0 && pthread_create(&stream->thread, NULL, stats_stream_worker, stream) != 0) {
+        perror("Failed to create thread");
+        exit(1);
+    }
+}
+
+// Writes the final snapshot and closes the file; only the first call does.
+void stats_stream_finish(stats_stream_t* stream) {
+    if (atomic_exchange(&stream->done, true)) {
+        return;
+    }
+    pthread_mutex_lock(&stream->write_mutex);
+    stats_write_snapshot(stream->file, stream->stats, stream->count, elapsed_time_sec(stream->start, get_time()), true);
+    fclose(stream->file);
+    pthread_mutex_unlock(&stream->write_mutex);
+}
+
+// Joins the stream thread after stats_stream_finish.
+void stats_stream_destroy(stats_stream_t* stream) {
+    if (stream->interval > 0) {
+        pthread_join(stream->thread, NULL);
+    }
+    pthread_mutex_destroy(&stream->write_mutex);
+}
+
+#endif // STATS_H
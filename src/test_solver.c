@@ -7,6 +7,18 @@
 
 #include "utils.c"
 #include "evaluation.c"
+#include "violations.c"
+#include "moves.c"
+#include "orbits.c"
+#include "threading.c"
+#include "binary_format.c"
+#include "batch.c"
+#include "portfolio.c"
+#include "stats.c"
+#include "generator.c"
+#include "checkpoint.c"
+#include "monitor.c"
+#include "multilevel.c"
 #include "rng.c"
 
 // Utility function to compare points
@@ -40,6 +52,42 @@ void test_random_point_in_ball() {
         assert(distance <= radius);
     }
     
+    // batched offsets fall in the disk and cover it evenly: a quarter in each quadrant, and
+    // a quarter within half the radius
+    enum { K = 40000 };
+    double* dx = malloc(K * sizeof(double));
+    double* dy = malloc(K * sizeof(double));
+    rng_disk_offsets(&rng, radius, dx, dy, K);
+    int quadrants[4] = { 0 }, inner = 0;
+    for (int q = 0; q < K; q++) {
+        assert(dx[q] * dx[q] + dy[q] * dy[q] < radius * radius);
+        quadrants[(dx[q] >= 0) + 2 * (dy[q] >= 0)]++;
+        inner += dx[q] * dx[q] + dy[q] * dy[q] < radius * radius / 4;
+    }
+    for (int i = 0; i < 4; i++) {
+        assert(abs(quadrants[i] - K / 4) < K / 50);
+    }
+    assert(abs(inner - K / 4) < K / 50);
+    free(dx);
+    free(dy);
+    
+    // doubles carry more than the 24 bits of a float, and a seed always gives the same stream
+    bool finer = false;
+    for (int i = 0; i < 100; i++) {
+        double u = rng_double(&rng);
+        assert(u >= 0 && u < 1);
+        finer = finer || u * 0x1.0p24 != floor(u * 0x1.0p24);
+    }
+    assert(finer);
+    rng_t a, b;
+    rng_init(&a, 7);
+    rng_init(&b, 7);
+    for (int i = 0; i < 10; i++) {
+        assert(rng_next(&a) == rng_next(&b));
+    }
+    rng_init(&b, 8);
+    assert(rng_next(&a) != rng_next(&b));
+    
     printf("random_point_in_ball test PASSED\n");
 }
 
@@ -146,6 +194,95 @@ void test_sample_proportional() {
     printf("sample_proportional test PASSED\n");
 }
 
+// Test the exact orientation predicate on nearly collinear points, where plain doubles fail
+void test_orientation_predicate() {
+    printf("Testing orientation predicate...\n");
+    
+    // c = (0.5 + i ulp, 0.5 + j ulp) against the line y = x through a and b: sign(det) = sign(j - i)
+    Point a = {12.0, 12.0};
+    Point b = {24.0, 24.0};
+    double ulp = 0x1p-53;
+    int naive_wrong = 0;
+    for (int i = 0; i < 64; i++) {
+        for (int j = 0; j < 64; j++) {
+            Point c = {0.5 + i * ulp, 0.5 + j * ulp};
+            int expected = (j > i) - (j < i);
+            assert(orient2d_sign(a, b, c) == expected);
+            assert(orient2d_exact_sign(a, b, c) == expected);
+            double d = det(a, b, c);
+            naive_wrong += ((d > 0) - (d < 0)) != expected;
+        }
+    }
+    printf("  plain det() got %d of 4096 signs wrong\n", naive_wrong);
+    
+    // the predicate rule in each mode
+    predicate_t saved = predicate;
+    Constraint above = {1, 2, 3, 1};
+    Point p = {0.0, 0.0}, q = {1.0, 0.0};
+    Point r = {0.5, 1e-7};
+    assert(constraint_violated(&above, p, q, r)); // below the absolute margin
+    predicate_set_margin(0.0);
+    assert(!constraint_violated(&above, p, q, r));
+    assert(constraint_violated(&above, p, q, (Point){0.5, 0.0}));
+    predicate_set_margin(1e-6);
+    assert(constraint_violated(&above, p, q, r));
+    assert(!constraint_violated(&above, p, q, (Point){0.5, 1e-5}));
+    // scale-relative: scaling all points up or rotating them does not change the verdict
+    assert(constraint_violated(&above, (Point){0, 0}, (Point){1e6, 0}, (Point){0.5e6, 1e-1}));
+    assert(!constraint_violated(&above, (Point){0, 0}, (Point){1e6, 0}, (Point){0.5e6, 10.0}));
+    assert(constraint_violated(&above, (Point){0, 0}, (Point){0, 1}, (Point){-1e-7, 0.5}));
+    assert(!constraint_violated(&above, (Point){0, 0}, (Point){0, 1}, (Point){-1e-5, 0.5}));
+    predicate = saved;
+    
+    printf("orientation predicate test PASSED\n");
+}
+
+// Test the Fenwick sampler: distribution, zero weights and point updates
+void test_fenwick_sampler() {
+    printf("Testing Fenwick sampler...\n");
+    
+    rng_t rng;
+    rng_init(&rng, 42);
+    arena_t arena;
+    arena_init(&arena, fenwick_bytes(7));
+    fenwick_t fenwick;
+    fenwick_init(&fenwick, 7, &arena);
+    
+    long long weights[7] = {10, 0, 20, 30, 0, 20, 10};
+    fenwick_build(&fenwick, weights);
+    assert(fenwick_total(&fenwick) == 90);
+    
+    int counts[7] = {0};
+    int num_samples = 18000;
+    for (int i = 0; i < num_samples; i++) {
+        int idx = fenwick_sample(&fenwick, &rng);
+        assert(idx >= 0 && idx < 7);
+        counts[idx]++;
+    }
+    // zero weights are never drawn, the others roughly in proportion
+    assert(counts[1] == 0 && counts[4] == 0);
+    for (int i = 0; i < 7; i++) {
+        double expected = (double)weights[i] / 90;
+        double percentage = (double)counts[i] / num_samples;
+        assert(fabs(percentage - expected) < 0.03);
+    }
+    
+    // after updates only the last index has weight
+    for (int i = 0; i < 6; i++) {
+        fenwick_add(&fenwick, i, -weights[i]);
+    }
+    fenwick_add(&fenwick, 6, 5);
+    assert(fenwick_total(&fenwick) == 15);
+    for (int i = 0; i < 100; i++) {
+        assert(fenwick_sample(&fenwick, &rng) == 6);
+    }
+    fenwick_add(&fenwick, 6, -15);
+    assert(fenwick_sample(&fenwick, &rng) == -1);
+    
+    arena_free(&arena);
+    printf("Fenwick sampler test PASSED\n");
+}
+
 // Our own implementation of rotate_r_k for testing
 Point test_rotate_by_angle(Point p, double angle) {
     Point rotated;
@@ -241,11 +378,11 @@ void test_enforce_symmetry() {
     sym.num_cycles = 1;
     
     // One cycle with 4 points (0,1,2,3)
-    sym.cycles[0][0] = 0;
-    sym.cycles[0][1] = 1;
-    sym.cycles[0][2] = 2;
-    sym.cycles[0][3] = 3;
-    sym.cycle_lengths[0] = 4;
+    int cycle0[4] = {0, 1, 2, 3};
+    int* cycles[1] = {cycle0};
+    int cycle_lengths[1] = {4};
+    sym.cycles = cycles;
+    sym.cycle_lengths = cycle_lengths;
     
     // Create test points
     Point points[4];
@@ -291,6 +428,1488 @@ void test_enforce_symmetry() {
     printf("enforce_symmetry test PASSED\n");
 }
 
+// Test the per-point CSR constraint index
+void test_problem_index() {
+    printf("Testing problem_build_index...\n");
+    
+    Problem problem;
+    problem.N = 5;
+    problem.constraint_count = 3;
+    problem.constraints = malloc(3 * sizeof(Constraint));
+    problem.constraints[0] = (Constraint){1, 2, 3, 1};
+    problem.constraints[1] = (Constraint){1, 2, 5, -1};
+    problem.constraints[2] = (Constraint){2, 4, 5, 1};
+    problem_build_index(&problem);
+    
+    int expected_degree[5] = {2, 3, 1, 1, 2};
+    for (int p = 0; p < problem.N; p++) {
+        assert(problem_degree(&problem, p) == expected_degree[p]);
+        const int* cs = problem_point_constraints(&problem, p);
+        for (int t = 0; t < problem_degree(&problem, p); t++) {
+            Constraint c = problem.constraints[cs[t]];
+            assert(c.i - 1 == p || c.j - 1 == p || c.k - 1 == p);
+        }
+    }
+    assert(problem.point_offsets[problem.N] == 3 * problem.constraint_count);
+    
+    problem_free(&problem);
+    printf("problem_build_index test PASSED\n");
+}
+
+void make_random_problem(Problem* problem, int N, rng_t* rng);
+
+// Checks that the cursor of each point visits exactly its constraints, by ascending id
+static void check_point_cursors(const Problem* problem) {
+    for (int p = 0; p < problem->N; p++) {
+        point_cursor_t cursor = point_cursor(problem, p);
+        int visited = 0, previous = -1, id;
+        Constraint constraint;
+        while (point_cursor_next(&cursor, &id, &constraint)) {
+            const Constraint* expected = &problem->constraints[id];
+            assert(id > previous);
+            assert(constraint.i == expected->i && constraint.j == expected->j && constraint.k == expected->k);
+            assert(constraint.sign == expected->sign);
+            assert(constraint.i - 1 == p || constraint.j - 1 == p || constraint.k - 1 == p);
+            previous = id;
+            visited++;
+        }
+        assert(visited == problem_degree(problem, p));
+    }
+}
+
+// Test that the implicit index of a complete chirotope visits the same constraints as the CSR index
+void test_complete_chirotope() {
+    printf("Testing complete chirotope index...\n");
+    
+    rng_t rng;
+    rng_init(&rng, 11);
+    int N = 9;
+    Problem problem;
+    make_random_problem(&problem, N, &rng);
+    problem.constraints[7].sign = 0;
+    problem.columns.sign[7] = 0;
+    free(problem.chirotope);
+    problem_build_point_index(&problem);
+    assert(problem.complete && problem.point_constraints == NULL);
+    
+    for (int c = 0; c < problem.constraint_count; c++) {
+        const Constraint* constraint = &problem.constraints[c];
+        assert(triple_rank(&problem, constraint->i - 1, constraint->j - 1, constraint->k - 1) == c);
+    }
+    check_point_cursors(&problem);
+    
+    // the same chirotope in colex order
+    Problem colex = problem;
+    colex.constraints = malloc(problem.constraint_count * sizeof(Constraint));
+    for (int c = 0; c < problem.constraint_count; c++) {
+        const Constraint* constraint = &problem.constraints[c];
+        colex.constraints[colex_rank(constraint->i - 1, constraint->j - 1, constraint->k - 1)] = *constraint;
+    }
+    problem_build_index(&colex);
+    assert(colex.complete && colex.colex);
+    check_point_cursors(&colex);
+    problem_free(&colex);
+    
+    // out of order: back to the CSR index
+    Constraint first = problem.constraints[0];
+    problem.constraints[0] = problem.constraints[1];
+    problem.constraints[1] = first;
+    free(problem.chirotope);
+    problem_build_point_index(&problem);
+    assert(!problem.complete && problem.point_constraints != NULL);
+    
+    problem_free(&problem);
+    printf("complete chirotope index test PASSED\n");
+}
+
+// Builds a random complete instance from a random point set
+void make_random_problem(Problem* problem, int N, rng_t* rng) {
+    Point* pts = malloc(N * sizeof(Point));
+    generate_random_assignment(N, pts, rng);
+    problem->N = N;
+    problem->constraint_count = 0;
+    problem->constraints = malloc(N * (N-1) * (N-2) / 6 * sizeof(Constraint));
+    for (int i = 1; i <= N; i++) {
+        for (int j = i + 1; j <= N; j++) {
+            for (int k = j + 1; k <= N; k++) {
+                int sign = det(pts[i-1], pts[j-1], pts[k-1]) > 0 ? 1 : -1;
+                problem->constraints[problem->constraint_count++] = (Constraint){i, j, k, sign};
+            }
+        }
+    }
+    problem_build_index(problem);
+    free(pts);
+}
+
+// Test that binary orientation files load back to the same problem, in both layouts
+void test_binary_format() {
+    printf("Testing binary orientation files...\n");
+    
+    rng_t rng;
+    rng_init(&rng, 5);
+    int N = 9;
+    char path[] = "/tmp/localizer_test_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+    
+    for (int layout = 0; layout < 2; layout++) {
+        Problem problem;
+        make_random_problem(&problem, N, &rng);
+        problem.constraints[5].sign = 0;
+        problem.columns.sign[5] = 0;
+        if (layout == 1) {
+            // drop a triple: no longer a complete chirotope
+            problem.constraint_count--;
+            free(problem.point_offsets);
+            free(problem.point_constraints);
+            free(problem.chirotope);
+            problem_build_point_index(&problem);
+        }
+        assert(write_binary_orientations(&problem, path) == (layout == 0));
+        assert(is_binary_orientation_file(path));
+        
+        Problem loaded;
+        load_orientations(path, &loaded);
+        assert(loaded.N == N);
+        assert(loaded.constraint_count == problem.constraint_count);
+        assert((loaded.mapping != NULL) == (layout == 1));
+        for (int c = 0; c < problem.constraint_count; c++) {
+            assert(loaded.constraints[c].i == problem.constraints[c].i);
+            assert(loaded.constraints[c].j == problem.constraints[c].j);
+            assert(loaded.constraints[c].k == problem.constraints[c].k);
+            assert(loaded.constraints[c].sign == problem.constraints[c].sign);
+            assert(loaded.columns.i[c] == problem.columns.i[c]);
+            assert(loaded.columns.sign[c] == problem.columns.sign[c]);
+        }
+        for (int p = 0; p < N; p++) {
+            assert(problem_degree(&loaded, p) == problem_degree(&problem, p));
+        }
+        problem_free(&loaded);
+        problem_free(&problem);
+    }
+    
+    unlink(path);
+    printf("binary orientation files test PASSED\n");
+}
+
+// Test that the incremental violation state agrees with a full evaluation after many moves
+void test_violation_state() {
+    printf("Testing incremental violation state...\n");
+    
+    rng_t rng;
+    rng_init(&rng, 7);
+    int N = 12;
+    Problem problem;
+    make_random_problem(&problem, N, &rng);
+    
+    arena_t arena;
+    arena_init(&arena, vstate_bytes(N, problem.constraint_count) + problem.constraint_count * sizeof(int) + 64);
+    violation_state_t vs;
+    vstate_init(&vs, N, problem.constraint_count, NULL, NULL, &arena);
+    int* changed = arena_alloc(&arena, problem.constraint_count * sizeof(int));
+    
+    Point* points = malloc(N * sizeof(Point));
+    int* violations_per_point = malloc(N * sizeof(int));
+    generate_random_assignment(N, points, &rng);
+    vstate_rebuild(&vs, &problem, points);
+    
+    int total_violations, max_point;
+    double min_distance;
+    for (int t = 0; t < 2000; t++) {
+        int p = vstate_sample_point(&vs, &rng);
+        assert(p >= 0 && p < N);
+        Point candidate = random_point_in_ball(points[p], 3.0, &rng);
+        int changed_count;
+        int delta = vstate_score_move(&vs, &problem, points, p, candidate, changed, &changed_count);
+        int before = vs.violated_count;
+        if (delta <= 0 || t % 3 == 0) {
+            points[p] = candidate;
+            vstate_apply(&vs, &problem, changed, changed_count);
+            assert(vs.violated_count == before + delta);
+        }
+    }
+    
+    evaluate(points, &problem, 0.0, &total_violations, violations_per_point, &max_point, &min_distance, -1);
+    assert(total_violations == vs.violated_count);
+    for (int p = 0; p < N; p++) {
+        assert(violations_per_point[p] == vs.violations_per_point[p]);
+    }
+    // the sampler follows the per-point counts
+    assert(fenwick_total(&vs.sampler) == WEIGHT_ADJUSTMENT * 3LL * total_violations + N);
+    
+    free(points);
+    free(violations_per_point);
+    arena_free(&arena);
+    problem_free(&problem);
+    printf("incremental violation state test PASSED\n");
+}
+
+// Test that the weighted score and counts stay in sync through bumps, moves and decays
+void test_adaptive_weights() {
+    printf("Testing adaptive constraint weights...\n");
+    
+    rng_t rng;
+    rng_init(&rng, 9);
+    int N = 12;
+    Problem problem;
+    make_random_problem(&problem, N, &rng);
+    
+    arena_t arena;
+    arena_init(&arena, vstate_bytes(N, problem.constraint_count) + vstate_weighting_bytes(problem.constraint_count)
+        + problem.constraint_count * sizeof(int) + 64);
+    violation_state_t vs;
+    vstate_init(&vs, N, problem.constraint_count, NULL, NULL, &arena);
+    vstate_enable_weighting(&vs, &arena);
+    int* changed = arena_alloc(&arena, problem.constraint_count * sizeof(int));
+    
+    Point* points = malloc(N * sizeof(Point));
+    generate_random_assignment(N, points, &rng);
+    vstate_rebuild(&vs, &problem, points);
+    // all the search weights start at 1
+    assert(vs.violated_count > 0 && vs.violated_score == vs.violated_weight);
+    
+    for (int t = 0; t < 2000; t++) {
+        if (t % 50 == 0) {
+            vstate_bump_weights(&vs, &problem);
+        }
+        int p = vstate_sample_point(&vs, &rng);
+        Point candidate = random_point_in_ball(points[p], 3.0, &rng);
+        int changed_count;
+        int delta = vstate_score_move(&vs, &problem, points, p, candidate, changed, &changed_count);
+        int before = vs.violated_score;
+        if (delta <= 0 || t % 3 == 0) {
+            points[p] = candidate;
+            vstate_apply(&vs, &problem, changed, changed_count);
+            assert(vs.violated_score == before + delta);
+        }
+    }
+    
+    // the violated weight still counts the violations; a rebuild with the same search weights agrees
+    int score = vs.violated_score, count = vs.violated_count;
+    long long sampled = fenwick_total(&vs.sampler);
+    int point_total = 0;
+    for (int p = 0; p < N; p++) {
+        point_total += vs.violations_per_point[p];
+    }
+    assert(vs.violated_weight == count && score >= count && point_total == 3 * score);
+    vstate_rebuild(&vs, &problem, points);
+    assert(vs.violated_score == score && vs.violated_count == count);
+    assert(fenwick_total(&vs.sampler) == sampled && sampled == WEIGHT_ADJUSTMENT * 3LL * score + N);
+    
+    // enough decays bring every search weight back to 1
+    for (int d = 0; d < 40; d++) {
+        vstate_decay_weights(&vs, &problem);
+    }
+    assert(vs.violated_score == vs.violated_weight);
+    for (int c = 0; c < problem.constraint_count; c++) {
+        assert(vs.search_weight[c] == 1);
+    }
+    free(points);
+    arena_free(&arena);
+    problem_free(&problem);
+    
+    // a search with adaptive weighting solves a generated instance
+    generate_problem(&problem, 15, POINTS_UNIFORM, 5);
+    N = problem.N;
+    solver_config_t config = solver_config_default();
+    config.weight_bump_its = 100;
+    config.time_limit = 20;
+    config.quiet = true;
+    arena_init(&arena, solver_workspace_bytes(&problem, &config, NULL));
+    synchronization_t sync;
+    sync_init(&sync, N);
+    bool* is_point_fixed = calloc(N, sizeof(bool));
+    Point* fixed_points = calloc(N, sizeof(Point));
+    points = calloc(N, sizeof(Point));
+    Symmetry symmetry = { NULL, NULL, 0 };
+    solve_result_t result = solve(&problem, &config, points, "/dev/null", 1, &sync, &rng, &arena,
+        is_point_fixed, fixed_points, &symmetry, NULL, NULL, NULL);
+    assert(result.solved);
+    sync_destroy(&sync);
+    arena_free(&arena);
+    problem_free(&problem);
+    free(is_point_fixed);
+    free(fixed_points);
+    free(points);
+    printf("adaptive constraint weights test PASSED\n");
+}
+
+// Test that every evaluation kernel agrees with evaluate()
+void test_eval_kernels() {
+    printf("Testing evaluation kernels...\n");
+    
+    rng_t rng;
+    rng_init(&rng, 11);
+    int N = 15;
+    Problem problem;
+    make_random_problem(&problem, N, &rng);
+    // a few collinear-sign constraints, which never count as violated
+    problem.columns.sign[3] = 0;
+    problem.constraints[3].sign = 0;
+    
+    Point* points = malloc(N * sizeof(Point));
+    double* x = malloc(N * sizeof(double));
+    double* y = malloc(N * sizeof(double));
+    int* violations_per_point = malloc(N * sizeof(int));
+    unsigned char* violated = malloc(problem.constraint_count);
+    generate_random_assignment(N, points, &rng);
+    // nearly collinear points, whose signs only the exact fallback gets right
+    points[0] = (Point){12.0, 12.0};
+    points[1] = (Point){24.0, 24.0};
+    points[2] = (Point){0.5 + 0x1p-52, 0.5};
+    points[3] = (Point){0.5, 0.5 + 0x1p-52};
+    points_to_soa(points, N, x, y);
+    
+    eval_kernel_init(&problem, &rng);
+    printf("  selected kernel: %s\n", eval_kernel.name);
+    
+    eval_kernel_fn kernels[3] = { eval_kernel_scalar, NULL, NULL };
+#ifdef EVAL_SIMD_X86
+    if (__builtin_cpu_supports("avx2")) kernels[1] = eval_kernel_avx2;
+    if (__builtin_cpu_supports("avx512f")) kernels[2] = eval_kernel_avx512;
+#endif
+    // default absolute margin, exact signs, scale-relative margin
+    predicate_t saved = predicate;
+    double margins[3] = { -1.0, 0.0, 1e-3 };
+    for (int mode = 0; mode < 3; mode++) {
+        if (margins[mode] >= 0) {
+            predicate_set_margin(margins[mode]);
+        }
+        int expected, max_point;
+        double min_distance;
+        evaluate(points, &problem, 0.0, &expected, violations_per_point, &max_point, &min_distance, -1);
+        for (int t = 0; t < 3; t++) {
+            if (kernels[t] == NULL) {
+                continue;
+            }
+            assert(kernels[t](&problem.columns, problem.constraint_count, x, y, NULL) == expected);
+            assert(kernels[t](&problem.columns, problem.constraint_count, x, y, violated) == expected);
+            for (int c = 0; c < problem.constraint_count; c++) {
+                const Constraint* constraint = &problem.constraints[c];
+                assert(violated[c] == constraint_violated(constraint, points[constraint->i - 1], points[constraint->j - 1], points[constraint->k - 1]));
+            }
+        }
+        // in exact mode, violated means a wrong exact sign
+        for (int c = 0; c < problem.constraint_count && predicate.exact; c++) {
+            const Constraint* constraint = &problem.constraints[c];
+            int exact = orient2d_exact_sign(points[constraint->i - 1], points[constraint->j - 1], points[constraint->k - 1]);
+            assert(violated[c] == (constraint->sign != 0 && constraint->sign * exact <= 0));
+        }
+    }
+    predicate = saved;
+    
+    free(points);
+    free(x);
+    free(y);
+    free(violations_per_point);
+    free(violated);
+    problem_free(&problem);
+    printf("evaluation kernels test PASSED\n");
+}
+
+// Test that the half-plane move engine counts the same violations as the determinant
+void test_move_engine() {
+    printf("Testing move engine...\n");
+    
+    rng_t rng;
+    rng_init(&rng, 5);
+    int N = 10;
+    Problem problem;
+    make_random_problem(&problem, N, &rng);
+    
+    int K = 16;
+    arena_t arena;
+    arena_init(&arena, move_engine_bytes(problem_max_degree(&problem), K) + vstate_bytes(N, problem.constraint_count)
+        + vstate_weighting_bytes(problem.constraint_count));
+    move_engine_t engine;
+    move_engine_init(&engine, problem_max_degree(&problem), K, &arena);
+    violation_state_t vs;
+    vstate_init(&vs, N, problem.constraint_count, NULL, NULL, &arena);
+    
+    Point* points = malloc(N * sizeof(Point));
+    generate_random_assignment(N, points, &rng);
+    vstate_rebuild(&vs, &problem, points);
+    
+    for (int p = 0; p < N; p++) {
+        move_engine_prepare(&engine, &problem, &vs, points, p);
+        assert(engine.current_score == vs.violations_per_point[p]);
+        engine.num_candidates = K;
+        for (int q = 0; q < K; q++) {
+            Point candidate = random_point_in_ball(points[p], 5.0, &rng);
+            engine.cx[q] = candidate.x;
+            engine.cy[q] = candidate.y;
+        }
+        move_engine_score(&engine);
+        for (int q = 0; q < K; q++) {
+            Point candidate = { engine.cx[q], engine.cy[q] };
+            int expected = 0;
+            for (int id = 0; id < problem.constraint_count; id++) {
+                const Constraint* c = &problem.constraints[id];
+                if (c->i - 1 != p && c->j - 1 != p && c->k - 1 != p) {
+                    continue;
+                }
+                expected += constraint_violated(c,
+                    c->i - 1 == p ? candidate : points[c->i - 1],
+                    c->j - 1 == p ? candidate : points[c->j - 1],
+                    c->k - 1 == p ? candidate : points[c->k - 1]);
+            }
+            assert(engine.score[q] == expected);
+        }
+        int pick = move_engine_pick(&engine);
+        assert(pick >= 0 && pick < K);
+    }
+
+    // with adaptive weights, candidates are scored by the weighted delta that accepts the move
+    int* changed = malloc(problem.constraint_count * sizeof(int));
+    vstate_enable_weighting(&vs, &arena);
+    vstate_rebuild(&vs, &problem, points);
+    for (int bump = 0; bump < 5; bump++) {
+        vstate_bump_weights(&vs, &problem);
+        int p = vstate_sample_point(&vs, &rng);
+        Point candidate = random_point_in_ball(points[p], 5.0, &rng);
+        int changed_count;
+        vstate_score_move(&vs, &problem, points, p, candidate, changed, &changed_count);
+        points[p] = candidate;
+        vstate_apply(&vs, &problem, changed, changed_count);
+    }
+    assert(vs.violated_score > vs.violated_weight);
+    for (int p = 0; p < N; p++) {
+        move_engine_prepare(&engine, &problem, &vs, points, p);
+        assert(engine.current_score == vs.violations_per_point[p]);
+        engine.num_candidates = K;
+        for (int q = 0; q < K; q++) {
+            Point candidate = random_point_in_ball(points[p], 5.0, &rng);
+            engine.cx[q] = candidate.x;
+            engine.cy[q] = candidate.y;
+        }
+        move_engine_score(&engine);
+        for (int q = 0; q < K; q++) {
+            int changed_count;
+            Point candidate = { engine.cx[q], engine.cy[q] };
+            assert(engine.score[q] - engine.current_score ==
+                vstate_score_move(&vs, &problem, points, p, candidate, changed, &changed_count));
+        }
+    }
+
+    // a relocation is no worse than staying, nor than any position of its line within the radius
+    for (int p = 0; p < N; p++) {
+        double radius = 8.0;
+        Point moved = move_engine_relocate(&engine, &problem, &vs, points, p, radius, &rng);
+        double dx = moved.x - points[p].x, dy = moved.y - points[p].y, length = sqrt(dx * dx + dy * dy);
+        assert(length > 0 && length <= radius);
+        int changed_count;
+        long long best = vstate_score_move(&vs, &problem, points, p, moved, changed, &changed_count);
+        assert(best <= 0);
+        for (int s = 0; s < 500; s++) {
+            double t = (2 * rng_double(&rng) - 1) * radius / length;
+            Point on_line = { points[p].x + t * dx, points[p].y + t * dy };
+            assert(vstate_score_move(&vs, &problem, points, p, on_line, changed, &changed_count) >= best);
+        }
+    }
+    free(changed);
+
+    free(points);
+    arena_free(&arena);
+    problem_free(&problem);
+    printf("move engine test PASSED\n");
+}
+
+// Test the rotation classes of an orbit index and orbit moves against full evaluations
+void test_orbit_index() {
+    printf("Testing orbit index...\n");
+    
+    rng_t rng;
+    rng_init(&rng, 11);
+    int N = 8;
+    int cycle_buffer[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    int* cycles[2] = {cycle_buffer, cycle_buffer + 4};
+    int cycle_lengths[2] = {4, 4};
+    Symmetry sym = {cycles, cycle_lengths, 2};
+    
+    // constraints of a 4-fold symmetric configuration, some of them stored in a non-sorted order
+    Point* points = malloc(N * sizeof(Point));
+    generate_random_assignment(N, points, &rng);
+    enforce_symmetry(&sym, points);
+    Problem problem;
+    problem.N = N;
+    problem.constraint_count = 0;
+    problem.constraints = malloc(56 * sizeof(Constraint));
+    for (int i = 1; i <= N; i++) {
+        for (int j = i + 1; j <= N; j++) {
+            for (int k = j + 1; k <= N; k++) {
+                int sign = det(points[i-1], points[j-1], points[k-1]) > 0 ? 1 : -1;
+                if (problem.constraint_count % 3 == 0) {
+                    problem.constraints[problem.constraint_count++] = (Constraint){j, i, k, -sign};
+                } else {
+                    problem.constraints[problem.constraint_count++] = (Constraint){i, j, k, sign};
+                }
+            }
+        }
+    }
+    problem_build_index(&problem);
+    
+    orbit_index_t orbits;
+    orbit_index_build(&orbits, &problem, &sym);
+    assert(orbits.num_orbits == 2);
+    assert(orbits.order == 4);
+    // no triple is invariant under a quarter turn, so every class has 4 constraints
+    assert(orbits.reps.constraint_count == 14);
+    int weight_sum = 0;
+    for (int c = 0; c < orbits.reps.constraint_count; c++) {
+        weight_sum += orbits.rep_weight[c];
+    }
+    assert(weight_sum == 56);
+    
+    // orbit moves keep the weighted state equal to the violations of the full problem
+    arena_t arena;
+    arena_init(&arena, vstate_bytes(N, orbits.reps.constraint_count) + 64);
+    violation_state_t vs;
+    vstate_init(&vs, N, orbits.reps.constraint_count, orbits.rep_weight, NULL, &arena);
+    int* changed = malloc(orbits.max_orbit_degree * sizeof(int));
+    Point* saved = malloc(orbits.max_orbit_size * sizeof(Point));
+    int* violations_per_point = malloc(N * sizeof(int));
+    generate_random_assignment(N, points, &rng);
+    enforce_symmetry(&sym, points);
+    vstate_rebuild(&vs, &orbits.reps, points);
+    
+    int total_violations, max_point;
+    double min_distance;
+    for (int t = 0; t < 500; t++) {
+        int orbit = (int)(rng_double(&rng) * orbits.num_orbits) % orbits.num_orbits;
+        Point lead = random_point_in_ball(points[orbit_point_members(&orbits, orbit)[0]], 3.0, &rng);
+        int changed_count;
+        int delta = orbit_score_move(&orbits, &vs, points, orbit, lead, saved, changed, &changed_count);
+        int before = vs.violated_weight;
+        if (delta <= 0 || t % 3 == 0) {
+            vstate_apply(&vs, &orbits.reps, changed, changed_count);
+            assert(vs.violated_weight == before + delta);
+        } else {
+            orbit_restore(&orbits, points, orbit, saved);
+        }
+        evaluate(points, &problem, 0.0, &total_violations, violations_per_point, &max_point, &min_distance, -1);
+        assert(total_violations == vs.violated_weight);
+    }
+    
+    free(changed);
+    free(saved);
+    free(violations_per_point);
+    free(points);
+    arena_free(&arena);
+    orbit_index_free(&orbits);
+    problem_free(&problem);
+    printf("orbit index test PASSED\n");
+}
+
+typedef struct {
+    synchronization_t* sync;
+    int seed;
+} elite_pool_test_t;
+
+// Publishes solutions whose points all encode their violations, and checks every copy read back.
+void* elite_pool_worker(void* arg) {
+    elite_pool_test_t* params = (elite_pool_test_t*)arg;
+    rng_t rng;
+    rng_init(&rng, params->seed);
+    int N = params->sync->N;
+    Point* points = malloc(N * sizeof(Point));
+    for (int t = 0; t < 2000; t++) {
+        int violations = 1 + (int)(rng_double(&rng) * 1000);
+        for (int p = 0; p < N; p++) {
+            points[p] = (Point){violations, -violations};
+        }
+        sync_broadcast_new_solution(params->sync, points, violations);
+        
+        int read;
+        sync_get_best_solution(params->sync, points, &read, &rng);
+        assert(read != INT32_MAX);
+        for (int p = 0; p < N; p++) {
+            assert(points[p].x == read && points[p].y == -read);
+        }
+    }
+    free(points);
+    return NULL;
+}
+
+// Test the elite pool: it keeps the K_TOP best solutions, and concurrent copies are never torn
+void test_elite_pool() {
+    printf("Testing elite pool...\n");
+    
+    int N = 64;
+    synchronization_t sync;
+    sync_init(&sync, N);
+    rng_t rng;
+    rng_init(&rng, 3);
+    
+    Point* points = malloc(N * sizeof(Point));
+    int violations;
+    sync_get_best_solution(&sync, points, &violations, &rng);
+    assert(violations == INT32_MAX);
+    
+    for (int v = 20; v >= 1; v--) {
+        for (int p = 0; p < N; p++) {
+            points[p] = (Point){v, -v};
+        }
+        sync_broadcast_new_solution(&sync, points, v);
+    }
+    // the pool holds 1..K_TOP, a worse solution is not taken
+    sync_broadcast_new_solution(&sync, points, K_TOP + 5);
+    bool present[K_TOP + 1] = {false};
+    for (int i = 0; i < K_TOP; i++) {
+        int v = atomic_load(&sync.elite[i].violations);
+        assert(v >= 1 && v <= K_TOP && !present[v]);
+        present[v] = true;
+    }
+    assert(sync_copy_best_solution(&sync, points) == 1);
+    assert(points[0].x == 1 && points[N-1].y == -1);
+    
+    assert(sync_set_stop(&sync));
+    assert(!sync_set_stop(&sync));
+    assert(sync_should_stop(&sync));
+    sync_destroy(&sync);
+    
+    // concurrent publishers and readers
+    sync_init(&sync, N);
+    pthread_t threads[4];
+    elite_pool_test_t params[4];
+    for (int i = 0; i < 4; i++) {
+        params[i] = (elite_pool_test_t){&sync, 100 + i};
+        pthread_create(&threads[i], NULL, elite_pool_worker, &params[i]);
+    }
+    for (int i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    printf("  %lld published, %lld contended\n", (long long)atomic_load(&sync.publications), (long long)atomic_load(&sync.contention));
+    sync_destroy(&sync);
+    
+    free(points);
+    printf("elite pool test PASSED\n");
+}
+
+// Test the batch scheduler, and a small batch end to end
+void test_batch() {
+    printf("Testing batch mode...\n");
+    
+    // a worker drains its own deque from the front, then steals from the back of the fullest one
+    int items[3][4] = { { 0, 3 }, { 1, 4, 6, 7 }, { 2, 5 } };
+    batch_deque_t deques[3];
+    for (int w = 0; w < 3; w++) {
+        pthread_mutex_init(&deques[w].lock, NULL);
+        deques[w].items = items[w];
+        deques[w].head = 0;
+        deques[w].tail = w == 1 ? 4 : 2;
+    }
+    batch_t batch = { .deques = deques, .num_workers = 3 };
+    atomic_init(&batch.steals, 0);
+    int expected[8] = { 0, 3, 7, 6, 4, 5, 1, 2 };
+    for (int t = 0; t < 8; t++) {
+        assert(batch_next_instance(&batch, 0) == expected[t]);
+    }
+    assert(batch_next_instance(&batch, 0) == -1);
+    assert(atomic_load(&batch.steals) == 6);
+    for (int w = 0; w < 3; w++) {
+        pthread_mutex_destroy(&deques[w].lock);
+    }
+    
+    // realizable instances are solved and saved next to their files, and an invalid one only fails itself
+    char dir[] = "/tmp/localizer_batch_XXXXXX";
+    assert(mkdtemp(dir) != NULL);
+    rng_t rng;
+    rng_init(&rng, 17);
+    int count = 3;
+    char* paths[4];
+    for (int i = 0; i < count; i++) {
+        Problem problem;
+        make_random_problem(&problem, 6 + i, &rng);
+        paths[i] = malloc(strlen(dir) + 16);
+        sprintf(paths[i], "%s/%d.orb", dir, i);
+        write_binary_orientations(&problem, paths[i]);
+        problem_free(&problem);
+    }
+    paths[count] = malloc(strlen(dir) + 16);
+    sprintf(paths[count], "%s/invalid.or", dir);
+    FILE* invalid = fopen(paths[count], "w");
+    fprintf(invalid, "A_(1, 2, 3)\nB_(0, 2, 3)\n");
+    fclose(invalid);
+    solver_config_t config = solver_config_default();
+    config.time_limit = 20;
+    config.quiet = true;
+    char summary[64];
+    sprintf(summary, "%s/summary.json", dir);
+    assert(run_batch(paths, count + 1, 2, &config, "", "", 42, PRECHECK_ON, summary) == count);
+    FILE* file = fopen(summary, "r");
+    char text[4096];
+    size_t length = fread(text, 1, sizeof(text) - 1, file);
+    text[length] = '\0';
+    fclose(file);
+    assert(strstr(text, "\"failed\": 1,") != NULL && strstr(text, "\"error\": \"invalid point index\"") != NULL);
+    unlink(paths[count]);
+    free(paths[count]);
+    for (int i = 0; i < count; i++) {
+        char* output = batch_output_path(paths[i]);
+        assert(access(output, F_OK) == 0);
+        unlink(output);
+        unlink(paths[i]);
+        free(output);
+        free(paths[i]);
+    }
+    assert(access(summary, F_OK) == 0);
+    unlink(summary);
+    rmdir(dir);
+    
+    printf("batch mode test PASSED\n");
+}
+
+// Test portfolio files and the built-in portfolio
+void test_portfolio() {
+    printf("Testing portfolios...\n");
+    
+    solver_config_t base = solver_config_default();
+    base.sub_iterations = 7;
+    base.min_dist = 0.5;
+    
+    char path[] = "/tmp/localizer_portfolio_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    FILE* file = fdopen(fd, "w");
+    fprintf(file, "# comment line\n");
+    fprintf(file, "final_radius=30 min_radius=0.01\n");
+    fprintf(file, "\n");
+    fprintf(file, "reset_its=1000 reset_multiplier=1.5 candidates=4 # trailing comment\n");
+    fprintf(file, "engine=hybrid relocate=0.25 restart=crossover restart_schedule=luby\n");
+    fclose(file);
+    
+    portfolio_t portfolio;
+    parse_portfolio(path, &base, &portfolio);
+    unlink(path);
+    assert(portfolio.count == 4);
+    for (int e = 0; e < portfolio.count; e++) {
+        // keys left out keep the base values
+        assert(portfolio.configs[e].portfolio_entry == e);
+        assert(portfolio.configs[e].min_dist == 0.5);
+    }
+    assert(portfolio.configs[0].sub_iterations == 7 && portfolio.configs[0].final_radius == FINAL_RADIUS);
+    assert(portfolio.configs[1].final_radius == 30 && portfolio.configs[1].min_radius == 0.01);
+    assert(portfolio.configs[1].sub_iterations == 7 && portfolio.configs[1].reset_its == base.reset_its);
+    assert(portfolio.configs[2].reset_its == 1000 && portfolio.configs[2].reset_multiplier == 1.5);
+    assert(portfolio.configs[2].num_candidates == 4 && portfolio.configs[2].final_radius == FINAL_RADIUS);
+    assert(portfolio.configs[2].engine == ENGINE_LOCAL && portfolio.configs[3].engine == ENGINE_HYBRID);
+    assert(portfolio.configs[2].relocate == 0 && portfolio.configs[3].relocate == 0.25);
+    assert(portfolio.configs[2].restart == RESTART_ELITE && portfolio.configs[3].restart == RESTART_CROSSOVER);
+    assert(portfolio.configs[3].restart_schedule == SCHEDULE_LUBY);
+    portfolio_free(&portfolio);
+    
+    // the built-in portfolio starts with the base configuration, and its entries differ
+    portfolio_default(&base, &portfolio);
+    assert(portfolio.count > 1);
+    char first[256], other[256];
+    solver_config_describe(&portfolio.configs[0], first, sizeof(first));
+    solver_config_describe(&base, other, sizeof(other));
+    assert(strcmp(first, other) == 0);
+    for (int e = 1; e < portfolio.count; e++) {
+        solver_config_describe(&portfolio.configs[e], other, sizeof(other));
+        assert(strcmp(first, other) != 0);
+    }
+    portfolio_free(&portfolio);
+    
+    printf("portfolio test PASSED\n");
+}
+
+// Test that the search counters of a solve add up, and that snapshots are written
+void test_search_stats() {
+    printf("Testing search statistics...\n");
+#if SEARCH_STATS
+    rng_t rng;
+    rng_init(&rng, 23);
+    Problem problem;
+    make_random_problem(&problem, 9, &rng);
+    solver_config_t config = solver_config_default();
+    config.reset_its = 50;
+    config.time_limit = 20;
+    config.quiet = true;
+    arena_t arena;
+    arena_init(&arena, solver_workspace_bytes(&problem, &config, NULL));
+    synchronization_t sync;
+    sync_init(&sync, problem.N);
+    bool* is_point_fixed = calloc(problem.N, sizeof(bool));
+    Point* fixed_points = calloc(problem.N, sizeof(Point));
+    Point* points = calloc(problem.N, sizeof(Point));
+    Symmetry symmetry = { NULL, NULL, 0 };
+    
+    search_stats_t stats;
+    stats_init(&stats);
+    solve_result_t result = solve(&problem, &config, points, "/dev/null", 1, &sync, &rng, &arena,
+        is_point_fixed, fixed_points, &symmetry, NULL, &stats, NULL);
+    assert(result.solved);
+    long long sub_iterations = stat_load(&stats.sub_iterations);
+    assert(sub_iterations > 0 && sub_iterations <= result.iterations * config.sub_iterations);
+    assert(stat_load(&stats.accepted_moves) + stat_load(&stats.rejected_moves) == sub_iterations);
+    assert(stat_load(&stats.improving_moves) <= stat_load(&stats.accepted_moves));
+    assert(stat_load(&stats.publishes) == stat_load(&stats.improving_moves));
+    assert(stat_load(&stats.resets) == stat_load(&stats.random_move_tests));
+    assert(stat_load(&stats.fetches) == stat_load(&stats.resets));
+    assert(stat_load(&stats.evaluated_constraints) >= sub_iterations * (problem.N - 1) * (problem.N - 2) / 2);
+    long long phase_ns = 0;
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        assert(stat_load(&stats.phase_ns[p]) >= 0);
+        phase_ns += stat_load(&stats.phase_ns[p]);
+    }
+    // every moment of the call is charged to one phase
+    assert(phase_ns > 0 && phase_ns / 1e9 >= result.seconds);
+    
+    // the stream ends with the final snapshot
+    char path[] = "/tmp/localizer_stats_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+    stats_stream_t stream;
+    stats_stream_start(&stream, path, &stats, 1, 0.05);
+    struct timespec pause = { 0, 200 * 1000000 };
+    nanosleep(&pause, NULL);
+    stats_stream_finish(&stream);
+    stats_stream_destroy(&stream);
+    FILE* file = fopen(path, "r");
+    char line[4096];
+    int lines = 0;
+    bool final = false;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        lines++;
+        final = strstr(line, "\"final\": true") != NULL;
+        assert(strstr(line, "\"sub_iterations\"") != NULL);
+    }
+    fclose(file);
+    unlink(path);
+    assert(lines >= 2 && final);
+    
+    free(points);
+    free(fixed_points);
+    free(is_point_fixed);
+    sync_destroy(&sync);
+    arena_free(&arena);
+    problem_free(&problem);
+    printf("search statistics test PASSED\n");
+#else
+    printf("search statistics test skipped (STATS=0)\n");
+#endif
+}
+
+// Test that generated instances are the chirotopes of their point sets, from specs and files alike
+void test_generator() {
+    printf("Testing the instance generator...\n");
+    
+    int N = 12;
+    Point* points = malloc(N * sizeof(Point));
+    for (int d = 0; d < POINTS_DISTRIBUTION_COUNT; d++) {
+        rng_t rng;
+        rng_init(&rng, 5 + d);
+        Problem problem;
+        do {
+            generate_point_set(points, N, d, &rng);
+        } while (!chirotope_of_points(points, N, &problem));
+        // complete, in lexicographic order, with the exact signs of the points
+        assert(problem.complete && !problem.colex);
+        assert(problem.constraint_count == N * (N - 1) * (N - 2) / 6);
+        for (int c = 0; c < problem.constraint_count; c++) {
+            const Constraint* constraint = &problem.constraints[c];
+            assert(constraint->sign == orient2d_sign(points[constraint->i - 1], points[constraint->j - 1], points[constraint->k - 1]));
+            assert(constraint->sign == chirotope_sign(&problem, c));
+        }
+        problem_free(&problem);
+    }
+    free(points);
+    
+    // a spec generates the same instance as generate_problem, and a text file reads back to it
+    Problem generated, from_spec, from_file;
+    generate_problem(&generated, 15, POINTS_CLUSTERED, 9);
+    load_orientations("gen:15:clustered:9", &from_spec);
+    char path[] = "/tmp/localizer_generated_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+    write_text_orientations(&generated, path);
+    load_orientations(path, &from_file);
+    unlink(path);
+    assert(from_spec.constraint_count == generated.constraint_count && from_file.constraint_count == generated.constraint_count);
+    for (int c = 0; c < generated.constraint_count; c++) {
+        assert(memcmp(&from_spec.constraints[c], &generated.constraints[c], sizeof(Constraint)) == 0);
+        assert(memcmp(&from_file.constraints[c], &generated.constraints[c], sizeof(Constraint)) == 0);
+    }
+    problem_free(&generated);
+    problem_free(&from_spec);
+    problem_free(&from_file);
+    
+    // defaults: uniform, seed 1
+    load_orientations("gen:8", &from_spec);
+    generate_problem(&generated, 8, POINTS_UNIFORM, 1);
+    for (int c = 0; c < generated.constraint_count; c++) {
+        assert(from_spec.constraints[c].sign == generated.constraints[c].sign);
+    }
+    problem_free(&generated);
+    problem_free(&from_spec);
+    assert(parse_distribution("convex") == POINTS_CONVEX && parse_distribution("round") == -1);
+    
+    printf("instance generator test PASSED\n");
+}
+
+void test_checkpoint() {
+    printf("Testing checkpoints...\n");
+    
+    Problem problem;
+    generate_problem(&problem, 9, POINTS_UNIFORM, 4);
+    int N = problem.N;
+    solver_config_t config = solver_config_default();
+    config.reset_its = 50;
+    config.time_limit = 20;
+    config.quiet = true;
+    arena_t arena;
+    arena_init(&arena, solver_workspace_bytes(&problem, &config, NULL));
+    bool* is_point_fixed = calloc(N, sizeof(bool));
+    Point* fixed_points = calloc(N, sizeof(Point));
+    Point* solution = calloc(N, sizeof(Point));
+    Symmetry symmetry = { NULL, NULL, 0 };
+    
+    // a solved search, whose thread state is published
+    synchronization_t sync;
+    sync_init(&sync, N);
+    checkpoint_t checkpoint;
+    checkpoint_init(&checkpoint, &problem, 2, &sync);
+    checkpoint.configs[0] = config;
+    checkpoint.configs[1].num_candidates = 4;
+    checkpoint.configs[1].restart = RESTART_PARTIAL;
+    checkpoint.configs[1].restart_schedule = SCHEDULE_LUBY;
+    rng_t rng;
+    rng_init(&rng, 3);
+    solve_result_t result = solve(&problem, &config, solution, "/dev/null", 1, &sync, &rng, &arena,
+        is_point_fixed, fixed_points, &symmetry, NULL, NULL, &checkpoint.states[0]);
+    assert(result.solved && checkpoint.states[0].valid && !checkpoint.states[1].valid);
+    assert(checkpoint.states[0].weight_count == problem.constraint_count && checkpoint.states[1].weight_count == 0);
+    for (int c = 0; c < problem.constraint_count; c++) {
+        checkpoint.states[0].search_weight[c] = 1 + c % 5; // as after some bumps
+    }
+    sync_broadcast_new_solution(&sync, solution, 0);
+    atomic_store(&sync.restarts, 37);
+    
+    char path[] = "/tmp/localizer_checkpoint_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+    checkpoint_start(&checkpoint, path, 1000);
+    assert(checkpoint_save(&checkpoint) && checkpoint.written == 1);
+    checkpoint_stop(&checkpoint);
+    
+    // everything reads back, and only the published thread state resumes
+    synchronization_t restored_sync;
+    sync_init(&restored_sync, N);
+    checkpoint_t restored;
+    checkpoint_load(&restored, path, &problem, &restored_sync);
+    unlink(path);
+    assert(restored.num_threads == 2 && atomic_load(&restored_sync.restarts) == 37);
+    assert(restored.configs[0].reset_its == 50 && restored.configs[1].num_candidates == 4);
+    assert(restored.configs[0].restart == RESTART_ELITE && restored.configs[1].restart == RESTART_PARTIAL);
+    assert(restored.configs[1].restart_schedule == SCHEDULE_LUBY);
+    assert(restored.states[0].resume && !restored.states[1].resume);
+    thread_state_t* saved = &checkpoint.states[0];
+    thread_state_t* state = &restored.states[0];
+    assert(state->iterations == saved->iterations && state->reset_its == saved->reset_its);
+    assert(state->its_since_checkpoint == saved->its_since_checkpoint && state->violations == saved->violations);
+    assert(memcmp(state->rng.s, saved->rng.s, sizeof(saved->rng.s)) == 0);
+    assert(memcmp(state->points, saved->points, N * sizeof(Point)) == 0);
+    assert(state->weight_count == saved->weight_count && restored.states[1].weight_count == 0);
+    assert(memcmp(state->search_weight, saved->search_weight, saved->weight_count * sizeof(uint16_t)) == 0);
+    Point* best = calloc(N, sizeof(Point));
+    for (int e = 0; e < K_TOP; e++) {
+        assert(sync_read_slot(&restored_sync, e, best) == sync_read_slot(&sync, e, checkpoint.elite_points));
+        assert(memcmp(best, checkpoint.elite_points, N * sizeof(Point)) == 0);
+    }
+    assert(sync_copy_best_solution(&restored_sync, best) == 0);
+    
+    // a resumed search goes on from the saved iteration: from a solution, it stops right there
+    memcpy(state->points, solution, N * sizeof(Point));
+    state->iterations = 7000;
+    result = solve(&problem, &restored.configs[0], best, "/dev/null", 1, &restored_sync, &rng, &arena,
+        is_point_fixed, fixed_points, &symmetry, NULL, NULL, state);
+    assert(result.solved && result.iterations == 7000 && !state->resume);
+    
+    checkpoint_free(&checkpoint);
+    checkpoint_free(&restored);
+    sync_destroy(&sync);
+    sync_destroy(&restored_sync);
+    arena_free(&arena);
+    problem_free(&problem);
+    free(is_point_fixed);
+    free(fixed_points);
+    free(solution);
+    free(best);
+    
+    printf("checkpoint test PASSED\n");
+}
+
+void test_monitor() {
+    printf("Testing best-solution snapshots...\n");
+    
+    int N = 5;
+    synchronization_t sync;
+    sync_init(&sync, N);
+    Point points[5] = { { 1, 2 }, { 3, 4 }, { 5, 6 }, { 7, 8 }, { 9, 10 } };
+    char path[] = "/tmp/localizer_snapshot_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+    
+    monitor_t monitor;
+    monitor_init(&monitor, &sync, N);
+    monitor.snapshot_path = path;
+    monitor_start(&monitor);
+    struct timespec pause = { 0, 150 * 1000000 };
+    nanosleep(&pause, NULL);
+    // nothing is written while the pool is empty
+    assert(monitor.snapshots == 0);
+    sync_broadcast_new_solution(&sync, points, 4);
+    nanosleep(&pause, NULL);
+    assert(monitor.snapshots == 1);
+    points[0].x = -1;
+    sync_broadcast_new_solution(&sync, points, 2);
+    monitor_stop(&monitor);
+    assert(monitor.snapshots == 2 && monitor.snapshot_violations == 2);
+    assert(atomic_load(&monitor.interrupted) == 0 && !sync_should_stop(&sync));
+    
+    FILE* file = fopen(path, "r");
+    char line[1024];
+    assert(fgets(line, sizeof(line), file) != NULL);
+    fclose(file);
+    unlink(path);
+    assert(strstr(line, "\"violations\": 2, \"points\": [[-1.00000000, 2.00000000], [3.00000000, 4.00000000]") != NULL);
+    
+    // an interrupt only raises the stop flag, and leaves the process running
+    monitor_free(&monitor);
+    monitor_block_signals();
+    monitor_init(&monitor, &sync, N);
+    monitor_start(&monitor);
+    pthread_kill(monitor.thread, SIGTERM);
+    nanosleep(&pause, NULL);
+    monitor_stop(&monitor);
+    assert(atomic_load(&monitor.interrupted) == SIGTERM && sync_should_stop(&sync));
+    
+    monitor_free(&monitor);
+    sync_destroy(&sync);
+    
+    printf("snapshot test PASSED\n");
+}
+
+void test_budget() {
+    printf("Testing search budgets...\n");
+    
+    Problem problem;
+    generate_problem(&problem, 40, POINTS_UNIFORM, 2);
+    int N = problem.N;
+    solver_config_t config = solver_config_default();
+    config.max_iterations = 500;
+    config.quiet = true;
+    arena_t arena;
+    arena_init(&arena, solver_workspace_bytes(&problem, &config, NULL));
+    synchronization_t sync;
+    sync_init(&sync, N);
+    bool* is_point_fixed = calloc(N, sizeof(bool));
+    Point* fixed_points = calloc(N, sizeof(Point));
+    Point* points = calloc(N, sizeof(Point));
+    Symmetry symmetry = { NULL, NULL, 0 };
+    rng_t rng;
+    rng_init(&rng, 8);
+    
+    // far too few iterations for 40 points: the call stops exactly at the budget
+    solve_result_t result = solve(&problem, &config, points, "/dev/null", 1, &sync, &rng, &arena,
+        is_point_fixed, fixed_points, &symmetry, NULL, NULL, NULL);
+    assert(!result.solved && result.iterations == 500);
+    assert(sync_best_violations(&sync) > 0 && sync_best_violations(&sync) < INT32_MAX);
+    
+    config.max_iterations = 0;
+    config.time_limit = 0.05;
+    result = solve(&problem, &config, points, "/dev/null", 1, &sync, &rng, &arena,
+        is_point_fixed, fixed_points, &symmetry, NULL, NULL, NULL);
+    assert(!result.solved && result.seconds >= 0.05 && result.seconds < 1);
+    
+    sync_destroy(&sync);
+    arena_free(&arena);
+    problem_free(&problem);
+    free(is_point_fixed);
+    free(fixed_points);
+    free(points);
+    
+    printf("search budget test PASSED\n");
+}
+
+void test_multilevel() {
+    printf("Testing multilevel solving...\n");
+    
+    // the prefix of a complete chirotope is the complete chirotope of the first points
+    Problem problem, prefix;
+    generate_problem(&problem, 12, POINTS_UNIFORM, 6);
+    problem_prefix(&problem, 7, &prefix);
+    assert(prefix.N == 7 && prefix.constraint_count == 35 && prefix.complete);
+    for (int c = 0; c < prefix.constraint_count; c++) {
+        const Constraint* constraint = &prefix.constraints[c];
+        assert(constraint->k <= 7);
+        assert(chirotope_sign(&prefix, c) == chirotope_sign(&problem, triple_rank(&problem,
+            constraint->i - 1, constraint->j - 1, constraint->k - 1)));
+    }
+    problem_free(&prefix);
+    problem_free(&problem);
+    
+    // levels of 8, 11, 14, ... 20 points, the last one saved
+    generate_problem(&problem, 20, POINTS_CLUSTERED, 3);
+    int N = problem.N;
+    solver_config_t config = solver_config_default();
+    config.time_limit = 20;
+    config.quiet = true;
+    bool* is_point_fixed = calloc(N, sizeof(bool));
+    Point* fixed_points = calloc(N, sizeof(Point));
+    synchronization_t sync;
+    sync_init(&sync, N);
+    char path[] = "/tmp/localizer_multilevel_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+    assert(multilevel_solve(&problem, &config, 1, 2, 8, 3, is_point_fixed, fixed_points, &sync, path, 5, NULL));
+    assert(sync_should_stop(&sync));
+    FILE* file = fopen(path, "r");
+    char line[256];
+    int lines = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        lines++;
+    }
+    fclose(file);
+    unlink(path);
+    assert(lines == N);
+    
+    sync_destroy(&sync);
+    problem_free(&problem);
+    free(is_point_fixed);
+    free(fixed_points);
+    
+    printf("multilevel test PASSED\n");
+}
+
+void test_penalty() {
+    printf("Testing the penalty engine...\n");
+    
+    Problem problem;
+    generate_problem(&problem, 12, POINTS_UNIFORM, 4);
+    int N = problem.N;
+    bool* frozen = calloc(N, sizeof(bool));
+    Point* points = calloc(N, sizeof(Point));
+    rng_t rng;
+    rng_init(&rng, 12);
+    
+    // the gradient matches central differences of the penalty
+    double* v = calloc(2 * N, sizeof(double));
+    double* gradient = malloc(2 * N * sizeof(double));
+    double* scratch = malloc(2 * N * sizeof(double));
+    for (int i = 0; i < 2 * N; i++) {
+        v[i] = 10 * rng_double(&rng);
+    }
+    penalty_value(&problem.columns, problem.constraint_count, N, frozen, v, gradient);
+    for (int i = 0; i < 2 * N; i++) {
+        double h = 1e-6, saved = v[i];
+        v[i] = saved + h;
+        double above = penalty_value(&problem.columns, problem.constraint_count, N, frozen, v, scratch);
+        v[i] = saved - h;
+        double below = penalty_value(&problem.columns, problem.constraint_count, N, frozen, v, scratch);
+        v[i] = saved;
+        assert(fabs((above - below) / (2 * h) - gradient[i]) < 1e-4 * fmax(1, fabs(gradient[i])));
+    }
+    // frozen points get no gradient
+    frozen[3] = true;
+    penalty_value(&problem.columns, problem.constraint_count, N, frozen, v, gradient);
+    assert(gradient[3] == 0 && gradient[N + 3] == 0);
+    
+    // a run from random points lowers the penalty and leaves the frozen point in place
+    arena_t arena;
+    arena_init(&arena, penalty_workspace_bytes(N));
+    penalty_workspace_t ws;
+    penalty_workspace_init(&ws, N, &arena);
+    for (int p = 0; p < N; p++) {
+        points[p] = (Point){ v[p], v[N + p] };
+    }
+    Point frozen_point = points[3];
+    double before = penalty_value(&problem.columns, problem.constraint_count, N, frozen, v, gradient);
+    double after = penalty_minimize(&ws, &problem, frozen, points, PENALTY_ITERATIONS);
+    assert(after < before);
+    assert(points[3].x == frozen_point.x && points[3].y == frozen_point.y);
+    arena_free(&arena);
+    
+    // both engines solve a small instance
+    assert(engine_parse("hybrid") == ENGINE_HYBRID && engine_parse("simplex") == -1);
+    bool* is_point_fixed = calloc(N, sizeof(bool));
+    Symmetry symmetry = { NULL, NULL, 0 };
+    for (int engine = ENGINE_HYBRID; engine <= ENGINE_PENALTY; engine++) {
+        solver_config_t config = solver_config_default();
+        config.engine = engine;
+        config.time_limit = 20;
+        config.quiet = true;
+        arena_init(&arena, solver_workspace_bytes(&problem, &config, NULL));
+        synchronization_t sync;
+        sync_init(&sync, N);
+        solve_result_t result = solve(&problem, &config, points, "/dev/null", 1, &sync, &rng, &arena,
+            is_point_fixed, points, &symmetry, NULL, NULL, NULL);
+        assert(result.solved);
+        sync_destroy(&sync);
+        arena_free(&arena);
+    }
+    
+    problem_free(&problem);
+    free(frozen);
+    free(points);
+    free(v);
+    free(gradient);
+    free(scratch);
+    free(is_point_fixed);
+    
+    printf("penalty engine test PASSED\n");
+}
+
+// A problem over the given signs of the triples listed as (i, j, k), 1-based.
+static void precheck_test_problem(Problem* problem, const int (*triples)[4], int count) {
+    problem->N = 0;
+    problem->constraint_count = count;
+    problem->constraints = malloc(count * sizeof(Constraint));
+    for (int c = 0; c < count; c++) {
+        problem->constraints[c] = (Constraint){ triples[c][0], triples[c][1], triples[c][2], triples[c][3] };
+        for (int t = 0; t < 3; t++) {
+            problem->N = triples[c][t] > problem->N ? triples[c][t] : problem->N;
+        }
+    }
+    problem_build_index(problem);
+}
+
+void test_precheck() {
+    printf("Testing chirotope pre-check...\n");
+    precheck_result_t result, enumerated;
+    
+    // realizable: generated, and with collinear triples (a 3 x 3 grid, complete but not uniform)
+    Problem problem;
+    generate_problem(&problem, 12, POINTS_UNIFORM, 4);
+    assert(precheck_run(&problem, 2, false, &result) && result.checked_four && result.checked_five);
+    assert(precheck_problem(&problem, 1, false, false, &result));
+    problem_free(&problem);
+    Point grid[9];
+    int triples[84][4], count = 0;
+    for (int p = 0; p < 9; p++) {
+        grid[p] = (Point){ p % 3, p / 3 };
+    }
+    for (int i = 0; i < 9; i++) {
+        for (int j = i + 1; j < 9; j++) {
+            for (int k = j + 1; k < 9; k++) {
+                double d = det(grid[i], grid[j], grid[k]);
+                triples[count][0] = i + 1;
+                triples[count][1] = j + 1;
+                triples[count][2] = k + 1;
+                triples[count++][3] = (d > 0) - (d < 0);
+            }
+        }
+    }
+    precheck_test_problem(&problem, triples, count);
+    assert(problem.complete && precheck_run(&problem, 2, true, &result));
+    problem_free(&problem);
+    
+    // alternation: a triple given twice with inconsistent signs, a repeated point with a nonzero sign
+    int twice[2][4] = { { 1, 2, 3, 1 }, { 2, 1, 3, 1 } };
+    precheck_test_problem(&problem, twice, 2);
+    assert(!precheck_run(&problem, 1, false, &result));
+    assert(strcmp(result.axiom, "alternation") == 0 && result.point_count == 3 && result.points[0] == 1 && result.points[2] == 3);
+    problem_free(&problem);
+    int repeated[2][4] = { { 1, 2, 3, 1 }, { 1, 3, 1, -1 } };
+    precheck_test_problem(&problem, repeated, 2);
+    assert(!precheck_run(&problem, 1, false, &result) && strcmp(result.axiom, "alternation") == 0);
+    problem_free(&problem);
+    
+    // 4 points with det(234), -det(134), det(124), -det(123) all positive
+    int cycle[4][4] = { { 1, 2, 3, -1 }, { 1, 2, 4, 1 }, { 1, 3, 4, -1 }, { 2, 3, 4, 1 } };
+    precheck_test_problem(&problem, cycle, 4);
+    assert(!precheck_run(&problem, 1, false, &result) && result.axiom[0] == '4' && result.point_count == 4);
+    problem_free(&problem);
+    
+    // flipping one sign of a realizable chirotope: the contractions and the enumeration of the 5-point
+    // subsets reach the same verdict
+    generate_problem(&problem, 9, POINTS_UNIFORM, 11);
+    int rejected = 0, by_relations = 0;
+    for (int c = 0; c < problem.constraint_count; c++) {
+        problem.constraints[c].sign = -problem.constraints[c].sign;
+        bool feasible = precheck_problem(&problem, 2, false, true, &result);
+        assert(feasible == precheck_problem(&problem, 1, false, false, &enumerated));
+        if (!feasible) {
+            rejected++;
+            assert(strcmp(result.axiom, enumerated.axiom) == 0);
+            by_relations += result.axiom[0] == '5';
+        }
+        problem.constraints[c].sign = -problem.constraints[c].sign;
+    }
+    assert(rejected > 0 && rejected < problem.constraint_count && by_relations > 0);
+    problem_free(&problem);
+    
+    printf("chirotope pre-check test PASSED\n");
+}
+
+// Test the restart schedules, and that the restart strategies keep the incremental state exact
+void test_restart() {
+    printf("Testing restarts...\n");
+    
+    long long expected[] = { 1, 1, 2, 1, 1, 2, 4, 1, 1, 2, 1, 1, 2, 4, 8 };
+    for (int i = 0; i < 15; i++) {
+        assert(luby(i + 1) == expected[i]);
+    }
+    assert(restart_interval(SCHEDULE_FIXED, 1000, 1.0, 1500, 7) == 1500);
+    assert(restart_interval(SCHEDULE_FIXED, 1000, 2.0, 1500, 7) == 3000);
+    assert(restart_interval(SCHEDULE_GEOMETRIC, 1000, 2.0, 1500, 2) == 8000);
+    assert(restart_interval(SCHEDULE_LUBY, 1000, 2.0, 1500, 6) == 4000);
+    assert(restart_interval(SCHEDULE_LUBY, 1, 1.0, 1, 0) == 2 && restart_interval(SCHEDULE_GEOMETRIC, 1, 0.5, 1, 3) == 2);
+    assert(restart_parse("crossover") == RESTART_CROSSOVER && restart_parse("full") == -1);
+    assert(schedule_parse("luby") == SCHEDULE_LUBY && schedule_parse("linear") == -1);
+    
+    rng_t rng;
+    rng_init(&rng, 24);
+    int N = 14;
+    Point* solution = malloc(N * sizeof(Point));
+    Problem problem;
+    do {
+        generate_point_set(solution, N, POINTS_UNIFORM, &rng);
+    } while (!chirotope_of_points(solution, N, &problem));
+    arena_t arena;
+    arena_init(&arena, vstate_bytes(N, problem.constraint_count) + restart_workspace_bytes(N));
+    violation_state_t vs;
+    vstate_init(&vs, N, problem.constraint_count, NULL, NULL, &arena);
+    restart_workspace_t ws;
+    restart_workspace_init(&ws, N, &arena);
+    bool* frozen = calloc(N, sizeof(bool));
+    int* changed = malloc(problem_max_degree(&problem) * sizeof(int));
+    Point* points = malloc(N * sizeof(Point));
+    Point* before = malloc(N * sizeof(Point));
+    
+    // a partial restart moves only points with violations, never a frozen one, and leaves the
+    // incremental state equal to a full evaluation
+    for (int round = 0; round < 20; round++) {
+        generate_random_assignment(N, points, &rng);
+        frozen[round % N] = true;
+        vstate_rebuild(&vs, &problem, points);
+        memcpy(before, points, N * sizeof(Point));
+        int violating = 0;
+        for (int p = 0; p < N; p++) {
+            violating += vs.violations_per_point[p] > 0;
+        }
+        restart_partial(&ws, &vs, &problem, points, frozen, changed, &rng);
+        int moved = 0;
+        for (int p = 0; p < N; p++) {
+            if (points[p].x != before[p].x || points[p].y != before[p].y) {
+                moved++;
+                assert(!frozen[p]);
+            }
+        }
+        assert(moved <= (int)ceil(violating * RESTART_PARTIAL_FRACTION));
+        assert(vs.violated_weight == vstate_count_violations(&vs, &problem, points));
+        frozen[round % N] = false;
+    }
+    
+    // in a search, partial restarts and crossovers without a second solution move the points taken
+    // from the pool, with the statistics compiled in or out
+    {
+        solver_config_t config = solver_config_default();
+        arena_t solve_arena;
+        arena_init(&solve_arena, solver_workspace_bytes(&problem, &config, NULL));
+        solver_workspace_t sws;
+        solver_workspace_init(&sws, &problem, &config, NULL, frozen, &solve_arena);
+        Symmetry symmetry = { NULL, NULL, 0 };
+        synchronization_t sync;
+        sync_init(&sync, N);
+        generate_random_assignment(N, points, &rng);
+        sync_broadcast_new_solution(&sync, points, vstate_count_violations(&sws.vs, &problem, points));
+        search_stats_t stats;
+        stats_init(&stats);
+        phase_clock_t clock;
+        STATS_CLOCK_START(&clock, PHASE_OTHER);
+        for (int strategy = RESTART_PARTIAL; strategy <= RESTART_CROSSOVER; strategy++) {
+            reset(points, N, &sync, &rng, frozen, solution, &symmetry);
+            double min_distance = 1.0;
+            int violations = full_evaluation(&sws.vs, &problem, points, -1, &min_distance);
+            assert(violations > 0);
+            memcpy(before, points, N * sizeof(Point));
+            assert(restart_perturb(strategy, &sws, &problem, points, &violations, &sync, &rng, frozen, &symmetry,
+                &stats, &clock) == RESTART_PARTIAL);
+            assert(memcmp(before, points, N * sizeof(Point)) != 0);
+        }
+        sync_destroy(&sync);
+        arena_free(&solve_arena);
+    }
+    
+    // an affine image of a solution, with a positive determinant, aligns back onto it: every
+    // crossover child is then a solution
+    Point* other = malloc(N * sizeof(Point));
+    for (int p = 0; p < N; p++) {
+        other[p] = (Point){ 3 * solution[p].x - solution[p].y + 7, 0.5 * solution[p].x + 2 * solution[p].y - 4 };
+    }
+    memcpy(points, solution, N * sizeof(Point));
+    assert(restart_crossover(&ws, &vs, &problem, points, other, frozen, &rng) == 0);
+    assert(vstate_count_violations(&vs, &problem, points) == 0);
+    for (int p = 0; p < N; p++) {
+        assert(fabs(points[p].x - solution[p].x) < 1e-9 && fabs(points[p].y - solution[p].y) < 1e-9);
+    }
+    // a mirror image reverses every orientation and is refused
+    for (int p = 0; p < N; p++) {
+        other[p] = (Point){ -solution[p].x, solution[p].y };
+    }
+    assert(restart_crossover(&ws, &vs, &problem, points, other, frozen, &rng) == -1);
+    
+    // with two unrelated point sets, the violations returned are those of the child kept
+    generate_random_assignment(N, other, &rng);
+    memcpy(points, solution, N * sizeof(Point));
+    int violations = restart_crossover(&ws, &vs, &problem, points, other, frozen, &rng);
+    if (violations >= 0) {
+        assert(violations == vstate_count_violations(&vs, &problem, points));
+    }
+    
+    // a search restarting often logs one line per attempt, the last one ending with the solution
+    for (int strategy = RESTART_ELITE; strategy <= RESTART_CROSSOVER; strategy++) {
+        solver_config_t config = solver_config_default();
+        config.reset_its = 5;
+        config.restart = strategy;
+        config.restart_schedule = SCHEDULE_LUBY;
+        config.time_limit = 20;
+        config.quiet = true;
+        arena_t solve_arena;
+        arena_init(&solve_arena, solver_workspace_bytes(&problem, &config, NULL));
+        Symmetry symmetry = { NULL, NULL, 0 };
+        synchronization_t sync;
+        sync_init(&sync, N);
+        sync.restart_log = tmpfile();
+        assert(sync.restart_log != NULL);
+        solve_result_t result = solve(&problem, &config, points, "/dev/null", 1, &sync, &rng, &solve_arena,
+            frozen, solution, &symmetry, NULL, NULL, NULL);
+        assert(result.solved);
+        sync_flush_restart_log(&sync);
+        rewind(sync.restart_log);
+        char line[512];
+        int lines = 0;
+        bool solved = false;
+        while (fgets(line, sizeof(line), sync.restart_log) != NULL) {
+            lines++;
+            assert(strstr(line, "\"thread\": 1,") != NULL);
+            solved = strstr(line, "\"end\": \"solved\"") != NULL;
+        }
+        assert(lines > 0 && lines == atomic_load(&sync.restarts) && solved);
+        fclose(sync.restart_log);
+        sync_destroy(&sync);
+        arena_free(&solve_arena);
+    }
+    
+    free(solution);
+    free(other);
+    free(points);
+    free(before);
+    free(frozen);
+    free(changed);
+    arena_free(&arena);
+    problem_free(&problem);
+    printf("restart test PASSED\n");
+}
+
 int main() {
     printf("Starting solver tests\n");
     
@@ -299,8 +1918,30 @@ int main() {
     test_det();
     test_rotate();
     test_sample_proportional();
+    test_fenwick_sampler();
+    test_orientation_predicate();
     test_rotate_r_k();
     test_enforce_symmetry();
+    test_problem_index();
+    test_complete_chirotope();
+    test_binary_format();
+    test_violation_state();
+    test_adaptive_weights();
+    test_eval_kernels();
+    test_move_engine();
+    test_orbit_index();
+    test_elite_pool();
+    test_batch();
+    test_portfolio();
+    test_search_stats();
+    test_generator();
+    test_checkpoint();
+    test_monitor();
+    test_budget();
+    test_multilevel();
+    test_precheck();
+    test_penalty();
+    test_restart();
     
     printf("\nAll tests PASSED!\n");
     return 0;
@@ -1,6 +1,7 @@
 #include <pthread.h>
 #include <stdbool.h>
 #include <assert.h>
+#include <stdatomic.h>
 #include "utils.c"
 
 
@@ -10,92 +11,345 @@
 
 #define K_TOP 10
 
-// Mutex and condition variable to signal the first thread to finish
+// One entry of the elite pool, guarded by a sequence lock: the sequence is odd while a writer
+// copies a solution in, and readers retry their copy if it changed meanwhile.
+// Slots are cache-line aligned so that threads publishing to different slots don't share lines.
 typedef struct {
-    Solution top_k_solutions[K_TOP];
-    bool stop_flag; 
-    pthread_mutex_t stop_mutex;
-    pthread_mutex_t top_k_mutex;
+    _Alignas(64) atomic_uint sequence;
+    atomic_int violations;  // INT32_MAX while the slot is empty
+    Point* points;          // N points
+} elite_slot_t;
+
+// State shared by the solver threads: the stop flag and the pool of the K_TOP best solutions.
+// Neither takes a lock; only printing does.
+typedef struct {
+    int N;
+    elite_slot_t elite[K_TOP];  // unordered
+    atomic_bool stop_flag;
+    const atomic_bool* parent_stop; // the stop flag of an enclosing run, which stops these threads too; NULL for none
+    atomic_llong publications;  // solutions written to the pool
+    atomic_llong contention;    // retries caused by another thread holding the same slot
+    atomic_llong restarts;      // restarts of all the threads, which index the shared restart schedules
+    FILE* restart_log;          // one JSON line per restart attempt, NULL for none: written by the monitor and main() only
+    char* restart_lines;        // lines buffered by the workers, not written yet
+    size_t restart_length;
+    size_t restart_capacity;
+    pthread_mutex_t restart_mutex;  // guards the buffer alone, never held across I/O
     pthread_mutex_t print_mutex;
 } synchronization_t;
 
-void sync_init(synchronization_t* sync) {
-    sync->stop_flag = false;
+void sync_init(synchronization_t* sync, int N) {
+    sync->N = N;
+    atomic_init(&sync->stop_flag, false);
+    sync->parent_stop = NULL;
+    atomic_init(&sync->publications, 0);
+    atomic_init(&sync->contention, 0);
+    atomic_init(&sync->restarts, 0);
+    sync->restart_log = NULL;
+    sync->restart_lines = NULL;
+    sync->restart_length = 0;
+    sync->restart_capacity = 0;
     
     for(int i = 0; i < K_TOP; ++i) {
-        solution_init(&sync->top_k_solutions[i]);
+        atomic_init(&sync->elite[i].sequence, 0);
+        atomic_init(&sync->elite[i].violations, INT32_MAX);
+        sync->elite[i].points = calloc(N, sizeof(Point));
     }
 
-    int rc1 = pthread_mutex_init(&sync->stop_mutex, NULL);
-    assert(rc1 == 0);
-    int rc2 = pthread_mutex_init(&sync->top_k_mutex, NULL);
-    assert(rc2 == 0);
-    int rc3 = pthread_mutex_init(&sync->print_mutex, NULL);
-    assert(rc3 == 0);
+    int rc = pthread_mutex_init(&sync->print_mutex, NULL);
+    assert(rc == 0);
+    rc = pthread_mutex_init(&sync->restart_mutex, NULL);
+    assert(rc == 0);
 }
 
 void sync_destroy(synchronization_t* sync) {
-    pthread_mutex_destroy(&sync->stop_mutex);
-    pthread_mutex_destroy(&sync->top_k_mutex);
     pthread_mutex_destroy(&sync->print_mutex);
+    pthread_mutex_destroy(&sync->restart_mutex);
+    free(sync->restart_lines);
+    sync->restart_lines = NULL;
+    for(int i = 0; i < K_TOP; ++i) {
+        free(sync->elite[i].points);
+        sync->elite[i].points = NULL;
+    }
+}
+
+size_t sync_bytes(int N) {
+    return sizeof(synchronization_t) + K_TOP * N * sizeof(Point);
 }
 
 bool sync_should_stop(synchronization_t* sync) {
-    pthread_mutex_lock(&sync->stop_mutex);
-    bool should_stop = sync->stop_flag;
-    pthread_mutex_unlock(&sync->stop_mutex);
-    return should_stop;
+    return atomic_load_explicit(&sync->stop_flag, memory_order_acquire)
+        || (sync->parent_stop != NULL && atomic_load_explicit(sync->parent_stop, memory_order_acquire));
 }
 
 bool sync_set_stop(synchronization_t* sync) {
     // returns whether it was the first thread to set the stop flag (i.e., it was false before)
-    pthread_mutex_lock(&sync->stop_mutex);
-    bool ans = !sync->stop_flag;
-    sync->stop_flag = true;
-    pthread_mutex_unlock(&sync->stop_mutex);
-    return ans;
+    return !atomic_exchange_explicit(&sync->stop_flag, true, memory_order_acq_rel);
+}
+
+// Buffers `length` bytes of restart log lines, for sync_flush_restart_log to write: a worker only copies them.
+void sync_append_restart_log(synchronization_t* sync, const char* lines, size_t length) {
+    pthread_mutex_lock(&sync->restart_mutex);
+    if (sync->restart_length + length > sync->restart_capacity) {
+        size_t capacity = sync->restart_capacity > 0 ? 2 * sync->restart_capacity : 4096;
+        while (capacity < sync->restart_length + length) {
+            capacity *= 2;
+        }
+        sync->restart_lines = realloc(sync->restart_lines, capacity);
+        sync->restart_capacity = capacity;
+    }
+    memcpy(sync->restart_lines + sync->restart_length, lines, length);
+    sync->restart_length += length;
+    pthread_mutex_unlock(&sync->restart_mutex);
+}
+
+// Writes the buffered restart log lines to the log. The buffer is taken under the lock and written
+// after it, so that the workers never wait on the file. Called by one thread at a time: the monitor
+// while the workers run, and main() once they are joined.
+void sync_flush_restart_log(synchronization_t* sync) {
+    if (sync->restart_log == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&sync->restart_mutex);
+    char* lines = sync->restart_lines;
+    size_t length = sync->restart_length;
+    sync->restart_lines = NULL;
+    sync->restart_length = 0;
+    sync->restart_capacity = 0;
+    pthread_mutex_unlock(&sync->restart_mutex);
+    if (length > 0) {
+        fwrite(lines, 1, length, sync->restart_log);
+        fflush(sync->restart_log);
+    }
+    free(lines);
 }
 
+// Copies slot `idx` into `points` and returns its violations, without ever blocking a writer.
+static int sync_read_slot(synchronization_t* sync, int idx, Point* points) {
+    elite_slot_t* slot = &sync->elite[idx];
+    for (;;) {
+        unsigned before = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        if (before & 1) {
+            atomic_fetch_add_explicit(&sync->contention, 1, memory_order_relaxed);
+            continue;
+        }
+        int violations = atomic_load_explicit(&slot->violations, memory_order_relaxed);
+        memcpy(points, slot->points, sync->N * sizeof(Point));
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->sequence, memory_order_relaxed) == before) {
+            return violations;
+        }
+        atomic_fetch_add_explicit(&sync->contention, 1, memory_order_relaxed);
+    }
+}
+
+// Overwrites slot `idx`, e.g. when restoring a checkpoint. Only safe while no other thread uses the pool.
+void sync_set_slot(synchronization_t* sync, int idx, const Point* points, int violations) {
+    atomic_store_explicit(&sync->elite[idx].violations, violations, memory_order_relaxed);
+    memcpy(sync->elite[idx].points, points, sync->N * sizeof(Point));
+}
+
+// Publishes a solution into the elite pool, replacing the worst entry if it is at least as good.
+// Only the N points of the new solution are copied, once.
 void sync_broadcast_new_solution(synchronization_t* sync, Point* points, int violations) {
-    pthread_mutex_lock(&sync->top_k_mutex);
-    for(int i = 0; i < K_TOP; ++i) {
-        if(violations <= sync->top_k_solutions[i].violations) {
-            for(int j = i+1; j < K_TOP; ++j) {
-                sync->top_k_solutions[j].violations = sync->top_k_solutions[j-1].violations;
-                for(int p = 0; p < MAX_POINTS; ++p) {
-                    sync->top_k_solutions[j].points[p].x =  sync->top_k_solutions[j-1].points[p].x;
-                    sync->top_k_solutions[j].points[p].y =  sync->top_k_solutions[j-1].points[p].y;
-                }
-            }
-            sync->top_k_solutions[i].violations = violations;
-            for(int p = 0; p < MAX_POINTS; ++p) {
-                sync->top_k_solutions[i].points[p].x = points[p].x;
-                sync->top_k_solutions[i].points[p].y = points[p].y;
+    for (;;) {
+        int worst = 0;
+        int worst_violations = atomic_load_explicit(&sync->elite[0].violations, memory_order_relaxed);
+        for (int i = 1; i < K_TOP; ++i) {
+            int v = atomic_load_explicit(&sync->elite[i].violations, memory_order_relaxed);
+            if (v > worst_violations) {
+                worst = i;
+                worst_violations = v;
             }
-            break;
         }
+        if (violations > worst_violations) {
+            return;
+        }
+
+        // take the slot by making its sequence odd
+        elite_slot_t* slot = &sync->elite[worst];
+        unsigned sequence = atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+        if ((sequence & 1) || !atomic_compare_exchange_strong_explicit(&slot->sequence, &sequence, sequence + 1,
+                memory_order_acquire, memory_order_relaxed)) {
+            atomic_fetch_add_explicit(&sync->contention, 1, memory_order_relaxed);
+            continue;
+        }
+        atomic_thread_fence(memory_order_release);
+        if (atomic_load_explicit(&slot->violations, memory_order_relaxed) < violations) {
+            // another thread filled it with a better solution meanwhile; nothing was written
+            atomic_store_explicit(&slot->sequence, sequence, memory_order_release);
+            atomic_fetch_add_explicit(&sync->contention, 1, memory_order_relaxed);
+            continue;
+        }
+        atomic_store_explicit(&slot->violations, violations, memory_order_relaxed);
+        memcpy(slot->points, points, sync->N * sizeof(Point));
+        atomic_store_explicit(&slot->sequence, sequence + 2, memory_order_release);
+        atomic_fetch_add_explicit(&sync->publications, 1, memory_order_relaxed);
+        return;
     }
-    pthread_mutex_unlock(&sync->top_k_mutex);
 }
 
+// Picks one of the pooled solutions, favouring the best ones, and copies it into `points`.
+// Leaves `points` untouched (and returns INT32_MAX violations) while the pool is still empty.
 void sync_get_best_solution(synchronization_t* sync, Point* points, int* violations, rng_t* rng) {
-    pthread_mutex_lock(&sync->top_k_mutex);
+    // rank the filled slots by violations
+    int order[K_TOP];
+    int ranked_violations[K_TOP];
+    int filled = 0;
+    for (int i = 0; i < K_TOP; ++i) {
+        int v = atomic_load_explicit(&sync->elite[i].violations, memory_order_relaxed);
+        if (v == INT32_MAX) {
+            continue;
+        }
+        int pos = filled++;
+        while (pos > 0 && ranked_violations[pos-1] > v) {
+            order[pos] = order[pos-1];
+            ranked_violations[pos] = ranked_violations[pos-1];
+            pos--;
+        }
+        order[pos] = i;
+        ranked_violations[pos] = v;
+    }
+    if (filled == 0) {
+        *violations = INT32_MAX;
+        return;
+    }
     
     int scores[K_TOP];
-    for(int i = 0; i < K_TOP; ++i) {
-        scores[i] = (2*sync->top_k_solutions[0].violations - sync->top_k_solutions[i].violations)*(K_TOP - i);
+    for(int i = 0; i < filled; ++i) {
+        scores[i] = (2*ranked_violations[0] - ranked_violations[i])*(K_TOP - i);
+        scores[i] = scores[i] > 0 ? scores[i] : 0;
     }
 
-    int idx = sample_proportional(scores, K_TOP, rng); 
-    *violations = sync->top_k_solutions[idx].violations;
+    int idx = sample_proportional(scores, filled, rng); 
+    *violations = sync_read_slot(sync, order[idx], points);
+}
 
-    
-    for(int i = 0; i < MAX_POINTS; ++i) {
-        points[i].x = sync->top_k_solutions[idx].points[i].x;
-        points[i].y = sync->top_k_solutions[idx].points[i].y;
+// Copies a pooled solution drawn uniformly into `points` and returns its violations, or leaves
+// `points` untouched and returns INT32_MAX while the pool is still empty.
+int sync_get_random_solution(synchronization_t* sync, Point* points, rng_t* rng) {
+    int filled[K_TOP];
+    int count = 0;
+    for (int i = 0; i < K_TOP; ++i) {
+        if (atomic_load_explicit(&sync->elite[i].violations, memory_order_relaxed) != INT32_MAX) {
+            filled[count++] = i;
+        }
+    }
+    if (count == 0) {
+        return INT32_MAX;
+    }
+    int idx = rng_double(rng) * count;
+    return sync_read_slot(sync, filled[idx < count ? idx : count - 1], points);
+}
+
+// The violations of the best pooled solution (INT32_MAX if none), without copying it.
+int sync_best_violations(synchronization_t* sync) {
+    int best = INT32_MAX;
+    for (int i = 0; i < K_TOP; ++i) {
+        int v = atomic_load_explicit(&sync->elite[i].violations, memory_order_relaxed);
+        best = v < best ? v : best;
+    }
+    return best;
+}
+
+// Copies the best pooled solution into `points` and returns its violations (INT32_MAX if none).
+int sync_copy_best_solution(synchronization_t* sync, Point* points) {
+    int best = 0;
+    for (int i = 1; i < K_TOP; ++i) {
+        if (atomic_load_explicit(&sync->elite[i].violations, memory_order_relaxed) <
+            atomic_load_explicit(&sync->elite[best].violations, memory_order_relaxed)) {
+            best = i;
+        }
+    }
+    return sync_read_slot(sync, best, points);
+}
+
+// The search state of one solver thread, published by the thread itself every so many iterations and
+// read by the checkpoint writer. The same sequence lock as the elite slots, with a single writer.
+typedef struct {
+    _Alignas(64) atomic_uint sequence;
+    bool valid;                 // a state has been published, or restored from a checkpoint
+    bool resume;                // solve() starts from this state instead of a random assignment
+    Point* points;              // N points
+    rng_t rng;
+    long long iterations;
+    long long its_since_checkpoint;
+    long long reset_its;        // the current reset interval, grown by the reset multiplier
+    int violations;
+    uint16_t* search_weight;    // with adaptive weighting, weight_count of them, up to the constraint count
+    int weight_count;           // 0 without adaptive weighting
+    int weight_capacity;
+} thread_state_t;
+
+void thread_state_init(thread_state_t* state, int N, int constraint_count) {
+    atomic_init(&state->sequence, 0);
+    state->valid = false;
+    state->resume = false;
+    state->points = calloc(N, sizeof(Point));
+    rng_init(&state->rng, 0);
+    state->iterations = 0;
+    state->its_since_checkpoint = 0;
+    state->reset_its = 0;
+    state->violations = INT32_MAX;
+    state->search_weight = calloc(constraint_count > 0 ? constraint_count : 1, sizeof(uint16_t));
+    state->weight_count = 0;
+    state->weight_capacity = constraint_count;
+}
+
+void thread_state_destroy(thread_state_t* state) {
+    free(state->points);
+    free(state->search_weight);
+    state->points = NULL;
+    state->search_weight = NULL;
+}
+
+// Called by the owning thread only. `search_weight` is NULL without adaptive weighting.
+void thread_state_publish(thread_state_t* state, int N, const Point* points, const rng_t* rng,
+    long long iterations, long long its_since_checkpoint, long long reset_its, int violations,
+    const uint16_t* search_weight, int weight_count) {
+    assert(search_weight == NULL || weight_count <= state->weight_capacity);
+    unsigned sequence = atomic_load_explicit(&state->sequence, memory_order_relaxed);
+    atomic_store_explicit(&state->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(state->points, points, N * sizeof(Point));
+    state->rng = *rng;
+    state->iterations = iterations;
+    state->its_since_checkpoint = its_since_checkpoint;
+    state->reset_its = reset_its;
+    state->violations = violations;
+    state->weight_count = search_weight ? weight_count : 0;
+    if (search_weight != NULL) {
+        memcpy(state->search_weight, search_weight, weight_count * sizeof(uint16_t));
     }
+    state->valid = true;
+    atomic_store_explicit(&state->sequence, sequence + 2, memory_order_release);
+}
 
-    pthread_mutex_unlock(&sync->top_k_mutex);
+// Copies the state into `copy`, whose points must hold N entries and whose weights as many as the
+// state's, without ever blocking the writer.
+void thread_state_read(thread_state_t* state, int N, thread_state_t* copy) {
+    Point* points = copy->points;
+    for (;;) {
+        unsigned before = atomic_load_explicit(&state->sequence, memory_order_acquire);
+        if (before & 1) {
+            continue;
+        }
+        memcpy(points, state->points, N * sizeof(Point));
+        copy->valid = state->valid;
+        copy->rng = state->rng;
+        copy->iterations = state->iterations;
+        copy->its_since_checkpoint = state->its_since_checkpoint;
+        copy->reset_its = state->reset_its;
+        copy->violations = state->violations;
+        int weight_count = state->weight_count;
+        // a count torn by the writer fails the sequence check below
+        copy->weight_count = weight_count >= 0 && weight_count <= copy->weight_capacity ? weight_count : 0;
+        memcpy(copy->search_weight, state->search_weight, copy->weight_count * sizeof(uint16_t));
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&state->sequence, memory_order_relaxed) == before) {
+            return;
+        }
+    }
 }
 
 void sync_color_printf(synchronization_t* sync, Color color, const char* format, ...) {
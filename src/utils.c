@@ -5,14 +5,13 @@
 #include <time.h>
 #include <stdarg.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include <sys/mman.h>
 #include "rng.c"
 
 #define __STDC_LIMIT_MACROS
 #define MAX_LINE_LENGTH 256
-
-
-#define MAX_POINTS 81
-#define MAX_CONSTRAINTS (MAX_POINTS*(MAX_POINTS-1)*(MAX_POINTS-2))/6
+#define COORDINATE_FORMAT "%.8f" // coordinates of saved solutions
 
 #ifndef UTILS_H
 #define UTILS_H
@@ -33,95 +32,472 @@ typedef struct {
 } Point;
 
 typedef struct {
-    Point points[MAX_POINTS];
+    Point* points; // N points
     int violations;
 } Solution;
 
 // Structure to represent a symmetry
 typedef struct {
-    int cycles[MAX_POINTS][MAX_POINTS];
-    int cycle_lengths[MAX_POINTS];
-    // int leads[MAX_POINTS];
+    int** cycles;       // cycles[i] points into a single buffer holding all cycles back to back
+    int* cycle_lengths;
     int num_cycles;
 } Symmetry;
 
-void solution_init(Solution* sol) {
-    for(int i = 0; i < MAX_POINTS; ++i) {
-        sol->points[i].x = 0.0;
-        sol->points[i].y = 0.0;
-        sol->violations = INT32_MAX;
+// Column-wise copy of the constraints, with 0-based indices, for the vectorized evaluation kernels.
+typedef struct {
+    int32_t* i;
+    int32_t* j;
+    int32_t* k;
+    int8_t* sign;
+} ConstraintColumns;
+
+// Constraints of an instance, sized from the parsed file.
+// The constraints involving point p are stored in CSR form:
+// point_constraints[point_offsets[p] ... point_offsets[p+1]-1]
+// A complete chirotope (every triple i < j < k, in lexicographic or colex order) needs no index:
+// constraint c is the triple of rank c, the constraints of p are generated from the pairs of other
+// points, and their signs are read from a 2-bit-per-triple array. Use point_cursor() to visit them
+// either way.
+typedef struct {
+    int N;
+    Constraint* constraints;
+    int constraint_count;
+    bool complete;          // implicit representation, point_offsets and point_constraints are NULL
+    bool colex;             // complete: constraints in colex rather than lexicographic order
+    uint8_t* chirotope;     // complete: sign + 1 of the triple of rank c, 4 triples per byte
+    int* point_offsets;     // N+1 entries
+    int* point_constraints; // 3 * constraint_count entries
+    ConstraintColumns columns;
+    void* mapping;          // memory-mapped binary file the columns point into, or NULL if they are owned
+    size_t mapping_size;
+} Problem;
+
+void solution_init(Solution* sol, int N) {
+    sol->points = calloc(N, sizeof(Point));
+    sol->violations = INT32_MAX;
+}
+
+void solution_free(Solution* sol) {
+    free(sol->points);
+    sol->points = NULL;
+}
+
+// Number of triples i < j < k below n.
+static inline int64_t triples_below(int64_t n) {
+    return n * (n - 1) * (n - 2) / 6;
+}
+
+// Rank of the 0-based triple i < j < k in colex order.
+static inline int64_t colex_rank(int i, int j, int k) {
+    return triples_below(k) + (int64_t)j * (j - 1) / 2 + i;
+}
+
+// Rank of the 0-based triple i < j < k in lexicographic order among the triples of N points.
+static inline int64_t lex_rank(int N, int i, int j, int k) {
+    int64_t n = N;
+    return triples_below(n) - triples_below(n - i)
+        + ((n - 1 - i) * (n - 2 - i) - (n - j) * (n - j - 1)) / 2
+        + (k - j - 1);
+}
+
+// Id of the 0-based triple i < j < k in a complete problem.
+static inline int triple_rank(const Problem* problem, int i, int j, int k) {
+    return problem->colex ? colex_rank(i, j, k) : lex_rank(problem->N, i, j, k);
+}
+
+static inline int problem_degree(const Problem* problem, int p) {
+    if (problem->complete) {
+        return (problem->N - 1) * (problem->N - 2) / 2;
     }
+    return problem->point_offsets[p+1] - problem->point_offsets[p];
+}
+
+// Sign of constraint c of a complete problem.
+static inline int chirotope_sign(const Problem* problem, int c) {
+    return ((problem->chirotope[c >> 2] >> (2 * (c & 3))) & 3) - 1;
+}
+
+// Not available for complete problems, see point_cursor().
+static inline const int* problem_point_constraints(const Problem* problem, int p) {
+    return problem->point_constraints + problem->point_offsets[p];
+}
+
+// Iterates over the constraints of one point, by ascending id, as problem_point_constraints does.
+// For complete problems they come in runs of triples where one index varies, e.g. (a, b, p) for
+// b = a+1 ... p-1, so each id follows from the previous one with an addition.
+typedef struct {
+    const Problem* problem;
+    int p;
+    int t[3];       // complete: current triple, 0-based
+    int slot;       // index of t varying along the run
+    int dt[3];      // unit step of the triple along the run, 1 at slot
+    int remaining;  // triples left in the run
+    int rank;       // id of t
+    int step, dstep; // the next id is rank + step, and step changes by dstep along the run
+    int outer;      // next run: the other point whose runs come next, and which of its runs
+    int phase;
+    int next, last; // otherwise: range of point_constraints left
+} point_cursor_t;
+
+// Moves the cursor of a complete problem to its next non-empty run. Returns false at the end.
+static inline bool point_cursor_next_run(point_cursor_t* cursor) {
+    int N = cursor->problem->N, p = cursor->p;
+    int* t = cursor->t;
+    int slot, end;
+    do {
+        int o = cursor->outer;
+        if (!cursor->problem->colex) {
+            if (o < p && cursor->phase == 0) {
+                t[0] = o; t[1] = o + 1; t[2] = p; slot = 1; end = p;
+                cursor->phase = 1;
+            } else if (o < p) {
+                t[0] = o; t[1] = p; t[2] = p + 1; slot = 2; end = N;
+                cursor->phase = 0;
+                cursor->outer++;
+            } else {
+                o = o == p ? o + 1 : o;
+                if (o >= N) {
+                    return false;
+                }
+                t[0] = p; t[1] = o; t[2] = o + 1; slot = 2; end = N;
+                cursor->outer = o + 1;
+            }
+        } else {
+            o = o == p ? o + 1 : o;
+            if (o >= N) {
+                return false;
+            }
+            if (o < p) {
+                t[0] = 0; t[1] = o; t[2] = p; slot = 0; end = o;
+                cursor->outer = o + 1;
+            } else if (cursor->phase == 0) {
+                t[0] = 0; t[1] = p; t[2] = o; slot = 0; end = p;
+                cursor->outer = o;
+                cursor->phase = 1;
+            } else {
+                t[0] = p; t[1] = p + 1; t[2] = o; slot = 1; end = o;
+                cursor->outer = o + 1;
+                cursor->phase = 0;
+            }
+        }
+    } while (t[slot] >= end);
+
+    cursor->slot = slot;
+    cursor->remaining = end - t[slot];
+    for (int s = 0; s < 3; s++) {
+        cursor->dt[s] = s == slot;
+    }
+    cursor->rank = triple_rank(cursor->problem, t[0], t[1], t[2]);
+    // the last index steps the id by one in lexicographic order, the first in colex order;
+    // the middle one by N - j - 2 and j respectively
+    if (slot == (cursor->problem->colex ? 0 : 2)) {
+        cursor->step = 1;
+        cursor->dstep = 0;
+    } else if (!cursor->problem->colex) {
+        cursor->step = N - t[1] - 2;
+        cursor->dstep = -1;
+    } else {
+        cursor->step = t[1];
+        cursor->dstep = 1;
+    }
+    return true;
+}
+
+static inline point_cursor_t point_cursor(const Problem* problem, int p) {
+    point_cursor_t cursor = { .problem = problem, .p = p };
+    if (problem->complete) {
+        // an empty run, so that the first call moves to the first one
+        cursor.outer = problem->colex ? 1 : 0;
+        cursor.remaining = 0;
+    } else {
+        cursor.next = problem->point_offsets[p];
+        cursor.last = problem->point_offsets[p+1];
+    }
+    return cursor;
+}
+
+// Next constraint of the point: its id and (1-based) triple with sign. Returns false at the end.
+static inline bool point_cursor_next(point_cursor_t* cursor, int* id, Constraint* constraint) {
+    const Problem* problem = cursor->problem;
+    if (!problem->complete) {
+        if (cursor->next == cursor->last) {
+            return false;
+        }
+        *id = problem->point_constraints[cursor->next++];
+        *constraint = problem->constraints[*id];
+        return true;
+    }
+
+    if (cursor->remaining == 0 && !point_cursor_next_run(cursor)) {
+        return false;
+    }
+    int* t = cursor->t;
+    int c = cursor->rank;
+    *id = c;
+    *constraint = (Constraint){ t[0] + 1, t[1] + 1, t[2] + 1, chirotope_sign(problem, c) };
+
+    cursor->remaining--;
+    cursor->rank = c + cursor->step;
+    cursor->step += cursor->dstep;
+    t[0] += cursor->dt[0];
+    t[1] += cursor->dt[1];
+    t[2] += cursor->dt[2];
+    return true;
+}
+
+int problem_max_degree(const Problem* problem) {
+    int mx = 0;
+    for (int p = 0; p < problem->N; p++) {
+        mx = problem_degree(problem, p) > mx ? problem_degree(problem, p) : mx;
+    }
+    return mx;
+}
+
+size_t problem_bytes(const Problem* problem) {
+    size_t index = problem->complete
+        ? ((size_t)problem->constraint_count + 3) / 4
+        : (problem->N + 1) * sizeof(int) + 3 * (size_t)problem->constraint_count * sizeof(int);
+    return problem->constraint_count * sizeof(Constraint) + index
+        + problem->constraint_count * (3 * sizeof(int32_t) + sizeof(int8_t));
+}
+
+void problem_free(Problem* problem) {
+    free(problem->constraints);
+    free(problem->point_offsets);
+    free(problem->point_constraints);
+    free(problem->chirotope);
+    if (problem->mapping != NULL) {
+        munmap(problem->mapping, problem->mapping_size);
+        problem->mapping = NULL;
+    } else {
+        free(problem->columns.i);
+        free(problem->columns.j);
+        free(problem->columns.k);
+        free(problem->columns.sign);
+    }
+    problem->constraints = NULL;
+    problem->point_offsets = NULL;
+    problem->point_constraints = NULL;
+    problem->chirotope = NULL;
+}
+
+// Simple bump allocator, so that all the per-thread buffers live in one block.
+typedef struct {
+    char* base;
+    size_t size;
+    size_t used;
+} arena_t;
+
+#define ARENA_ALIGNMENT 64
+
+static inline size_t arena_round(size_t bytes) {
+    return (bytes + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+void arena_init(arena_t* arena, size_t size) {
+    arena->size = arena_round(size);
+    arena->used = 0;
+    arena->base = aligned_alloc(ARENA_ALIGNMENT, arena->size > 0 ? arena->size : ARENA_ALIGNMENT);
+    if (arena->base == NULL) {
+        printf("ERROR: Could not allocate %zu bytes\n", arena->size);
+        exit(1);
+    }
+}
+
+void* arena_alloc(arena_t* arena, size_t bytes) {
+    bytes = arena_round(bytes);
+    if (arena->used + bytes > arena->size) {
+        printf("ERROR: arena exhausted (%zu + %zu > %zu bytes)\n", arena->used, bytes, arena->size);
+        exit(1);
+    }
+    void* ptr = arena->base + arena->used;
+    arena->used += bytes;
+    return ptr;
+}
+
+void arena_reset(arena_t* arena) {
+    arena->used = 0;
+}
+
+void arena_free(arena_t* arena) {
+    free(arena->base);
+    arena->base = NULL;
+    arena->size = arena->used = 0;
 }
 
 // Function prototypes
+void problem_build_index(Problem* problem);
+void problem_build_point_index(Problem* problem);
 void generate_random_assignment(int N, Point* points, rng_t* rng);
 int sample_proportional(int* weights, int count, rng_t* rng);
 Point random_point_in_ball(Point p, double r, rng_t* rng);
 double det(Point pa, Point pb, Point pc);
 void parse_fixed_points(const char* fixed_points_file, int N, Point* fixed_points, bool* is_point_fixed);
 
-// Parse constraints from file
-void parse_constraints(const char* orientation_file, 
-                        int* N, 
-                        Constraint* constraints, 
-                        int* constraint_count,
-                        int** constraints_per_point,
-                        int* constraints_per_point_count) {
+// Parse constraints from file.
+// Constraints are read into a growing array, and the per-point CSR index is built
+// once N is known, so that memory is proportional to the actual instance.
+// Returns NULL, or what is wrong with the file, without printing: batch workers load files concurrently.
+const char* read_constraints(const char* orientation_file, Problem* problem) {
                         
     FILE* file = fopen(orientation_file, "r");
     if (file == NULL) {
-        printf("Error opening file\n");
-        exit(1);
+        return "cannot open the file";
     }
 
     char line[MAX_LINE_LENGTH*sizeof(char)];
-    *N = 0;
-    *constraint_count = 0;
-    for(int i = 0; i < MAX_POINTS; i++) {
-        constraints_per_point_count[i] = 0;
-    }
+    int N = 0;
+    int count = 0;
+    int capacity = 1024;
+    Constraint* constraints = malloc(capacity * sizeof(Constraint));
 
     while (fgets(line, sizeof(line), file)) {
         char orientation;
         int i, j, k;
-        sscanf(line, "%c_(%d, %d, %d)", &orientation, &i, &j, &k);
+        if (sscanf(line, "%c_(%d, %d, %d)", &orientation, &i, &j, &k) != 4) {
+            continue;
+        }
+        if (i < 1 || j < 1 || k < 1) {
+            fclose(file);
+            free(constraints);
+            return "invalid point index";
+        }
 
-        if (i > *N) *N = i;
-        if (j > *N) *N = j;
-        if (k > *N) *N = k;
+        if (i > N) N = i;
+        if (j > N) N = j;
+        if (k > N) N = k;
+
+        if (count == capacity) {
+            capacity *= 2;
+            Constraint* grown = realloc(constraints, capacity * sizeof(Constraint));
+            if (grown == NULL) {
+                fclose(file);
+                free(constraints);
+                return "too many constraints";
+            }
+            constraints = grown;
+        }
 
-        constraints[*constraint_count].i = i;
-        constraints[*constraint_count].j = j;
-        constraints[*constraint_count].k = k;
-        
-        constraints_per_point[i-1][constraints_per_point_count[i-1]++] = *constraint_count;
-        constraints_per_point[j-1][constraints_per_point_count[j-1]++] = *constraint_count;
-        constraints_per_point[k-1][constraints_per_point_count[k-1]++] = *constraint_count;
+        constraints[count].i = i;
+        constraints[count].j = j;
+        constraints[count].k = k;
 
         switch (orientation) {
-        case 'A': constraints[*constraint_count].sign = 1; break;
-        case 'B': constraints[*constraint_count].sign = -1; break;
-        case 'C': constraints[*constraint_count].sign = 0; break;
+        case 'A': constraints[count].sign = 1; break;
+        case 'B': constraints[count].sign = -1; break;
+        case 'C': constraints[count].sign = 0; break;
+        default: constraints[count].sign = 0; break;
         }
         
-        (*constraint_count)++;
-        if (*constraint_count >= MAX_CONSTRAINTS) {
-            printf("ERROR: Too many constraints\n");
-            exit(1);
-        }
+        count++;
     }
 
     fclose(file);
+
+    problem->N = N;
+    problem->constraints = realloc(constraints, (count > 0 ? count : 1) * sizeof(Constraint));
+    problem->constraint_count = count;
+    problem_build_index(problem);
+    return NULL;
+}
+
+void parse_constraints(const char* orientation_file, Problem* problem) {
+    const char* error = read_constraints(orientation_file, problem);
+    if (error != NULL) {
+        printf("ERROR: %s: %s\n", orientation_file, error);
+        exit(1);
+    }
 }
 
 // Generate random assignment of coordinates
 void generate_random_assignment(int N, Point* points, rng_t* rng) {
     for (int i = 0; i < N; i++) {
-        points[i].x = rng_float(rng) * 10;
-        points[i].y = rng_float(rng) * 10;
+        points[i].x = rng_double(rng) * 10;
+        points[i].y = rng_double(rng) * 10;
     }
 }
 
+// Build the constraint columns and the CSR point -> constraints index from problem->constraints.
+void problem_build_index(Problem* problem) {
+    int count = problem->constraint_count > 0 ? problem->constraint_count : 1;
+    problem->columns.i = malloc(count * sizeof(int32_t));
+    problem->columns.j = malloc(count * sizeof(int32_t));
+    problem->columns.k = malloc(count * sizeof(int32_t));
+    problem->columns.sign = malloc(count * sizeof(int8_t));
+    for (int c = 0; c < problem->constraint_count; c++) {
+        problem->columns.i[c] = problem->constraints[c].i - 1;
+        problem->columns.j[c] = problem->constraints[c].j - 1;
+        problem->columns.k[c] = problem->constraints[c].k - 1;
+        problem->columns.sign[c] = problem->constraints[c].sign;
+    }
+    problem->mapping = NULL;
+    problem->mapping_size = 0;
+    problem_build_point_index(problem);
+}
+
+// Whether every triple is present, with constraint c the triple of rank c in the given order.
+static bool problem_in_rank_order(const Problem* problem, bool colex) {
+    int N = problem->N;
+    if (N < 3 || problem->constraint_count != triples_below(N)) {
+        return false;
+    }
+    for (int c = 0; c < problem->constraint_count; c++) {
+        const Constraint* constraint = &problem->constraints[c];
+        int i = constraint->i - 1, j = constraint->j - 1, k = constraint->k - 1;
+        if (!(0 <= i && i < j && j < k && k < N)) {
+            return false;
+        }
+        if ((colex ? colex_rank(i, j, k) : lex_rank(N, i, j, k)) != c) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Build the point -> constraints index from problem->constraints: the packed signs of a complete
+// chirotope, and the CSR index otherwise.
+void problem_build_point_index(Problem* problem) {
+    int N = problem->N;
+    problem->colex = false;
+    problem->complete = problem_in_rank_order(problem, false);
+    if (!problem->complete) {
+        problem->colex = problem->complete = problem_in_rank_order(problem, true);
+    }
+    problem->chirotope = NULL;
+    problem->point_offsets = NULL;
+    problem->point_constraints = NULL;
+    if (problem->complete) {
+        problem->chirotope = calloc((problem->constraint_count + 3) / 4, 1);
+        for (int c = 0; c < problem->constraint_count; c++) {
+            problem->chirotope[c >> 2] |= (problem->constraints[c].sign + 1) << (2 * (c & 3));
+        }
+        return;
+    }
+
+    problem->point_offsets = calloc(N + 1, sizeof(int));
+    problem->point_constraints = malloc(3 * (size_t)(problem->constraint_count > 0 ? problem->constraint_count : 1) * sizeof(int));
+
+    for (int c = 0; c < problem->constraint_count; c++) {
+        problem->point_offsets[problem->constraints[c].i]++;
+        problem->point_offsets[problem->constraints[c].j]++;
+        problem->point_offsets[problem->constraints[c].k]++;
+    }
+    // prefix sums (constraint indices are 1-based, so offsets[p+1] holds the count of point p)
+    for (int p = 0; p < N; p++) {
+        problem->point_offsets[p+1] += problem->point_offsets[p];
+    }
+
+    int* fill = malloc(N * sizeof(int));
+    memcpy(fill, problem->point_offsets, N * sizeof(int));
+    for (int c = 0; c < problem->constraint_count; c++) {
+        const Constraint* constraint = &problem->constraints[c];
+        problem->point_constraints[fill[constraint->i - 1]++] = c;
+        problem->point_constraints[fill[constraint->j - 1]++] = c;
+        problem->point_constraints[fill[constraint->k - 1]++] = c;
+    }
+    free(fill);
+}
+
 int update_max_violations(int* violations_per_point, int N, int updated_point, int updated_violations) {
     int mx = -1;
     int imx = 0;
@@ -174,7 +550,7 @@ int sample_proportional(int* weights, int count, rng_t* rng) {
         total_violations += adjusted_weights[i];
     }
 
-    double r = rng_float(rng) * total_violations;
+    double r = rng_double(rng) * total_violations;
     int cumulative = 0;
     for (int i = 0; i < count; i++) {
         // printf("i: %d, weight: %d\n", i, weights[i]);
@@ -187,14 +563,84 @@ int sample_proportional(int* weights, int count, rng_t* rng) {
     return count - 1;  // Fallback
 }
 
+// Fenwick tree over non-negative integer weights, for sampling an index proportionally to its
+// weight when the weights change one at a time: O(log n) updates and O(log n) sampling.
+typedef struct {
+    int n;
+    int top;            // highest power of two <= n
+    long long* tree;    // 1-based
+} fenwick_t;
+
+size_t fenwick_bytes(int n) {
+    return arena_round((n + 1) * sizeof(long long));
+}
+
+void fenwick_init(fenwick_t* fenwick, int n, arena_t* arena) {
+    fenwick->n = n;
+    fenwick->top = 1;
+    while (fenwick->top * 2 <= n) {
+        fenwick->top *= 2;
+    }
+    fenwick->tree = arena_alloc(arena, (n + 1) * sizeof(long long));
+    memset(fenwick->tree, 0, (n + 1) * sizeof(long long));
+}
+
+// Rebuild from scratch in O(n).
+void fenwick_build(fenwick_t* fenwick, const long long* weights) {
+    for (int i = 1; i <= fenwick->n; i++) {
+        fenwick->tree[i] = weights[i-1];
+    }
+    for (int i = 1; i <= fenwick->n; i++) {
+        int parent = i + (i & -i);
+        if (parent <= fenwick->n) {
+            fenwick->tree[parent] += fenwick->tree[i];
+        }
+    }
+}
+
+static inline void fenwick_add(fenwick_t* fenwick, int index, long long delta) {
+    for (int i = index + 1; i <= fenwick->n; i += i & -i) {
+        fenwick->tree[i] += delta;
+    }
+}
+
+long long fenwick_total(const fenwick_t* fenwick) {
+    long long total = 0;
+    for (int i = fenwick->n; i > 0; i -= i & -i) {
+        total += fenwick->tree[i];
+    }
+    return total;
+}
+
+// Sample an index proportionally to its weight, or -1 if all weights are zero.
+int fenwick_sample(const fenwick_t* fenwick, rng_t* rng) {
+    long long total = fenwick_total(fenwick);
+    if (total <= 0) {
+        return -1;
+    }
+    long long r = (long long)(rng_double(rng) * total);
+    if (r >= total) {
+        r = total - 1;
+    }
+    // descend to the last position whose prefix sum is <= r; the sampled index is the next one
+    int pos = 0;
+    for (int step = fenwick->top; step > 0; step /= 2) {
+        if (pos + step <= fenwick->n && fenwick->tree[pos + step] <= r) {
+            pos += step;
+            r -= fenwick->tree[pos];
+        }
+    }
+    return pos;
+}
+
 // Generate a random point in a ball around a given point
 Point random_point_in_ball(Point p, double r, rng_t* rng) {
-    double theta = rng_float(rng) * 2 * M_PI;
-    double random_r = r * sqrt(rng_float(rng));
+    double dx, dy;
+    rng_disk_offsets(rng, r, &dx, &dy, 1);
 
     Point new_point;
-    new_point.x = p.x + random_r * cos(theta);
-    new_point.y = p.y + random_r * sin(theta);
+    new_point.x = p.x + dx;
+    new_point.y = p.y + dy;
 
     return new_point;
 }
@@ -259,12 +705,23 @@ void serialize_solution(int N, Point* points, const char* output_file) {
     }
 
     for (int i = 0; i < N; i++) {
-        fprintf(file, "%d %.8f %.8f\n", i + 1, points[i].x, points[i].y);
+        fprintf(file, "%d " COORDINATE_FORMAT " " COORDINATE_FORMAT "\n", i + 1, points[i].x, points[i].y);
     }
 
     fclose(file);
 }
 
+// Rounds the points to the coordinates serialize_solution() writes, so that what is checked is what is saved.
+void round_to_serialized(int N, Point* points) {
+    char buffer[64];
+    for (int i = 0; i < N; i++) {
+        snprintf(buffer, sizeof(buffer), COORDINATE_FORMAT, points[i].x);
+        points[i].x = strtod(buffer, NULL);
+        snprintf(buffer, sizeof(buffer), COORDINATE_FORMAT, points[i].y);
+        points[i].y = strtod(buffer, NULL);
+    }
+}
+
 struct timespec get_time() {
     struct timespec ts;
     clock_gettime(CLOCK_MONOTONIC, &ts);
@@ -314,10 +771,26 @@ void parse_fixed_points(const char* fixed_points_file, int N, Point* fixed_point
     fclose(file);
 }
 
-void parse_symmetry(const char* symmetry_file, Symmetry* symmetry) {
+void symmetry_free(Symmetry* symmetry) {
+    if (symmetry->num_cycles > 0) {
+        free(symmetry->cycles[0]);
+    }
+    free(symmetry->cycles);
+    free(symmetry->cycle_lengths);
+    symmetry->cycles = NULL;
+    symmetry->cycle_lengths = NULL;
+    symmetry->num_cycles = 0;
+}
+
+// Parse the orbits of a symmetry. Every point appears in at most one orbit,
+// so all the cycles fit in a single buffer of N indices.
+void parse_symmetry(const char* symmetry_file, int N, Symmetry* symmetry) {
+    symmetry->num_cycles = 0;
+    symmetry->cycles = NULL;
+    symmetry->cycle_lengths = NULL;
+
     // If no file is provided, return without fixing any points
     if (symmetry_file == NULL || strlen(symmetry_file) == 0) {
-        symmetry->num_cycles = 0;
         return;
     }
 
@@ -327,17 +800,26 @@ void parse_symmetry(const char* symmetry_file, Symmetry* symmetry) {
         exit(1);
     }
 
+    int* buffer = malloc(N * sizeof(int));
+    symmetry->cycles = malloc(N * sizeof(int*));
+    symmetry->cycle_lengths = malloc(N * sizeof(int));
+
     color_printf(GREEN, "Parsing symmetry file: %s\n", symmetry_file);
     color_printf(GREEN, "--------------------------------\n");
     char line[MAX_LINE_LENGTH];
     int cycle_count = 0;
+    int used = 0;
     while (fgets(line, sizeof(line), file)) {
         char* ptr = line;
         int num;
         int cnt = 0;
         int chr_cnt = 0;
         while (ptr && *ptr && sscanf(ptr, "%d%n", &num, &chr_cnt) == 1) {
-            symmetry->cycles[cycle_count][cnt++] = num-1;
+            if (num < 1 || num > N || used + cnt >= N) {
+                printf("ERROR: Invalid point %d in symmetry file\n", num);
+                exit(1);
+            }
+            buffer[used + cnt++] = num-1;
             ptr += chr_cnt;
             // Skip any whitespace
             while (*ptr && (*ptr == ' ' || *ptr == '\t')) {
@@ -345,13 +827,21 @@ void parse_symmetry(const char* symmetry_file, Symmetry* symmetry) {
             }
         }
         
+        if (cnt == 0) {
+            continue;
+        }
 
+        symmetry->cycles[cycle_count] = buffer + used;
         symmetry->cycle_lengths[cycle_count] = cnt;
+        used += cnt;
 
         cycle_count++;
         
     }
     symmetry->num_cycles = cycle_count;
+    if (cycle_count == 0) {
+        free(buffer);
+    }
     for(int i = 0; i < symmetry->num_cycles; ++i) {
         color_printf(YELLOW, "Cycle %d, ", i);
  
@@ -0,0 +1,289 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "utils.c"
+#include "evaluation.c"
+#include "evaluation_simd.c"
+
+#ifndef VIOLATIONS_H
+#define VIOLATIONS_H
+
+// Incremental violation state of one thread's current point set.
+// Each constraint has a violated flag, the violated constraints are kept in a dense set
+// (with their position in it, for O(1) removal), and the per-point counts are kept in sync.
+// A move of point p then only needs one pass over the constraints of p.
+// Constraints can carry a weight (e.g. the number of symmetric copies they stand for), in which
+// case the per-point counts and violated_weight are weighted; violated_count never is.
+// Points to move are drawn from a Fenwick tree over WEIGHT_ADJUSTMENT * violations + 1, kept in sync
+// with the per-point counts; frozen (e.g. fixed) points have weight zero and are never drawn.
+//
+// With adaptive weighting (vstate_enable_weighting), each constraint also has a search weight, which
+// starts at 1, grows while the constraint stays violated on a plateau and decays back periodically,
+// as in clause weighting for SAT. Moves are then scored, and points drawn, by the violated constraints'
+// weight times search weight (violated_score and the per-point counts), while violated_weight keeps
+// measuring the actual progress.
+#define SEARCH_WEIGHT_MAX 1000
+
+typedef struct {
+    int N;
+    int constraint_count;
+    const int* weight;          // per-constraint weight, or NULL for all ones
+    unsigned char* violated;    // per-constraint flag
+    int* violated_list;         // ids of the violated constraints, violated_count of them
+    int* violated_pos;          // position of each constraint in violated_list, or -1
+    int violated_count;
+    int violated_weight;        // total weight of the violated constraints
+    uint16_t* search_weight;    // per-constraint search weight, or NULL without adaptive weighting
+    long long violated_score;   // total weight times search weight of the violated constraints
+    int* violations_per_point;
+    const bool* frozen;         // points that never move, or NULL
+    fenwick_t sampler;          // sampling weight of each point
+    long long* sampler_weights; // scratch for rebuilding the sampler
+    unsigned char* scratch;     // per-constraint flags of weighted counts of other point sets
+    double* x;                  // structure-of-arrays copy of the points for full evaluations
+    double* y;
+} violation_state_t;
+
+size_t vstate_bytes(int N, int constraint_count) {
+    return 2 * arena_round(constraint_count * sizeof(unsigned char))
+        + 2 * arena_round(constraint_count * sizeof(int))
+        + arena_round(N * sizeof(int))
+        + fenwick_bytes(N) + arena_round(N * sizeof(long long))
+        + 2 * arena_round(N * sizeof(double));
+}
+
+void vstate_init(violation_state_t* vs, int N, int constraint_count, const int* weight, const bool* frozen, arena_t* arena) {
+    vs->N = N;
+    vs->constraint_count = constraint_count;
+    vs->weight = weight;
+    vs->frozen = frozen;
+    fenwick_init(&vs->sampler, N, arena);
+    vs->sampler_weights = arena_alloc(arena, N * sizeof(long long));
+    vs->violated = arena_alloc(arena, constraint_count * sizeof(unsigned char));
+    vs->violated_list = arena_alloc(arena, constraint_count * sizeof(int));
+    vs->violated_pos = arena_alloc(arena, constraint_count * sizeof(int));
+    vs->violations_per_point = arena_alloc(arena, N * sizeof(int));
+    vs->scratch = arena_alloc(arena, constraint_count * sizeof(unsigned char));
+    vs->x = arena_alloc(arena, N * sizeof(double));
+    vs->y = arena_alloc(arena, N * sizeof(double));
+    vs->violated_count = 0;
+    vs->violated_weight = 0;
+    vs->search_weight = NULL;
+    vs->violated_score = 0;
+}
+
+size_t vstate_weighting_bytes(int constraint_count) {
+    return arena_round(constraint_count * sizeof(uint16_t));
+}
+
+// Turns on adaptive weighting, with every search weight at 1. To be called before vstate_rebuild.
+void vstate_enable_weighting(violation_state_t* vs, arena_t* arena) {
+    vs->search_weight = arena_alloc(arena, vs->constraint_count * sizeof(uint16_t));
+    for (int c = 0; c < vs->constraint_count; c++) {
+        vs->search_weight[c] = 1;
+    }
+}
+
+static inline int vstate_weight(const violation_state_t* vs, int c) {
+    return vs->weight ? vs->weight[c] : 1;
+}
+
+// Weight of constraint c in the scores of moves: its weight, times its search weight.
+static inline int vstate_score_weight(const violation_state_t* vs, int c) {
+    return vs->search_weight ? vstate_weight(vs, c) * vs->search_weight[c] : vstate_weight(vs, c);
+}
+
+static inline void vstate_add_point(violation_state_t* vs, int p, int delta) {
+    vs->violations_per_point[p] += delta;
+    if (vs->frozen == NULL || !vs->frozen[p]) {
+        fenwick_add(&vs->sampler, p, (long long)WEIGHT_ADJUSTMENT * delta);
+    }
+}
+
+static inline void vstate_add_score(violation_state_t* vs, const ConstraintColumns* columns, int c, int delta) {
+    vstate_add_point(vs, columns->i[c], delta);
+    vstate_add_point(vs, columns->j[c], delta);
+    vstate_add_point(vs, columns->k[c], delta);
+    vs->violated_score += delta;
+}
+
+static inline void vstate_set(violation_state_t* vs, const ConstraintColumns* columns, int c, bool violated) {
+    vstate_add_score(vs, columns, c, violated ? vstate_score_weight(vs, c) : -vstate_score_weight(vs, c));
+    vs->violated_weight += violated ? vstate_weight(vs, c) : -vstate_weight(vs, c);
+    vs->violated[c] = violated;
+    if (violated) {
+        vs->violated_pos[c] = vs->violated_count;
+        vs->violated_list[vs->violated_count++] = c;
+    } else {
+        // swap with the last element of the set
+        int pos = vs->violated_pos[c];
+        int last = vs->violated_list[--vs->violated_count];
+        vs->violated_list[pos] = last;
+        vs->violated_pos[last] = pos;
+        vs->violated_pos[c] = -1;
+    }
+}
+
+// Re-evaluate every constraint from scratch, with the vectorized full evaluation kernel.
+void vstate_rebuild(violation_state_t* vs, const Problem* problem, const Point* points) {
+    points_to_soa(points, vs->N, vs->x, vs->y);
+    eval_kernel.fn(&problem->columns, problem->constraint_count, vs->x, vs->y, vs->violated);
+
+    vs->violated_count = 0;
+    vs->violated_weight = 0;
+    vs->violated_score = 0;
+    for (int p = 0; p < vs->N; p++) {
+        vs->violations_per_point[p] = 0;
+    }
+    const ConstraintColumns* columns = &problem->columns;
+    for (int c = 0; c < problem->constraint_count; c++) {
+        if (vs->violated[c]) {
+            int w = vstate_score_weight(vs, c);
+            vs->violated_pos[c] = vs->violated_count;
+            vs->violated_list[vs->violated_count++] = c;
+            vs->violated_weight += vstate_weight(vs, c);
+            vs->violated_score += w;
+            vs->violations_per_point[columns->i[c]] += w;
+            vs->violations_per_point[columns->j[c]] += w;
+            vs->violations_per_point[columns->k[c]] += w;
+        } else {
+            vs->violated_pos[c] = -1;
+        }
+    }
+
+    for (int p = 0; p < vs->N; p++) {
+        bool frozen = vs->frozen != NULL && vs->frozen[p];
+        vs->sampler_weights[p] = frozen ? 0 : (long long)WEIGHT_ADJUSTMENT * vs->violations_per_point[p] + 1;
+    }
+    fenwick_build(&vs->sampler, vs->sampler_weights);
+}
+
+// Weighted number of constraints violated by an arbitrary point set, without touching the state.
+int vstate_count_violations(violation_state_t* vs, const Problem* problem, const Point* points) {
+    points_to_soa(points, vs->N, vs->x, vs->y);
+    if (vs->weight == NULL) {
+        return eval_kernel.fn(&problem->columns, problem->constraint_count, vs->x, vs->y, NULL);
+    }
+    eval_kernel.fn(&problem->columns, problem->constraint_count, vs->x, vs->y, vs->scratch);
+    int total = 0;
+    for (int c = 0; c < problem->constraint_count; c++) {
+        total += vs->scratch[c] * vs->weight[c];
+    }
+    return total;
+}
+
+// Scores the current run of a complete problem's cursor, with `slot` a constant after inlining.
+static inline void vstate_score_run(const violation_state_t* vs, const Problem* problem, const Point* points,
+    int p, Point candidate, point_cursor_t* cursor, const int slot, int* changed, int* count, long long* delta) {
+    Point q[3];
+    for (int s = 0; s < 3; s++) {
+        q[s] = cursor->t[s] == p ? candidate : points[cursor->t[s]];
+    }
+    int c = cursor->rank, step = cursor->step, dstep = cursor->dstep;
+    int n = *count;
+    long long d = *delta;
+    const Point* varying = points + cursor->t[slot];
+    for (int r = 0; r < cursor->remaining; r++) {
+        q[slot] = varying[r];
+        bool violated = predicate_violated(chirotope_sign(problem, c), q[0].x, q[0].y, q[1].x, q[1].y, q[2].x, q[2].y);
+        if (violated != vs->violated[c]) {
+            d += violated ? vstate_score_weight(vs, c) : -vstate_score_weight(vs, c);
+            changed[n++] = c;
+        }
+        c += step;
+        step += dstep;
+    }
+    cursor->remaining = 0;
+    *count = n;
+    *delta = d;
+}
+
+// Change in the (weighted) number of violated constraints if point p is moved to `candidate`, or
+// in violated_score with adaptive weighting.
+// The constraints whose status would flip are written to `changed`.
+long long vstate_score_move(const violation_state_t* vs, const Problem* problem, const Point* points,
+    int p, Point candidate, int* changed, int* changed_count) {
+    point_cursor_t cursor = point_cursor(problem, p);
+    long long delta = 0;
+    int count = 0;
+    if (problem->complete) {
+        // run by run: two points of the triple are fixed and the third one walks over consecutive
+        // indices, so the ids and the varying point are kept in registers
+        while (point_cursor_next_run(&cursor)) {
+            switch (cursor.slot) {
+                case 0: vstate_score_run(vs, problem, points, p, candidate, &cursor, 0, changed, &count, &delta); break;
+                case 1: vstate_score_run(vs, problem, points, p, candidate, &cursor, 1, changed, &count, &delta); break;
+                default: vstate_score_run(vs, problem, points, p, candidate, &cursor, 2, changed, &count, &delta); break;
+            }
+        }
+        *changed_count = count;
+        return delta;
+    }
+
+    int c;
+    Constraint constraint;
+    while (point_cursor_next(&cursor, &c, &constraint)) {
+        int pi = constraint.i - 1, pj = constraint.j - 1, pk = constraint.k - 1;
+        bool violated = constraint_violated(&constraint,
+            pi == p ? candidate : points[pi],
+            pj == p ? candidate : points[pj],
+            pk == p ? candidate : points[pk]);
+        if (violated != vs->violated[c]) {
+            delta += violated ? vstate_score_weight(vs, c) : -vstate_score_weight(vs, c);
+            changed[count++] = c;
+        }
+    }
+    *changed_count = count;
+    return delta;
+}
+
+// Commit the flips computed by vstate_score_move.
+void vstate_apply(violation_state_t* vs, const Problem* problem, const int* changed, int changed_count) {
+    for (int t = 0; t < changed_count; t++) {
+        int c = changed[t];
+        vstate_set(vs, &problem->columns, c, !vs->violated[c]);
+    }
+}
+
+// Raises the search weight of every violated constraint by one, up to SEARCH_WEIGHT_MAX.
+void vstate_bump_weights(violation_state_t* vs, const Problem* problem) {
+    for (int t = 0; t < vs->violated_count; t++) {
+        int c = vs->violated_list[t];
+        if (vs->search_weight[c] < SEARCH_WEIGHT_MAX) {
+            vs->search_weight[c]++;
+            vstate_add_score(vs, &problem->columns, c, vstate_weight(vs, c));
+        }
+    }
+}
+
+// Lowers every search weight above 1 by one. A pass over all the search weights, 2 bytes each.
+void vstate_decay_weights(violation_state_t* vs, const Problem* problem) {
+    for (int c = 0; c < vs->constraint_count; c++) {
+        if (vs->search_weight[c] > 1) {
+            vs->search_weight[c]--;
+            if (vs->violated[c]) {
+                vstate_add_score(vs, &problem->columns, c, -vstate_weight(vs, c));
+            }
+        }
+    }
+}
+
+// Sample a point with probability proportional to WEIGHT_ADJUSTMENT * violations + 1, the same
+// distribution as sample_proportional, but in O(log N) and never drawing a frozen point.
+// Returns -1 if every point is frozen.
+int vstate_sample_point(const violation_state_t* vs, rng_t* rng) {
+    return fenwick_sample(&vs->sampler, rng);
+}
+
+int vstate_point_with_max_violations(const violation_state_t* vs) {
+    int imx = 0;
+    for (int p = 1; p < vs->N; p++) {
+        if (vs->violations_per_point[p] > vs->violations_per_point[imx]) {
+            imx = p;
+        }
+    }
+    return imx;
+}
+
+#endif // VIOLATIONS_H